@@ -1,42 +1,61 @@
 #pragma once
 #include <FS.h>
+#include "globals.h"
+
+// CConfigurationFile
+//
+// The station's settings in /config.txt, key=value pairs separated by '&', ie:
+//
+//   ssid=home&psk=secret&mqtt=192.168.1.10&mqttPort=1883
+//
+// The file is read a chunk at a time into a buffer on the stack and each value goes straight into its field
+// as it is read, so parsing allocates nothing.  A line break also ends a pair, unknown keys are skipped and a
+// value too long for its field is cut short.  Settings the file does not have are left empty, or 0.
 
 class CConfigurationFile
 {
 public:
     CConfigurationFile()
-        : m_ssid(NULL)
-        , m_psk(NULL)
-        , m_mqttServerIP(NULL)
-        , m_mqttServerPort(0)
+        : m_mqttServerPort(0),
+          m_truncated(false)
     {
-        m_mapSize = 6;
-        m_map = new ParamMap[6];
-        m_map[0] = { "ssid", &m_ssid, NULL, ParamType::CHAR_ARRAY };
-        m_map[1] = { "psk", &m_psk, NULL, ParamType::CHAR_ARRAY };
-        m_map[2] = { "mqtt", &m_mqttServerIP, NULL, ParamType::CHAR_ARRAY };
-        m_map[3] = { "mqttPort", NULL, &m_mqttServerPort, ParamType::INT };
+        m_ssid[0] = '\0';
+        m_psk[0] = '\0';
+        m_mqttServerIP[0] = '\0';
+
+        m_map[0] = { "ssid", m_ssid, sizeof(m_ssid), NULL, ParamType::CHAR_ARRAY };
+        m_map[1] = { "psk", m_psk, sizeof(m_psk), NULL, ParamType::CHAR_ARRAY };
+        m_map[2] = { "mqtt", m_mqttServerIP, sizeof(m_mqttServerIP), NULL, ParamType::CHAR_ARRAY };
+        m_map[3] = { "mqttPort", NULL, 0, &m_mqttServerPort, ParamType::INT };
     };
-    virtual ~CConfigurationFile();
 
-    bool SetConfiguration(String config);
-    void ParseConfiguration();
+    // The map points into the object itself
+    CConfigurationFile(const CConfigurationFile &) = delete;
+    CConfigurationFile &operator=(const CConfigurationFile &) = delete;
+
+    // SetConfiguration
+    //
+    // Takes the settings in config over the ones in the file and writes them all back, false if config has a
+    // value too long for its setting, if that leaves any of them empty or if the file cannot be written.  The
+    // settings here only change once the file has been.
+    bool SetConfiguration(const char *config);
+
+    // ParseConfiguration - Reads the file, false if there is none
+    bool ParseConfiguration();
 
     // Config Params
-    char* m_ssid;
-    char* m_psk;
-    char* m_mqttServerIP;
+    char m_ssid[CONFIG_SSID_SIZE];
+    char m_psk[CONFIG_PSK_SIZE];
+    char m_mqttServerIP[CONFIG_HOST_SIZE];
     int m_mqttServerPort;
 
 protected:
 
     enum StateParser
     {
-        WAIT_EQUALS,
-        GOT_EQUALS,
-        WAIT_SEPARATOR,
-        GOT_SEPARATOR,
-        END_OF_FILE
+        READING_KEY,
+        READING_VALUE,
+        SKIPPING_VALUE              // Of a key that is not in the map
     };
 
     enum ParamType
@@ -49,23 +68,41 @@ protected:
     // in the config file.
     struct ParamMap
     {
-        String m_key;
-        char** m_charArr;
+        const char* m_key;
+        char* m_charArr;
+        size_t m_cbCharArr;
         int* m_int;
         ParamType m_type;
     };
 
-private:
+    // Where the parser is, kept between chunks
+    struct ParseState
+    {
+        StateParser m_state = StateParser::READING_KEY;
+        char m_key[CONFIG_KEY_SIZE];
+        size_t m_cchKey = 0;        // sizeof(m_key) once the key is too long to be one of ours
+        ParamMap* m_param = NULL;
+        size_t m_cchValue = 0;
+        bool m_truncated = false;
+        int m_number = 0;
+        bool m_negative = false;
+        bool m_numberDone = false;  // Past the digits, as toInt stops there
+    };
 
-    void StringToCharPtr(String str, char** ch);
+private:
 
-    bool ExtractConfigFileData(String str);
-    void SetConfigParam(String configParam, String key);
+    bool ReadFile();
+    void ExtractConfigFileData(ParseState& parse, const char* data, size_t length);
+    void BeginValue(ParseState& parse);
+    void AppendValue(ParseState& parse, char ch);
+    void EndPair(ParseState& parse);
 
-    String GetConfigFileData();
+    bool WriteFile();
 
 private:
 
-    ParamMap * m_map;
-    int m_mapSize;
-};
\ No newline at end of file
+    static const int m_mapSize = 4;
+    ParamMap m_map[m_mapSize];
+
+    bool m_truncated;                   // A value has been cut short since this was last cleared, see EndPair
+};
@@ -7,6 +7,7 @@
 
 #include <PubSubClient.h>
 #include "effectsManager.h"
+#include "ConfigurationFile.h"
 #include "IErrorReported.h"
 
 #include "vector"
@@ -17,11 +18,20 @@ enum WorkMode
 	POWER_SAVE = 1
 };
 
+// Where the station is in getting onto WiFi and then the MQTT broker, see PollConnection
+enum class ConnectionState
+{
+	WiFiConnecting,
+	MqttConnecting,
+	Connected
+};
+
 class CWorkingStation : public IErrorReporter
 {
 public:
 	CWorkingStation()
-		: m_client(m_espClient)
+		: m_client(m_espClient), m_connState(ConnectionState::WiFiConnecting),
+		  m_offlineSinceMs(0), m_nextAttemptMs(0), m_backoffMs(RECONNECT_BACKOFF_MIN_MS), m_lastPowerReportMs(0)
 	{
 	};
 
@@ -34,12 +44,6 @@ public:
 		}
 
 		m_vecEffects.clear();
-
-		if (m_ssid)
-			delete[] m_ssid;
-
-		if (m_psk)
-			delete[] m_psk;
 	};
 
 	bool Init();
@@ -48,20 +52,36 @@ public:
 	virtual void ReportError(String err);
 
 private:
-	bool ReconnectMQTT();
+	void PollConnection();
+	void GoOffline(ConnectionState state);
+	bool TryConnectMQTT();
 	void ConnectToWifi();
 	void PublishCurrPlayEffect();
+	void PublishPower();
+	void PublishCatalog();
 
 	void MQTT_Callback(char *topic, uint8_t *payload, unsigned int length);
 
-	void NullTerminateArray(void *src, uint8_t len, void **dest);
+	// ForEachChannel - Hands fn the channel a numbered /set topic names, or every channel for 0, see globals.h
+	template <typename Fn>
+	void ForEachChannel(long iChannelNum, Fn fn)
+	{
+		for (int i = 0; i < NUM_CHANNELS; i++)
+			if (iChannelNum == 0 || iChannelNum == i + 1)
+				fn(m_vecEffects.at(i));
+	}
 
 private:
-	char *m_ssid;
-	char *m_psk;
+	CConfigurationFile m_config;                // WiFi and broker settings, read once at boot
 
 	PubSubClient m_client;
 	WiFiClient m_espClient;
 
 	std::vector<EffectsManager *> m_vecEffects;
+
+	ConnectionState m_connState;
+	unsigned long m_offlineSinceMs;             // When the connection was lost, the station restarts if it stays lost
+	unsigned long m_nextAttemptMs;              // When to next try the broker
+	unsigned long m_backoffMs;                  // How long after that to try again if it fails
+	unsigned long m_lastPowerReportMs;          // When the channels' estimated draw was last published
 };
\ No newline at end of file
@@ -0,0 +1,178 @@
+//+--------------------------------------------------------------------------
+//
+// File:        binaryCommand.h
+//
+// Description:
+//
+//    Compact binary form of a setEffect request, for senders that do not
+//    want to go through JSON.  All values are little endian.
+//
+//      Header, 8 bytes
+//          uint8_t   version          BINARY_COMMAND_VERSION
+//          int8_t    channel          -1 for every channel
+//          uint8_t   paramCount
+//          uint8_t   reserved         0
+//          uint32_t  effectId         NameHash of the effect name, ie: "MeteorEffect"
+//
+//      Then paramCount parameters, each
+//          uint16_t  tag              Low 16 bits of the NameHash of the parameter name
+//          uint8_t   type             BinaryParamType
+//          uint8_t   length           Bytes of value that follow
+//          ...       value            int32, float, uint8 bool, or a uint32 NameHash for names
+//
+//    Decoding never allocates: the parameters are read straight out of the
+//    message buffer when the effect's constructor thunk asks for them.
+//
+//---------------------------------------------------------------------------
+
+#pragma once
+
+#include <string.h>
+#include "globals.h"
+#include "effectParams.h"
+
+#define BINARY_COMMAND_VERSION 1
+
+enum class BinaryParamType : uint8_t
+{
+    Int   = 0,
+    Float = 1,
+    Bool  = 2,
+    Name  = 3
+};
+
+constexpr uint16_t BinaryParamTag(uint32_t nameHash)
+{
+    return (uint16_t)nameHash;
+}
+
+// BinaryEffectParams
+//
+// IEffectParams over the parameter block of a binary command.  Parse checks the whole message up front, so
+// the lookups after it can walk the parameters without bounds checks of their own.
+
+class BinaryEffectParams : public IEffectParams
+{
+  private:
+
+    static constexpr size_t HeaderSize = 8;
+    static constexpr size_t ParamHeaderSize = 4;
+
+    const uint8_t *_pParams;
+    uint8_t        _cParams;
+    int8_t         _channel;
+    uint32_t       _effectId;
+
+    static uint32_t ReadU32(const uint8_t *p)
+    {
+        return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+    }
+
+    // Find
+    //
+    // Value bytes of the parameter with the given tag and type, NULL if the command does not carry it
+
+    const uint8_t *Find(uint32_t nameHash, BinaryParamType *pType, uint8_t *pLength) const
+    {
+        const uint16_t tag = BinaryParamTag(nameHash);
+        const uint8_t *p = _pParams;
+        for (uint8_t i = 0; i < _cParams; i++)
+        {
+            const uint8_t length = p[3];
+            if ((uint16_t)(p[0] | (p[1] << 8)) == tag)
+            {
+                *pType = (BinaryParamType)p[2];
+                *pLength = length;
+                return p + ParamHeaderSize;
+            }
+            p += ParamHeaderSize + length;
+        }
+        return NULL;
+    }
+
+  public:
+
+    BinaryEffectParams()
+      : _pParams(NULL), _cParams(0), _channel(-1), _effectId(0)
+    {
+    }
+
+    int8_t Channel() const
+    {
+        return _channel;
+    }
+
+    uint32_t EffectId() const
+    {
+        return _effectId;
+    }
+
+    bool Parse(const uint8_t *pMessage, size_t length, String &strError)
+    {
+        if (length < HeaderSize)
+        {
+            strError = "Binary command too short";
+            return false;
+        }
+        if (pMessage[0] != BINARY_COMMAND_VERSION)
+        {
+            strError = "Unsupported binary command version";
+            return false;
+        }
+
+        _channel  = (int8_t)pMessage[1];
+        _cParams  = pMessage[2];
+        _effectId = ReadU32(pMessage + 4);
+        _pParams  = pMessage + HeaderSize;
+
+        size_t offset = HeaderSize;
+        for (uint8_t i = 0; i < _cParams; i++)
+        {
+            if (offset + ParamHeaderSize > length || offset + ParamHeaderSize + pMessage[offset + 3] > length)
+            {
+                strError = "Binary command parameters run past the end of the message";
+                return false;
+            }
+            offset += ParamHeaderSize + pMessage[offset + 3];
+        }
+        return true;
+    }
+
+    virtual bool GetNumber(const EffectParam &param, float *pValue) const
+    {
+        BinaryParamType type;
+        uint8_t length;
+        const uint8_t *p = Find(param.hash, &type, &length);
+        if (p == NULL)
+            return false;
+
+        if (type == BinaryParamType::Bool && length >= 1)
+        {
+            *pValue = p[0] ? 1.0f : 0.0f;
+            return true;
+        }
+        if (length < 4)
+            return false;
+
+        uint32_t bits = ReadU32(p);
+        if (type == BinaryParamType::Int)
+            *pValue = (float)(int32_t)bits;
+        else if (type == BinaryParamType::Float)
+            memcpy(pValue, &bits, sizeof(float));
+        else
+            return false;
+        return true;
+    }
+
+    virtual bool GetName(const EffectParam &param, uint32_t *pHash) const
+    {
+        BinaryParamType type;
+        uint8_t length;
+        const uint8_t *p = Find(param.hash, &type, &length);
+        if (p == NULL || type != BinaryParamType::Name || length < 4)
+            return false;
+
+        *pHash = ReadU32(p);
+        return true;
+    }
+};
@@ -29,10 +29,95 @@
 //
 //---------------------------------------------------------------------------
 
+#pragma once
+
+#include "globals.h"
+#include "namehash.h"
+#include "effectArena.h"
+
+// PaletteHandle
+//
+// Read-only 256 entry palette, expanded into the arena of the effect that uses it.  It goes when the effect
+// is torn down and the arena Reset, so effects hold the pointer and never free it.
+
+typedef const CRGBPalette256 *PaletteHandle;
+
+// FlashPalette
+//
+// A palette kept in flash in its compact form, either 16 entries or gradient stops.  The 256 entry table is
+// only expanded into RAM for an effect that uses it, in that effect's arena, so picking an effect with a
+// palette takes nothing from the heap.  Effects that use one count PaletteBytes in their arena size.
+
+class FlashPalette
+{
+  private:
+
+    const TProgmemRGBPalette16 *_pEntries;
+    TProgmemRGBGradientPalette_bytes _pGradient;
+
+  public:
+
+    FlashPalette(const TProgmemRGBPalette16 &entries)
+      : _pEntries(&entries), _pGradient(nullptr)
+    {
+    }
+
+    FlashPalette(TProgmemRGBGradientPalette_bytes gradient)
+      : _pEntries(nullptr), _pGradient(gradient)
+    {
+    }
+
+    // Expand - The 256 entry table built in the arena, NULL if it does not fit
+
+    PaletteHandle Expand(EffectArena &arena) const
+    {
+        static_assert(std::is_trivially_destructible<CRGBPalette256>::value, "Arena palettes are never destroyed");
+
+        if (_pEntries)
+            return new (arena) CRGBPalette256(*_pEntries);
+        return new (arena) CRGBPalette256(_pGradient);
+    }
+};
+
+// How much of an arena an expanded palette takes
+constexpr size_t PaletteBytes = ArenaBytes(sizeof(CRGBPalette256));
+
 // Palettes defined in colordata.cpp
 
-extern CRGBPalette256 vuPaletteGreen;
-extern CRGBPalette256 vuPaletteBlue;    
-extern CRGBPalette256 spectrumBasicColors;
-extern CRGBPalette256 bluesky_pal;
+extern const FlashPalette RainbowPalette;
+extern const FlashPalette HeatPalette;
+extern const FlashPalette RGBPalette;
+extern const FlashPalette BluePalette;
+extern const FlashPalette RedPalette;
+extern const FlashPalette GreenPalette;
+extern const FlashPalette PurplePalette;
+extern const FlashPalette MagentaPalette;
+extern const FlashPalette SpectrumPalette;
+extern const FlashPalette BGPalette;
+extern const FlashPalette BlueSweepPalette;
+extern const FlashPalette BlueStripesPalette;
+extern const FlashPalette MagentaStripesPalette;
+extern const FlashPalette VUGreenPalette;
+
+// PaletteEntry
+//
+// Palette registry, keyed by the NameHash of the name effect requests use
+
+struct PaletteEntry
+{
+    const char         *name;
+    uint32_t            hash;
+    const FlashPalette *palette;
+};
+
+// FindPalette
+//
+// Looks a palette up by the NameHash of its name, NULL if there is no such palette
+
+const FlashPalette *FindPalette(uint32_t hash);
+
+// GetPaletteEntry
+//
+// For listing the catalog, NULL past the last palette
 
+const PaletteEntry *GetPaletteEntry(size_t i);
@@ -0,0 +1,141 @@
+//+--------------------------------------------------------------------------
+//
+// File:        effectArena.h
+//
+// Description:
+//
+//    Fixed block of memory an effect is built in, along with any buffers it
+//    needs.  Each channel allocates its arenas once at boot, sized to fit the
+//    largest effect in the registry, so changing effects never touches the
+//    heap and cannot fragment it.  Memory is handed out from the front and
+//    is only given back all at once, when the effect living there is torn
+//    down and the arena is Reset.
+//
+//---------------------------------------------------------------------------
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <new>
+#include <type_traits>
+
+#define EFFECT_ARENA_ALIGN 8                    // Enough for the doubles some effects keep
+
+// ArenaBytes
+//
+// How much of an arena an object or buffer of cb bytes takes, used to size the arenas at compile time
+
+constexpr size_t ArenaBytes(size_t cb)
+{
+    return (cb + EFFECT_ARENA_ALIGN - 1) & ~(size_t)(EFFECT_ARENA_ALIGN - 1);
+}
+
+class EffectArena
+{
+  private:
+
+    uint8_t *_pBase;
+    size_t   _cbCapacity;
+    size_t   _cbUsed;
+    size_t   _cbHighWater;                      // Most that any effect has used since boot
+    uint32_t _cFailures;                        // Allocations that did not fit
+
+  public:
+
+    explicit EffectArena(size_t cbCapacity)
+      : _pBase((uint8_t *)malloc(cbCapacity)), _cbCapacity(0), _cbUsed(0), _cbHighWater(0), _cFailures(0)
+    {
+        if (_pBase)
+            _cbCapacity = cbCapacity;
+    }
+
+    ~EffectArena()
+    {
+        free(_pBase);
+    }
+
+    EffectArena(const EffectArena &) = delete;
+    EffectArena &operator=(const EffectArena &) = delete;
+
+    // Allocate
+    //
+    // Next cb bytes of the arena, NULL if they do not fit
+
+    void *Allocate(size_t cb, size_t align = EFFECT_ARENA_ALIGN)
+    {
+        size_t offset = (_cbUsed + align - 1) & ~(align - 1);
+        if (_pBase == NULL || offset + cb > _cbCapacity)
+        {
+            _cFailures++;
+            return NULL;
+        }
+
+        _cbUsed = offset + cb;
+        if (_cbUsed > _cbHighWater)
+            _cbHighWater = _cbUsed;
+        return _pBase + offset;
+    }
+
+    // AllocateArray
+    //
+    // Value initialized array of count T, NULL if it does not fit.  Nothing is ever destroyed, so T has to be
+    // something that does not need its destructor run.
+
+    template <typename T>
+    T *AllocateArray(size_t count)
+    {
+        static_assert(std::is_trivially_destructible<T>::value, "Arena arrays are never destroyed");
+
+        void *p = Allocate(sizeof(T) * count, alignof(T));
+        if (p == NULL)
+            return NULL;
+
+        T *pArray = (T *)p;
+        for (size_t i = 0; i < count; i++)
+            new (&pArray[i]) T();
+        return pArray;
+    }
+
+    // Reset
+    //
+    // Gives back everything at once.  Whatever was built in the arena must have been destroyed already.
+
+    void Reset()
+    {
+        _cbUsed = 0;
+    }
+
+    size_t Capacity() const
+    {
+        return _cbCapacity;
+    }
+
+    size_t Used() const
+    {
+        return _cbUsed;
+    }
+
+    size_t HighWater() const
+    {
+        return _cbHighWater;
+    }
+
+    uint32_t Failures() const
+    {
+        return _cFailures;
+    }
+};
+
+// Placement new into an arena, ie: new (arena) FireEffect(...).  It is noexcept so that when the arena is full the
+// new expression yields NULL rather than throwing, and the constructor is never run.
+
+inline void *operator new(size_t cb, EffectArena &arena) noexcept
+{
+    return arena.Allocate(cb);
+}
+
+inline void operator delete(void *, EffectArena &) noexcept
+{
+}
@@ -0,0 +1,120 @@
+//+--------------------------------------------------------------------------
+//
+// File:        effectParams.h
+//
+// Description:
+//
+//    Describes the parameters an effect takes and how they are read.  Each
+//    registry entry carries a table of EffectParam, which doubles as the
+//    catalog listing and as the source of defaults.  The values themselves
+//    come from an IEffectParams, so the same constructor thunk works no
+//    matter what format the request arrived in.
+//
+//---------------------------------------------------------------------------
+
+#pragma once
+
+#include "namehash.h"
+
+enum class ParamType : uint8_t
+{
+    Int,
+    Float,
+    Bool,
+    Name                                        // A string such as a palette name, handed to the thunk as its NameHash
+};
+
+struct EffectParam
+{
+    const char *name;
+    uint32_t    hash;
+    ParamType   type;
+    float       defValue;
+    const char *defName;
+};
+
+#define PARAM_INT(name, def)   { name, NameHash(name), ParamType::Int,   (float)(def), nullptr }
+#define PARAM_FLOAT(name, def) { name, NameHash(name), ParamType::Float, (float)(def), nullptr }
+#define PARAM_BOOL(name, def)  { name, NameHash(name), ParamType::Bool,  (def) ? 1.0f : 0.0f, nullptr }
+#define PARAM_NAME(name, def)  { name, NameHash(name), ParamType::Name,  0.0f, def }
+
+// IEffectParams
+//
+// Where parameter values come from.  Returns false when the request did not include the parameter.
+
+class IEffectParams
+{
+  public:
+
+    virtual ~IEffectParams()
+    {
+    }
+
+    virtual bool GetNumber(const EffectParam &param, float *pValue) const = 0;
+    virtual bool GetName(const EffectParam &param, uint32_t *pHash) const = 0;
+};
+
+// EffectArgs
+//
+// What a constructor thunk is handed: values from the request, falling back to the defaults in the descriptor.
+// Parameters are asked for by hash, ie: args.Int("cooling"_h), and must be in the effect's descriptor table.
+
+class EffectArgs
+{
+  private:
+
+    const IEffectParams &_source;
+    const EffectParam   *_pParams;
+    size_t               _cParams;
+
+    const EffectParam *Describe(uint32_t hash) const
+    {
+        for (size_t i = 0; i < _cParams; i++)
+            if (_pParams[i].hash == hash)
+                return &_pParams[i];
+        return nullptr;
+    }
+
+  public:
+
+    EffectArgs(const IEffectParams &source, const EffectParam *pParams, size_t cParams)
+      : _source(source), _pParams(pParams), _cParams(cParams)
+    {
+    }
+
+    float Float(uint32_t hash) const
+    {
+        const EffectParam *param = Describe(hash);
+        if (!param)
+            return 0.0f;
+
+        float value;
+        return _source.GetNumber(*param, &value) ? value : param->defValue;
+    }
+
+    int32_t Int(uint32_t hash) const
+    {
+        return (int32_t)Float(hash);
+    }
+
+    bool Bool(uint32_t hash) const
+    {
+        return Float(hash) != 0.0f;
+    }
+
+    // Name
+    //
+    // NameHash of the string value, 0 if the request has none and there is no default
+
+    uint32_t Name(uint32_t hash) const
+    {
+        const EffectParam *param = Describe(hash);
+        if (!param)
+            return 0;
+
+        uint32_t value;
+        if (_source.GetName(*param, &value))
+            return value;
+        return param->defName ? NameHash(param->defName) : 0;
+    }
+};
@@ -69,19 +69,28 @@ private:
 
     const bool _bErase;
 
-	double Gravity = -9.81;
-	double StartHeight = 1;
-	double ImpactVelocityStart = sqrt(-2 * Gravity * StartHeight);
+	float Gravity = -9.81f;
+	float StartHeight = 1;
+	float ImpactVelocityStart = sqrtf(-2 * Gravity * StartHeight);
 	
-	std::vector<double> ClockTimeSinceLastBounce;
-	std::vector<double> TimeSinceLastBounce;
-	std::vector<double> Height;
-	std::vector<double> ImpactVelocity;
-	std::vector<double> Dampening;
-	std::vector<CRGB> Colors;
+	// Per ball state, carved from the effect arena in Init
+
+	uint32_t * LastBounceTick = NULL;                                      // AppTime tick of the frame the ball last bounced in
+	float    * Height = NULL;
+	float    * ImpactVelocity = NULL;
+	float    * Dampening = NULL;
+	CRGB     * Colors = NULL;
 	
   public:
 
+	// BufferBytes - How much of the effect arena Init takes, the accumulator included
+
+	static constexpr size_t BufferBytes(size_t ballCount)
+	{
+		return ArenaBytes(sizeof(uint32_t) * ballCount) + 3 * ArenaBytes(sizeof(float) * ballCount) + ArenaBytes(sizeof(CRGB) * ballCount) +
+		       ArenaBytes(sizeof(HDRAccumulator));
+	}
+
 	BouncingBallEffect(size_t ballCount = 3, bool bMirrored = true, bool bErase = false, int ballSize = 5)
 		: LEDStripEffect("Bouncing Ball Effect"),
 		  _cBalls(ballCount),
@@ -97,22 +106,28 @@ private:
         if (!LEDStripEffect::Init(gfx))
             return false;
 
+        if (!EnableHDR())                                                   // Mirrored balls cross each other
+            return false;
+
         _cLength = gfx->GetLEDCount();
 
-		ClockTimeSinceLastBounce.resize(_cBalls);
-		TimeSinceLastBounce.resize(_cBalls);
-		Height.resize(_cBalls);
-		ImpactVelocity.resize(_cBalls);
-		Dampening.resize(_cBalls);
-		Colors.resize(_cBalls);
+        if (!Colors)
+        {
+            LastBounceTick = AllocateBuffer<uint32_t>(_cBalls);
+            Height         = AllocateBuffer<float>(_cBalls);
+            ImpactVelocity = AllocateBuffer<float>(_cBalls);
+            Dampening      = AllocateBuffer<float>(_cBalls);
+            Colors         = AllocateBuffer<CRGB>(_cBalls);
+            if (!LastBounceTick || !Height || !ImpactVelocity || !Dampening || !Colors)
+                return false;
+        }
 
 		for (size_t i = 0; i < _cBalls; i++)
 		{
 			Height[i] 					= StartHeight;
 			ImpactVelocity[i] 			= ImpactVelocityStart;
-			ClockTimeSinceLastBounce[i] = g_AppTime.FrameStartTime();
-			Dampening[i] 				= 1.0 - i / pow(_cBalls, 2);               // Was 0.9
-			TimeSinceLastBounce[i] 		= 0;
+			LastBounceTick[i] 			= g_AppTime.FrameStartTicks();
+			Dampening[i] 				= 1.0f - i / (float)(_cBalls * _cBalls);   // Was 0.9
 			Colors[i] 					= ballColors[i % ARRAYSIZE(ballColors)];
 		}           
         return true; 
@@ -136,37 +151,31 @@ private:
         }
         else
         {
-            for (size_t j = 0; j < _cLength; j++)							// fade brightness all LEDs one step
-            {
-                if (randomDouble(0, 10)>5) 
-                {
-                    CRGB c = _GFX->getPixel(j, 0);
-                    c.fadeToBlackBy(10);
-                    setPixels(j, 1, c, false);
-                }
-            }            
+            fadeRandomPixelsToBlackBy(10);                                  // fade brightness of half the LEDs one step
         }
 
 		// Draw each of the the balls
 		for (size_t i = 0; i < _cBalls; i++)
 		{
-			TimeSinceLastBounce[i] = (g_AppTime.FrameStartTime() - ClockTimeSinceLastBounce[i]) / 3;		// BUGBUG hardcoded was 3 for NightDriverStrip
-			Height[i] = 0.5 * Gravity * pow(TimeSinceLastBounce[i], 2.0) + ImpactVelocity[i] * TimeSinceLastBounce[i];
+			float timeSinceLastBounce = (g_AppTime.FrameStartTicks() - LastBounceTick[i]) / (3.0f * MICROS_PER_SECOND);	// BUGBUG hardcoded was 3 for NightDriverStrip
+			Height[i] = 0.5f * Gravity * timeSinceLastBounce * timeSinceLastBounce + ImpactVelocity[i] * timeSinceLastBounce;
 
 			if (Height[i] < 0)
 			{
 				Height[i] = 0;
 				ImpactVelocity[i] = Dampening[i] * ImpactVelocity[i];
-				ClockTimeSinceLastBounce[i] = g_AppTime.FrameStartTime();;
+				LastBounceTick[i] = g_AppTime.FrameStartTicks();
 
-				if (ImpactVelocity[i] < 0.5 * ImpactVelocityStart)                                    // Was .01 and not multiplied by anything
+				if (ImpactVelocity[i] < 0.5f * ImpactVelocityStart)                                    // Was .01 and not multiplied by anything
 					ImpactVelocity[i] = ImpactVelocityStart;
 			}
 
 			float position = Height[i] * (_cLength - 1) / StartHeight;
-			setPixels(position, _cBallSize, Colors[i]);
+			addPixels(position, _cBallSize, Colors[i]);
             if (_bMirrored)
-                setPixels(_cLength-1-position, _cBallSize, Colors[i], true);
+                addPixels(_cLength-1-position, _cBallSize, Colors[i]);
         }
+
+        resolveHDR();
 	}
 };
@@ -51,10 +51,11 @@ class DoublePaletteEffect : public LEDStripEffect
 
   public:
   
-    DoublePaletteEffect() 
+    // Both halves draw from the one rainbow palette
+    DoublePaletteEffect(PaletteHandle palette) 
      :  LEDStripEffect("Double Palette Effect"),
-        _PaletteEffect1(RainbowColors_p, 1.0,  0.03,  4.0, 3, 3, LINEARBLEND, false, 0.5),
-        _PaletteEffect2(RainbowColors_p, 1.0, -0.03, -4.0, 3, 3, LINEARBLEND, false, 0.5)
+        _PaletteEffect1(palette, 1.0,  0.03,  4.0, 3, 3, LINEARBLEND, false),
+        _PaletteEffect2(palette, 1.0, -0.03, -4.0, 3, 3, LINEARBLEND, false)
     {
     }
 
@@ -63,6 +64,12 @@ class DoublePaletteEffect : public LEDStripEffect
         LEDStripEffect::Init(gfx);
         if (!_PaletteEffect1.Init(gfx) || !_PaletteEffect2.Init(gfx))
             return false;
+
+        // Both halves add into one accumulator, which averages them, so where they cross the colors blend instead of overwrite
+        if (!EnableHDR())
+            return false;
+        _PaletteEffect1.ShareHDR(_HDR);
+        _PaletteEffect2.ShareHDR(_HDR);
         return true;
     }
 	virtual void Draw() 
@@ -70,8 +77,9 @@ class DoublePaletteEffect : public LEDStripEffect
         setAllOnAllChannels(0,0,0);
         _PaletteEffect1.Draw();
         _PaletteEffect2.Draw();
+        resolveHDR(1);
     }
-	
+
     virtual const char * FriendlyName() const
     {
         return "DoublePaletteEffect Effect";
@@ -33,6 +33,7 @@
 
 #include <sys/types.h>
 #include <errno.h>
+#include <assert.h>
 #include <iostream>
 #include <vector>
 #include <math.h>
@@ -40,12 +41,227 @@
 #include "colorutils.h"
 #include "globals.h"
 #include "ledstripeffect.h"
+#include "colordata.h"
 
 extern AppTime g_AppTime;
 extern volatile float gVURatio;
 
 using namespace std;
 
+// FireEngine
+//
+// The heat simulation every fire effect is built on.  Heat rises from the base of the flame at cell 0, and the
+// cells sit behind Pad cells that are always cold, so diffusion can look three cells down from anywhere without
+// a bounds check or a modulo.  Heat becomes color through a 256 entry table the effect fills once, with black
+// body colors or from a palette, so drawing a cell is a single lookup.
+
+class FireEngine
+{
+  public:
+
+    static constexpr int Pad = 3;
+
+    enum class SparkMode : uint8_t
+    {
+        Set,                                    // Replace whatever heat the cell had
+        Add,                                    // Add to it, rolling over past 255, which is part of the look of some fires
+        AddSaturate                             // Add to it, stopping at 255
+    };
+
+  private:
+
+    uint8_t * _pHeat;                           // Pad cold cells, then the flame
+    CRGB    * _pColors;                         // Color for each heat value
+    int       _cCells;
+    int       _cKernel;                         // Cells at the base that Diffuse leaves alone
+    uint8_t   _blend[4];                        // Weight of the cell itself and of each of the three below it
+    uint32_t  _reciprocal;                      // 2^24 / total weight, rounded up, so the blend divides with a multiply, see SetBlend
+
+  public:
+
+    FireEngine()
+      : _pHeat(NULL), _pColors(NULL), _cCells(0), _cKernel(0), _blend{ 0, 1, 1, 1 }, _reciprocal(0)
+    {
+        SetBlend(0, 1, 1, 1);
+    }
+
+    // BufferBytes - How much of the effect arena Attach needs for a flame of the given number of cells
+
+    static constexpr size_t BufferBytes(int cells)
+    {
+        return ArenaBytes(Pad + cells) + ArenaBytes(256 * sizeof(CRGB));
+    }
+
+    // Attach
+    //
+    // Hands the engine its buffers, Pad + cells of zeroed heat and a 256 entry color table
+
+    bool Attach(uint8_t * pHeat, CRGB * pColors, int cells)
+    {
+        _pHeat = pHeat;
+        _pColors = pColors;
+        _cCells = cells;
+        return _pHeat && _pColors;
+    }
+
+    bool IsAttached() const
+    {
+        return _pHeat && _pColors;
+    }
+
+    int Cells() const
+    {
+        return _cCells;
+    }
+
+    // SetBlend
+    //
+    // How Diffuse mixes each cell with the three below it.  The weights are relative to their total, which may
+    // be at most 255, and the lowest 'kernel' cells are not diffused at all.  Diffuse multiplies by the rounded up
+    // reciprocal of the total instead of dividing, which gives the same as the division only for totals that small.
+
+    void SetBlend(uint8_t self, uint8_t below1, uint8_t below2, uint8_t below3, int kernel = 0)
+    {
+        uint32_t total = (uint32_t)self + below1 + below2 + below3;
+        assert(total <= 255);
+        if (total == 0)
+        {
+            self = 1;
+            total = 1;
+        }
+        _blend[0] = self;
+        _blend[1] = below1;
+        _blend[2] = below2;
+        _blend[3] = below3;
+        _reciprocal = ((1UL << 24) + total - 1) / total;
+        _cKernel = kernel;
+    }
+
+    // FillBlackBody
+    //
+    // Black body ramp through red, yellow and white
+
+    void FillBlackBody()
+    {
+        for (int t = 0; t < 256; t++)
+        {
+            uint8_t t192 = (t * 191 + 127) / 255;               // Scale heat down to 0..191, rounded
+            uint8_t heatramp = (t192 & 0x3F) << 2;               // Ramp up within each third, 0..252
+
+            if (t192 > 0x80)
+                _pColors[t] = CRGB(255, 255, heatramp);
+            else if (t192 > 0x40)
+                _pColors[t] = CRGB(255, heatramp, 0);
+            else
+                _pColors[t] = CRGB(heatramp, 0, 0);
+        }
+    }
+
+    // FillPalette
+    //
+    // Heat maps onto the palette from its start up to maxIndex
+
+    void FillPalette(const CRGBPalette256 & palette, uint8_t maxIndex = 240)
+    {
+        for (int t = 0; t < 256; t++)
+            _pColors[t] = palette[t * maxIndex / 255];
+    }
+
+    // Cool
+    //
+    // Takes a random amount of heat, below maxAmount, away from each cell.  The random bytes are drawn in bulk and
+    // scaled rather than rolled one range at a time, which leaves a sliver of bias that no flame will show.
+
+    void Cool(FastRandom & random, int maxAmount)
+    {
+        maxAmount = ::max(0, ::min(maxAmount, 256));
+        uint8_t * pCell = _pHeat + Pad;
+        uint8_t noise[32];
+
+        for (int base = 0; base < _cCells; base += sizeof(noise))
+        {
+            const int cChunk = ::min<int>(sizeof(noise), _cCells - base);
+            random.FillBytes(noise, cChunk);
+            for (int i = 0; i < cChunk; i++)
+                pCell[base + i] = qsub8(pCell[base + i], (noise[i] * maxAmount) >> 8);
+        }
+    }
+
+    // CoolEvenly - Takes the same amount of heat away from every cell
+
+    void CoolEvenly(uint8_t amount)
+    {
+        uint8_t * pCell = _pHeat + Pad;
+        for (int i = 0; i < _cCells; i++)
+            pCell[i] = qsub8(pCell[i], amount);
+    }
+
+    // Diffuse
+    //
+    // Heat drifts up.  Working from the top down, each cell becomes the blend of itself and the three cells below,
+    // which still hold their heat from before this pass.
+
+    void Diffuse()
+    {
+        uint8_t * pCell = _pHeat + Pad;
+        const uint32_t w0 = _blend[0], w1 = _blend[1], w2 = _blend[2], w3 = _blend[3];
+
+        for (int k = _cCells - 1; k >= _cKernel; k--)
+            pCell[k] = (uint8_t)(((pCell[k] * w0 + pCell[k - 1] * w1 + pCell[k - 2] * w2 + pCell[k - 3] * w3) * _reciprocal) >> 24);
+    }
+
+    // Ignite - Adds a spark at the given cell, ignored if it is past the top of the flame
+
+    void Ignite(int cell, uint8_t heat, SparkMode mode)
+    {
+        if (cell < 0 || cell >= _cCells)
+            return;
+
+        uint8_t & target = _pHeat[Pad + cell];
+        switch (mode)
+        {
+            case SparkMode::Set:
+                target = heat;
+                break;
+            case SparkMode::Add:
+                target = target + heat;
+                break;
+            case SparkMode::AddSaturate:
+                target = qadd8(target, heat);
+                break;
+        }
+    }
+
+    uint8_t Heat(int cell) const
+    {
+        return _pHeat[Pad + cell];
+    }
+
+    CRGB CellColor(int cell) const
+    {
+        return _pColors[_pHeat[Pad + cell]];
+    }
+
+    // GroupColor - Color of the average heat of a run of cells, for flames with several cells to each LED
+
+    CRGB GroupColor(int firstCell, int cells) const
+    {
+        if (cells == 1)
+            return CellColor(firstCell);
+
+        const uint8_t * pCell = _pHeat + Pad + firstCell;
+        int sum = 0;
+        for (int i = 0; i < cells; i++)
+            sum += pCell[i];
+        return _pColors[sum / cells];
+    }
+};
+
+// FireEffect
+//
+// Flame with its base at the end of the strip, or at both ends or in the middle when mirrored.  It cools and
+// drifts on timers of its own, so it burns at the same pace whatever the frame rate.
+
 class FireEffect : public LEDStripEffect
 {
   protected:
@@ -58,22 +274,49 @@ class FireEffect : public LEDStripEffect
     bool    bReversed;          // If reversed we draw from 0 outwards
     bool    bMirrored;          // If mirrored we split and duplicate the drawing
 
-    std::unique_ptr<uint8_t []> heat;
+    FireEngine _fire;
+    uint32_t   _lastCoolTick;   // Kept per effect, so fires on different channels keep their own pace
+    uint32_t   _lastDriftTick;
 
-    // When diffusing the fire upwards, these control how much to blend in from the cells below (ie: downward neighbors)
-    // You can tune these coefficients to control how quickly and smoothly the fire spreads
+    static const uint32_t CoolTicks  = 50000;
+    static const uint32_t DriftTicks = 20000;
 
-    static const uint8_t BlendSelf = 0;            // 2
-    static const uint8_t BlendNeighbor1 = 1;       // 3
-    static const uint8_t BlendNeighbor2 = 2;       // 2
-    static const uint8_t BlendNeighbor3 = 0;       // 1
+    int CellCount() const { return LEDCount * CellsPerLED; } 
 
-    static const uint8_t BlendTotal = (BlendSelf + BlendNeighbor1 + BlendNeighbor2 + BlendNeighbor3);
+    // FillColors - Fills the engine's color table, black body unless overridden
 
-    int CellCount() const { return LEDCount * CellsPerLED; } 
+    virtual void FillColors()
+    {
+        _fire.FillBlackBody();
+    }
+
+    // DrawFlame
+    //
+    // Draws the engine onto the strip.  Each LED shows the average heat of its cells, the base of the flame at the
+    // end unless reversed, and mirrored about the middle when asked to be.
+
+    void DrawFlame(bool bMerge)
+    {
+        for (int i = 0; i < LEDCount; i++)
+        {
+            CRGB color = _fire.GroupColor(i * CellsPerLED, CellsPerLED);
+
+            int j = bReversed ? i : LEDCount - 1 - i;
+            setPixels(j, 1, color, bMerge);
+            if (bMirrored)
+                setPixels(bReversed ? (2 * LEDCount - 1 - i) : LEDCount + i, 1, color, bMerge);
+        }
+    }
 
   public:
 
+    // BufferBytes - How much of the effect arena Init takes for buffers, on top of the effect itself
+
+    static constexpr size_t BufferBytes(int ledCount, int cellsPerLED)
+    {
+        return FireEngine::BufferBytes(ledCount * cellsPerLED);
+    }
+
     FireEffect(int ledCount = NUM_LEDS, int cellsPerLED = 1, int cooling = 20, int sparking = 100, int sparks = 3, int sparkHeight = 4,  bool breversed = false, bool bmirrored = false)
         : LEDStripEffect("FireEffect"),
           LEDCount(ledCount),
@@ -83,35 +326,32 @@ class FireEffect : public LEDStripEffect
           SparkHeight(sparkHeight),
           Sparking(sparking),
           bReversed(breversed),
-          bMirrored(bmirrored)
+          bMirrored(bmirrored),
+          _lastCoolTick(0),
+          _lastDriftTick(0)
     {
         if (bMirrored)
             LEDCount = LEDCount / 2;
 
-        heat = make_unique<uint8_t []>(CellCount());
+        _fire.SetBlend(0, 1, 2, 0);
     }
 
     virtual ~FireEffect()
     {
     }
 
-    virtual CRGB GetBlackBodyHeatColor(double temp)
+    virtual bool Init(std::shared_ptr<LEDMatrixGFX> gfx)
     {
-        temp *= 255;
-        uint8_t t192 = round((temp/255.0)*191);
- 
-        // calculate ramp up from
-        uint8_t heatramp = t192 & 0x3F; // 0..63
-        heatramp <<= 2; // scale up to 0..252
+        if (!LEDStripEffect::Init(gfx))
+            return false;
 
-        // figure out which third of the spectrum we're in:
-        if( t192 > 0x80) {                     // hottest
-            return CRGB(255, 255, heatramp);
-        } else if( t192 > 0x40 ) {             // middle
-            return CRGB( 255, heatramp, 0);
-        } else {                               // coolest
-            return CRGB( heatramp, 0, 0);     
+        if (!_fire.IsAttached())
+        {
+            if (!_fire.Attach(AllocateBuffer<uint8_t>(FireEngine::Pad + CellCount()), AllocateBuffer<CRGB>(256), CellCount()))
+                return false;
+            FillColors();
         }
+        return true;
     }
 
     virtual void Draw()
@@ -122,66 +362,46 @@ class FireEffect : public LEDStripEffect
 
     virtual void DrawFire()
     {
-        // First cool each cell by a little bit
-
-        EVERY_N_MILLISECONDS(50)
-        {
-          for (int i = 0; i < CellCount(); i++)
-          {
-            int coolingAmount = random(0, Cooling);
-            heat[i] = ::max(0, heat[i] - coolingAmount);
-          }
-        }
-
-        EVERY_N_MILLISECONDS(20)
-        {
-          // Next drift heat up and diffuse it a little bit
-          for (int i = 0; i < CellCount(); i++)
-              heat[i] = std::min(255, (heat[i] * BlendSelf +
-                        heat[(i + 1) % CellCount()] * BlendNeighbor1 +
-                        heat[(i + 2) % CellCount()] * BlendNeighbor2 +
-                        heat[(i + 3) % CellCount()] * BlendNeighbor3)
-                        / BlendTotal);
-        }
+        const uint32_t now = g_AppTime.FrameStartTicks();
 
-        // Randomly ignite new sparks down in the flame kernel
+        // First cool each cell by a little bit
 
-        EVERY_N_MILLISECONDS(20)
+        if (now - _lastCoolTick >= CoolTicks)
         {
-          for (int i = 0 ; i < Sparks; i++)
-          {
-              if (random(255) < Sparking)
-              {
-                  int y = CellCount() - 1 - random(SparkHeight * CellsPerLED);
-                  heat[y] = random(200, 255);   // Can roll over which actually looks good!
-              }
-          }
+            _lastCoolTick = now;
+            _fire.Cool(_random, Cooling);
         }
 
-        // Finally, convert heat to a color
+        // Next drift heat up and diffuse it a little bit, then randomly ignite new sparks down in the flame kernel
 
-        for (int i = 0; i < LEDCount; i++)
+        if (now - _lastDriftTick >= DriftTicks)
         {
+            _lastDriftTick = now;
+            _fire.Diffuse();
 
-            CRGB color = GetBlackBodyHeatColor(heat[i*CellsPerLED]);
-
-            // If we're reversed, we work from the end back.  We don't reverse the bonus pixels
-
-            int j = (!bReversed) ? i : LEDCount - 1 - i;
-            setPixels(j, 1, color, false);
-            if (bMirrored)
-                setPixels(!bReversed ? (2 * LEDCount - 1 - i) : LEDCount + i, 1, color, false);
+            for (int i = 0 ; i < Sparks; i++)
+                if (_random.Range(0, 255) < Sparking)
+                    _fire.Ignite(_random.Range(0, SparkHeight * CellsPerLED), _random.Range(200, 255), FireEngine::SparkMode::Set);
         }
+
+        DrawFlame(false);
     }
 };
 
 class PaletteFlameEffect : public FireEffect
 {
-    CRGBPalette256 _palette;
+    PaletteHandle _palette;                     // Only read when the color table is filled from it
+
+  protected:
+
+    virtual void FillColors()
+    {
+        _fire.FillPalette(*_palette, 240);
+    }
 
 public:
     PaletteFlameEffect(const char *pszName,
-                       const CRGBPalette256 &palette,
+                       PaletteHandle palette,
                        int ledCount = NUM_LEDS,
                        int cellsPerLED = 1,
                        int cooling = 20,         // Was 1.8 for NightDriverStrip
@@ -194,16 +414,6 @@ public:
     {
         _friendlyName = pszName;
     }
-
-    virtual CRGB GetBlackBodyHeatColor(double temp)
-    {
-        temp = min(1.0, temp);
-        int index = mapDouble(temp, 0.0, 1.0, 0.0, 240);
-        return ColorFromPalette(_palette, index, 255);
-
-        //        uint8_t heatramp = (uint8_t)(t192 & 0x3F);
-        //        heatramp <<=2;
-    }
 };
 
 class ClassicFireEffect : public LEDStripEffect
@@ -212,6 +422,8 @@ class ClassicFireEffect : public LEDStripEffect
     bool _Reversed;
     int  _Cooling;
 
+    FireEngine _fire;
+
 public:
 
     ClassicFireEffect(bool mirrored = false, bool reversed = false, int cooling = 5) : LEDStripEffect("Classic Fire")
@@ -219,6 +431,27 @@ public:
         _Mirrored = mirrored;
         _Reversed = reversed;
         _Cooling  = cooling;
+
+        _fire.SetBlend(0, 1, 1, 1, 3);         // The three cells at the base are left to the sparks
+    }
+
+    static constexpr size_t BufferBytes(int ledCount)
+    {
+        return FireEngine::BufferBytes(ledCount);
+    }
+
+    virtual bool Init(std::shared_ptr<LEDMatrixGFX> gfx)
+    {
+        if (!LEDStripEffect::Init(gfx))
+            return false;
+
+        if (!_fire.IsAttached())
+        {
+            if (!_fire.Attach(AllocateBuffer<uint8_t>(FireEngine::Pad + _cLEDs), AllocateBuffer<CRGB>(256), _cLEDs))
+                return false;
+            _fire.FillBlackBody();
+        }
+        return true;
     }
 
     virtual const char *FriendlyName() const
@@ -226,62 +459,38 @@ public:
         return "Classic Fire";
     }
 
-    virtual void Draw()
+    virtual uint16_t PreferredFPS() const
     {
-        //static double lastDraw = 0;
-
-        //if (g_AppTime.FrameStartTime() - lastDraw < 1.0 / 40.0)
-        //    return;
-        //lastDraw = g_AppTime.FrameStartTime();
+        return 40;
+    }
 
+    virtual void Draw()
+    {
         //  Fire(55, 180, 1);               //  The original
         Fire(_Cooling, 180, 5);
-        delay(20);
     }
 
     void Fire(int Cooling, int Sparking, int Sparks)
     {
         setAllOnAllChannels(0,0,0);
 
-        static uint8_t heat[NUM_LEDS];
-        int cooldown;
-
         // Step 1.  Cool down every cell a little
-        for (size_t i = 0; i < _cLEDs; i++)
-        {
-            cooldown = random(0, Cooling);
-
-            if (cooldown > heat[i])
-            {
-                heat[i] = 0;
-            }
-            else
-            {
-                heat[i] = heat[i] - cooldown;
-            }
-        }
+        _fire.Cool(_random, Cooling);
 
         // Step 2.  Heat from each cell drifts 'up' and diffuses a little
-        for (int k = _cLEDs - 1; k >= 3; k--)
-        {
-            heat[k] = (heat[k - 1] + heat[k - 2] + heat[k - 3]) / 3;
-        }
+        _fire.Diffuse();
 
         // Step 3.  Randomly ignite new 'sparks' near the bottom
         for (int frame = 0; frame < Sparks; frame++)
         {
-            if (random(255) < Sparking)
-            {
-                int y = random(5);
-                heat[y] = heat[y] + random(160, 255); // This randomly rolls over sometimes of course, and that's essential to the effect
-            }
+            // This randomly rolls over sometimes of course, and that's essential to the effect
+            if (_random.Range(0, 255) < Sparking)
+                _fire.Ignite(_random.Below(5), _random.Range(160, 255), FireEngine::SparkMode::Add);
         }
 
         // Step 4.  Convert heat to LED colors
         for (size_t j = 0; j < _cLEDs; j++)
-        {
-            setPixelHeatColor(j, heat[j]);
-        }
+            setPixelWithMirror(j, _fire.CellColor(j));
 
         blur1d(_GFX->GetLEDBuffer(), _cLEDs, 255);
     }
@@ -304,32 +513,6 @@ public:
                 setPixel(Pixel, temperature);
         } 
     }
-
-    void setPixelHeatColor(int Pixel, uint8_t temperature)
-    {
-        // Scale 'heat' down from 0-255 to 0-191
-        uint8_t t192 = round((temperature / 255.0) * 191);
-
-        // calculate ramp up from
-        uint8_t heatramp = t192 & 0x3F; // 0..63
-        heatramp <<= 2;              // scale up to 0..252
-
-        // figure out which third of the spectrum we're in:
-        if (t192 > 0x80)
-        { // hottest
-            setPixelWithMirror(Pixel, CRGB(255, 255, heatramp));
-        }
-        else if (t192 > 0x40)
-        { // middle
-            setPixelWithMirror(Pixel, CRGB(255, heatramp, 0));
-        }
-        else
-        { // coolest
-            setPixelWithMirror(Pixel, CRGB(heatramp, 0, 0));
-        }
-    }
-
-
 };
 
 class SmoothFireEffect : public LEDStripEffect
@@ -344,7 +527,7 @@ private:
     bool _Turbo;
     bool _Mirrored;
 
-    float *_Temperatures;
+    FireEngine _fire;
 
 public:
     // Parameter:   Cooling   Sparks    driftPasses  drift sparkHeight   Turbo
@@ -373,99 +556,53 @@ public:
     {
     }
 
-    virtual bool Init(std::shared_ptr<LEDMatrixGFX> gfx)
+    static constexpr size_t BufferBytes(int ledCount)
     {
-        LEDStripEffect::Init(gfx);
-        _Temperatures = (float *)malloc(sizeof(float) * _cLEDs);
-        if (!_Temperatures)
-        {
-            Serial.println("ERROR: Could not allocate memory for FireEffect");
-            return false;
-        }
-        return true;
+        return FireEngine::BufferBytes(ledCount);
     }
 
-    ~SmoothFireEffect()
-    {
-        free(_Temperatures);
-    }
-
-    virtual CRGB GetBlackBodyHeatColor(float temp)
+    virtual bool Init(std::shared_ptr<LEDMatrixGFX> gfx)
     {
-        temp = min(1.0f, temp);
-        uint8_t temperature = (uint8_t)(255 * temp);
-        uint8_t t192 = (uint8_t)((temperature / 255.0f) * 191);
-
-        uint8_t heatramp = (uint8_t)(t192 & 0x3F);
-        heatramp <<= 2;
+        if (!LEDStripEffect::Init(gfx))
+            return false;
 
-        if (t192 > 0x80)
-            return CRGB(255, 255, heatramp);
-        else if (t192 > 0x40)
-            return CRGB(255, heatramp, 0);
-        else
-            return CRGB(heatramp, 0, 0);
+        if (!_fire.IsAttached())
+        {
+            if (!_fire.Attach(AllocateBuffer<uint8_t>(FireEngine::Pad + _cLEDs), AllocateBuffer<CRGB>(256), _cLEDs))
+            {
+                Serial.println("ERROR: Could not allocate memory for FireEffect");
+                return false;
+            }
+            _fire.FillBlackBody();
+        }
+        return true;
     }
 
-    //double lastDraw = 0;
-
     virtual void Draw()
     {
-        //if (g_AppTime.FrameStartTime() - lastDraw < 1.0/33.0)
-        //    return;
-        //lastDraw = g_AppTime.FrameStartTime();
-
-        float deltaTime = (float)g_AppTime.DeltaTime();
+        float deltaTime = FrameDeltaTime();
         setAllOnAllChannels(0, 0, 0);
 
-        float cooldown = randomDouble(0, _Cooling) * deltaTime;
+        _fire.CoolEvenly((uint8_t)min(255.0f, _random.Float(0, _Cooling) * deltaTime * 255.0f + 0.5f));
 
-        for (size_t i = 0; i < _cLEDs; i++)
-            if (cooldown > _Temperatures[i])
-                _Temperatures[i] = 0;
-            else
-                _Temperatures[i] = _Temperatures[i] - cooldown;
+        // Heat from each cell drifts 'up' and diffuses a little, more of it the louder the music is
+        float amount = min(1.0f, 0.2f + gVURatio); // MIN(0.85f, _Drift * deltaTime);
+        uint8_t below = (uint8_t)(amount * 85);
+        _fire.SetBlend(255 - 3 * below, below, below, below, 3);
 
-        // Heat from each cell drifts 'up' and diffuses a little
         for (int pass = 0; pass < _DriftPasses; pass++)
-        {
-            for (int k = _cLEDs - 1; k >= 3; k--)
-            {
-                float amount = 0.2f + gVURatio; // MIN(0.85f, _Drift * deltaTime);
-                float c0 = 1.0f - amount;
-                float c1 = amount * 0.33;
-                float c2 = amount * 0.33;
-                float c3 = amount * 0.33;
-
-                _Temperatures[k] = _Temperatures[k] * c0 +
-                                   _Temperatures[k - 1] * c1 +
-                                   _Temperatures[k - 2] * c2 +
-                                   _Temperatures[k - 3] * c3;
-            }
-        }
+            _fire.Diffuse();
 
         // Randomly ignite new 'sparks' near the bottom
         for (int frame = 0; frame < _Sparks; frame++)
         {
-            if (randomDouble(0, 1.0f) < 0.70f)
-            {
-                // NB: This randomly rolls over sometimes of course, and that's essential to the effect
-                int y = randomDouble(0, _SparkHeight);
-                _Temperatures[y] = (_Temperatures[y] + randomDouble(0.6f, 1.0f));
-
-                if (!_Turbo)
-                    while (_Temperatures[y] > 1.0)
-                        _Temperatures[y] -= 1.0f;
-                else
-                    _Temperatures[y] = min(_Temperatures[y], 1.0f);
-            }
+            // NB: Without turbo this randomly rolls over sometimes of course, and that's essential to the effect
+            if (_random.Below(100) < 70)
+                _fire.Ignite(_random.Range(0, _SparkHeight), _random.Range(153, 256), _Turbo ? FireEngine::SparkMode::AddSaturate : FireEngine::SparkMode::Add);
         }
 
         for (size_t j = 0; j < _cLEDs; j++)
-        {
-            CRGB c = GetBlackBodyHeatColor(_Temperatures[j]);
-            setPixelWithMirror(j, c);
-        }
+            setPixelWithMirror(j, _fire.CellColor(j));
     }
 
     void setPixelWithMirror(int Pixel, CRGB temperature)
@@ -484,114 +621,34 @@ public:
     }
 };
 
-class BaseFireEffect : public LEDStripEffect
-{
-  protected:
-    int     LEDCount;           // Number of LEDs total
-    int     CellCount;          // How many heat cells to represent entire flame
-    int     Cooling;            // Rate at which the pixels cool off
-    int     Sparks;             // How many sparks will be attempted each frame
-    int     SparkHeight;        // If created, max height for a spark
-    int     Sparking;           // Probability of a spark each attempt
-    bool    bReversed;          // If reversed we draw from 0 outwards
-    bool    bMirrored;          // If mirrored we split and duplicate the drawing
-    std::unique_ptr<uint8_t []> heat;
-
-    // When diffusing the fire upwards, these control how much to blend in from the cells below (ie: downward neighbors)
-    // You can tune these coefficients to control how quickly and smoothly the fire spreads
-
-    static const uint8_t BlendSelf = 0;            // 2
-    static const uint8_t BlendNeighbor1 = 1;       // 3
-    static const uint8_t BlendNeighbor2 = 2;       // 2
-    static const uint8_t BlendNeighbor3 = 0;       // 1
-
-    static const uint8_t BlendTotal = (BlendSelf + BlendNeighbor1 + BlendNeighbor2 + BlendNeighbor3);
+// BaseFireEffect
+//
+// FireEffect that cools in proportion to the length of the flame and steps once per frame rather than on timers
 
+class BaseFireEffect : public FireEffect
+{
   public:
 
     BaseFireEffect(int ledCount, int cellsPerLED = 1, int cooling = 20, int sparking = 100, int sparks = 3, int sparkHeight = 4, bool breversed = false, bool bmirrored = false)
-        : LEDStripEffect("BaseFireEffect"),
-          Cooling(cooling),
-          Sparks(sparks),
-          SparkHeight(sparkHeight),
-          Sparking(sparking),
-          bReversed(breversed),
-          bMirrored(bmirrored)
+        : FireEffect(ledCount, cellsPerLED, cooling, sparking, sparks, sparkHeight, breversed, bmirrored)
     {
-        LEDCount = bmirrored ? ledCount / 2 : ledCount;
-        CellCount = LEDCount * cellsPerLED;
-
-        heat = std::make_unique<uint8_t []>(CellCount);
+        _friendlyName = "BaseFireEffect";
     }
 
-    virtual ~BaseFireEffect()
-    {
-    }
-
-    virtual CRGB MapHeatToColor(uint8_t temperature)
-    {
-        uint8_t t192 = round((temperature/255.0)*191);
- 
-        // calculate ramp up from
-        uint8_t heatramp = t192 & 0x3F; // 0..63
-        heatramp <<= 2; // scale up to 0..252
-
-        // figure out which third of the spectrum we're in:
-        if( t192 > 0x80) {                     // hottest
-            return CRGB(255, 255, heatramp);
-        } else if( t192 > 0x40 ) {             // middle
-            return CRGB( 255, heatramp, 0);
-        } else {                               // coolest
-            return CRGB( heatramp, 0, 0);     
-        }
-    }
-
-    virtual void Draw()
+    virtual uint16_t PreferredFPS() const
     {
-        _GFX->clearPixels();
-        DrawFire();
-        delay(120);
+        return 8;
     }
 
     virtual void DrawFire()
     {
-        // First cool each cell by a little bit
-        for (int i = 0; i < CellCount; i++)
-            heat[i] = max(0L, heat[i] - random(0, ((Cooling * 10) / CellCount) + 2));
-
-        // Next drift heat up and diffuse it a little bit
-        for (int i = 0; i < CellCount; i++)
-            heat[i] = min(255, (heat[i] * BlendSelf +
-                       heat[(i + 1) % CellCount] * BlendNeighbor1 +
-                       heat[(i + 2) % CellCount] * BlendNeighbor2 +
-                       heat[(i + 3) % CellCount] * BlendNeighbor3)
-                      / BlendTotal);
-
-        // Randomly ignite new sparks down in the flame kernel
+        _fire.Cool(_random, ((Cooling * 10) / CellCount()) + 2);
+        _fire.Diffuse();
 
         for (int i = 0 ; i < Sparks; i++)
-        {
-            if (random(255) < Sparking)
-            {
-                int y = CellCount - 1 - random(SparkHeight * CellCount / LEDCount);
-                heat[y] = random(200, 255);// heat[y] + random(50, 255);       // Can roll over which actually looks good!
-            }
-        }
-
-        // Finally, convert heat to a color
+            if (_random.Range(0, 255) < Sparking)
+                _fire.Ignite(_random.Range(0, SparkHeight * CellsPerLED), _random.Range(200, 255), FireEngine::SparkMode::Set);
 
-        int cellsPerLED = CellCount / LEDCount;
-        for (int i = 0; i < LEDCount; i++)
-        {
-            int sum = 0;
-            for (int iCell = 0; iCell < cellsPerLED; iCell++)
-              sum += heat[i * cellsPerLED + iCell];
-            int avg = sum / cellsPerLED;
-            CRGB color = MapHeatToColor(heat[avg]);
-            int j = bReversed ? (LEDCount - 1 - i) : i;
-            setPixels(j, 1, color, true);
-            if (bMirrored)
-                setPixels(!bReversed ? (2 * LEDCount - 1 - i) : LEDCount + i, 1, color, true);
-        }
+        DrawFlame(true);
     }
-};
\ No newline at end of file
+};
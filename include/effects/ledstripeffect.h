@@ -38,11 +38,16 @@
 #include "globals.h"
 #include "colorutils.h"
 #include "ledmatrixgfx.h"
+#include "fastrandom.h"
+#include "pixelkernels.h"
+#include "hdraccumulator.h"
+#include "effectArena.h"
 #include "ntptimeclient.h"
 
-#include <deque>
 #include <memory>
 
+extern AppTime g_AppTime;
+
 // LEDStripEffect
 //
 // Base class for an LED strip effect.  At a minimum they must draw themselves and provide a unique name.
@@ -52,22 +57,47 @@ class LEDStripEffect
   protected:
 
 	size_t _cLEDs;
-	String _friendlyName;
+	const char * _friendlyName;                 // Names are string literals, so effects in an arena never touch the heap
 
     std::shared_ptr<LEDMatrixGFX> _GFX;
+    HDRAccumulator * _HDR;                      // Only allocated by effects that composite additively, see EnableHDR
+    EffectArena * _pArena;                      // Where the effect was built, its buffers come from here too
+    FastRandom _random;                         // The effect's own random numbers, see Seed
+    uint32_t _lastFrameTick;                    // AppTime tick of the effect's last frame, see DrawFrame
+    uint32_t _frameDeltaTicks;                  // Ticks between the effect's last two frames
+
+    // AllocateBuffer
+    //
+    // Zeroed buffer of count T from the effect's arena.  NULL if it does not fit, or if the effect was
+    // not built in an arena at all.
 
-    inline static double randomDouble(double lower, double upper)
+    template <typename T>
+    T * AllocateBuffer(size_t count)
     {
-        double result = (lower + ((upper - lower) * rand()) / RAND_MAX);
-        return result;
+        return _pArena ? _pArena->AllocateArray<T>(count) : NULL;
     }
 
+    // FrameDeltaTime
+    //
+    // Seconds since the effect's previous frame.  Channels and effects each run at their own rate, so this
+    // rather than AppTime's delta is what an effect should animate by.
+
+    float FrameDeltaTime() const
+    {
+        return _frameDeltaTicks * (1.0f / MICROS_PER_SECOND);
+    }
+
+    // Effects draw a frame and return, the effects manager paces them, see PreferredFPS.  Declaring delay
+    // here makes a call to it from any effect a compile error rather than a stall of every channel.
+
+    static void delay(unsigned long) = delete;
+
   public:
 
 	LEDStripEffect(const char * pszName)
+		: _cLEDs(0), _friendlyName(pszName), _HDR(NULL), _pArena(NULL), _random(g_EffectSeeds.Next()),
+		  _lastFrameTick(0), _frameDeltaTicks(0)
 	{
-		if (pszName)
-			_friendlyName = pszName;
 	}
 
 	virtual ~LEDStripEffect()
@@ -82,19 +112,93 @@ class LEDStripEffect
 
 		_GFX = gfx;    
         _cLEDs = _GFX->GetLEDCount();      
+		_lastFrameTick = g_AppTime.FrameStartTicks();
 		//Serial.printf("Init Effect %s with %d LEDs\n", _friendlyName.c_str(), _cLEDs);
 		return true;  
     }
 	virtual void Draw() = 0;										// Your effect must implement these
+
+	// PreferredFPS
+	//
+	// Most frames a second the effect wants drawn, 0 to run at the channel's rate.  The channel's rate
+	// still caps it.
+
+	virtual uint16_t PreferredFPS() const
+	{
+		return 0;
+	}
+
+	// OutputBrightness
+	//
+	// How much of the channel's brightness the effect is shown at, of 255.  Effects draw full scale colors
+	// and an effect meant to be dimmer says so here, the channel's output stage does the dimming.
+
+	virtual uint8_t OutputBrightness() const
+	{
+		return 255;
+	}
+
+	// DrawFrame
+	//
+	// What the effects manager calls when the effect is due a frame.  Notes how long it has been since the
+	// last one, for FrameDeltaTime, then draws.
+
+	void DrawFrame()
+	{
+		const uint32_t now = g_AppTime.FrameStartTicks();
+		_frameDeltaTicks = ::min<uint32_t>(now - _lastFrameTick, MAX_DELTA_TICKS);
+		_lastFrameTick = now;
+		Draw();
+	}
+
+	// SetArena
+	//
+	// Called by the factory once it has built the effect, before Init
+
+	void SetArena(EffectArena * pArena)
+	{
+		_pArena = pArena;
+	}
+
+	// Seed
+	//
+	// Restarts the effect's random numbers from the given seed, so that the same seed draws the same frames
+	
+	void Seed(uint32_t seed)
+	{
+		_random.Seed(seed);
+	}
+
+	// EnableHDR
+	//
+	// Gives the effect a high range accumulator for addPixels to draw into.  Whoever enables it calls
+	// resolveHDR once the frame is drawn.  Sub-effects can be handed the same accumulator with ShareHDR.
+	// The accumulator lives in the effect's arena, so this fails if it does not fit.
+
+	bool EnableHDR()
+	{
+		if (!_HDR && _pArena)
+		{
+			void * p = _pArena->Allocate(sizeof(HDRAccumulator), alignof(HDRAccumulator));
+			if (p)
+				_HDR = new (p) HDRAccumulator();
+		}
+		return _HDR != NULL;
+	}
+
+	void ShareHDR(HDRAccumulator * pHDR)
+	{
+		_HDR = pHDR;
+	}
 	
 	virtual const char *FriendlyName() const
 	{
-		if (_friendlyName.length() > 0)
-			return _friendlyName.c_str();
+		if (_friendlyName && *_friendlyName)
+			return _friendlyName;
 		return "Unnamed Effect";
 	}
 
-	static inline CRGB RandomRainbowColor()
+	inline CRGB RandomRainbowColor()
 	{
 		static const CRGB colors[] =
 			{
@@ -105,30 +209,34 @@ class LEDStripEffect
 				CRGB::Indigo,
 				CRGB::Violet
             };
-		int randomColorIndex = (int)randomDouble(0, ARRAYSIZE(colors));
+		int randomColorIndex = _random.Below(ARRAYSIZE(colors));
 		return colors[randomColorIndex];
 	}
 
-	static inline CRGB RandomSaturatedColor()
+	inline CRGB RandomSaturatedColor()
 	{
 		CRGB c;
-		c.setHSV((uint8_t)randomDouble(0, 255), 255, 255);
+		c.setHSV((uint8_t)_random.Below(255), 255, 255);
 		return c;
 	}
 
 	void fillSolidOnAllChannels(CRGB color, size_t iStart = 0, size_t numToFill = 0,  unsigned int everyN = 1)
 	{
 		if (numToFill == 0)
-			numToFill = _cLEDs-iStart;
+			numToFill = LEDMatrixGFX::LEDCount - iStart;
 
-		if (iStart + numToFill > _cLEDs)
+		if (iStart + numToFill > LEDMatrixGFX::LEDCount)
 		{
 			Println("Boundary Exceeded in FillRainbow");
 			return;
 		}
-			
-		for (size_t i = iStart; i < numToFill; i+= everyN)
-			setPixel(i, color);
+
+		LEDMatrixGFX & gfx = *_GFX;
+		if (everyN == 1)
+			fillSpan(gfx.GetLEDBuffer() + iStart, numToFill, color);
+		else
+			for (size_t i = iStart; i < iStart + numToFill; i += everyN)
+				gfx[i] = color;
 	}
 
 	void fillRainbowAllChannels(size_t iStart, size_t numToFill, uint8_t initialhue, uint8_t deltahue, uint8_t everyNth = 1) const
@@ -158,21 +266,27 @@ class LEDStripEffect
 
 	inline void fadePixelToBlackOnAllChannelsBy(int pixel, uint8_t fadeValue) const
 	{
-		CRGB crgb = _GFX->getPixel(pixel);
-		crgb.fadeToBlackBy(fadeValue);
-		_GFX->GetLEDBuffer()[pixel] = crgb;
+		if (LEDMatrixGFX::isValid(pixel))
+			(*_GFX)[pixel].fadeToBlackBy(fadeValue);
 	}
 
 	inline void fadeAllChannelsToBlackBy(uint8_t fadeValue) const
 	{
-		for (size_t i = 0; i < _cLEDs; i++)
-			fadePixelToBlackOnAllChannelsBy(i, fadeValue);
+		fadeSpanToBlackBy(_GFX->GetLEDBuffer(), LEDMatrixGFX::LEDCount, fadeValue);
+	}
+
+	// fadeRandomPixelsToBlackBy
+	//
+	// Fades about half the pixels (three quarters if bDense) by fadeValue, for sparkly trails
+
+	inline void fadeRandomPixelsToBlackBy(uint8_t fadeValue, bool bDense = false)
+	{
+		stochasticFadeSpan(_GFX->GetLEDBuffer(), LEDMatrixGFX::LEDCount, fadeValue, [this]() { return _random.Next(); }, bDense);
 	}
 
 	inline void setAllOnAllChannels(uint8_t r, uint8_t g, uint8_t b) const
 	{
-		for (size_t i = 0; i < _cLEDs; i++)
-			setPixel(i, r, g, b);
+		fillSpan(_GFX->GetLEDBuffer(), LEDMatrixGFX::LEDCount, CRGB(r, g, b));
 	}
 
 	// setPixel
@@ -185,29 +299,60 @@ class LEDStripEffect
             _GFX[0]->drawPixel(STRAND_LEDS/2 + pixel, CRGB(r, g, b));
             _GFX[0]->drawPixel(STRAND_LEDS/2 - pixel, CRGB(r, g, b));
 		#else
-			if (pixel < 0 || pixel >= _cLEDs)
+			if (pixel >= _cLEDs)
 			{
-				Serial.printf("Bad pixel index: %d\n", pixel);
+				Serial.printf("Bad pixel index: %u\n", (unsigned)pixel);
 				return;
 			}
-			setPixels(pixel, 1, CRGB(r, g, b), false);
+			(*_GFX)[pixel] = CRGB(r, g, b);
 		#endif
 	}
 
 	inline void setPixel(int pixel, const CRGB & color) const
 	{
-		setPixels(pixel, 1, color, false);
+		if (LEDMatrixGFX::isValid(pixel))
+			(*_GFX)[pixel] = color;
 	}
 
 	inline CRGB getPixel(int pixel) const
 	{
-		return _GFX->getPixel(pixel, 0);
+		return _GFX->getPixel(pixel);
+	}
+
+	// setPixelsQ8 - Draw pixels with 1/256th pixel accuracy by dimming/fading the lead/exit pixels
+
+	inline void setPixelsQ8(int32_t pos, int32_t count, CRGB c, bool bMerge = false) const
+	{
+		_GFX->setPixelsQ8(pos, count, c, bMerge);
 	}
 
-	// setPixels - Draw pixels with floating point accuracy by dimming/fading the lead/exit pixels
+	// setPixels - Floating point wrapper around setPixelsQ8
 
 	inline void setPixels(float fPos, float count, CRGB c, bool bMerge = false) const
 	{
 		_GFX->setPixels(fPos, count, c, bMerge);
 	}
+
+	// addPixelsQ8 - Adds light into the HDR accumulator, or merges straight into the frame if there is none
+
+	inline void addPixelsQ8(int32_t pos, int32_t count, CRGB c) const
+	{
+		if (_HDR)
+			_HDR->addPixelsQ8(pos, count, c);
+		else
+			_GFX->setPixelsQ8(pos, count, c, true);
+	}
+
+	inline void addPixels(float fPos, float count, CRGB c) const
+	{
+		addPixelsQ8(LEDMatrixGFX::toQ8(fPos), LEDMatrixGFX::toQ8(count), c);
+	}
+
+	// resolveHDR - Tone maps whatever was added this frame onto the frame, see HDRAccumulator::ResolveOnto
+
+	inline void resolveHDR(int averageShift = 0) const
+	{
+		if (_HDR)
+			_HDR->ResolveOnto(_GFX->GetLEDBuffer(), averageShift);
+	}
 };
@@ -46,11 +46,11 @@ extern AppTime g_AppTime;
 
 class MeteorChannel
 {
-	vector<float> hue;
-	vector<float> iPos;
-	vector<bool>  bLeft;
-	vector<float> speed;
-	vector<double> lastBeat;
+	float  * hue;                               // Per meteor state, carved from the effect arena in Init
+	float  * iPos;
+	bool   * bLeft;
+	float  * speed;
+	uint32_t * lastBeat;                        // AppTime ticks
 
 public:
 
@@ -60,28 +60,46 @@ public:
 	double        meteorSpeedMin;
 	double        meteorSpeedMax;
 	bool 	      meteorRandomDecay = true;
-	const double  minTimeBetweenBeats = 0.6;
+	const uint32_t minTicksBetweenBeats = 600000;
 
 	MeteorChannel() 
+	  : hue(NULL), iPos(NULL), bLeft(NULL), speed(NULL), lastBeat(NULL), meteorCount(0)
 	{
 	
 	}
 
-	virtual void Init(std::shared_ptr<LEDMatrixGFX> pGFX, size_t meteors = 4, unsigned int size = 4, unsigned int decay = 3, double minSpeed = 0.5, double maxSpeed = 0.5)
+	// BufferBytes - How much of the effect arena Init takes for the given number of meteors
+
+	static constexpr size_t BufferBytes(size_t meteors)
+	{
+		return 3 * ArenaBytes(sizeof(float) * meteors) + ArenaBytes(sizeof(bool) * meteors) + ArenaBytes(sizeof(uint32_t) * meteors);
+	}
+
+	virtual bool Init(std::shared_ptr<LEDMatrixGFX> pGFX, EffectArena * pArena, FastRandom & random, size_t meteors = 4, unsigned int size = 4, unsigned int decay = 3, double minSpeed = 0.5, double maxSpeed = 0.5)
 	{
-		meteorCount = meteors;
 		meteorSize = size;
 		meteorTrailDecay = decay;
 		meteorSpeedMin = minSpeed;
 		meteorSpeedMax = maxSpeed;
 
-		hue.resize(meteors);
-		iPos.resize(meteors);
-		bLeft.resize(meteors);
-		speed.resize(meteors);
-		lastBeat.resize(meteors);
+		if (hue == NULL)
+		{
+			if (pArena == NULL)
+				return false;
+
+			hue      = pArena->AllocateArray<float>(meteors);
+			iPos     = pArena->AllocateArray<float>(meteors);
+			bLeft    = pArena->AllocateArray<bool>(meteors);
+			speed    = pArena->AllocateArray<float>(meteors);
+			lastBeat = pArena->AllocateArray<uint32_t>(meteors);
+			if (!hue || !iPos || !bLeft || !speed || !lastBeat)
+				return false;
+		}
+		else if (meteors > meteorCount)
+			return false;
+		meteorCount = meteors;
 
-		static int hueval = HUE_RED;
+		int hueval = HUE_RED;
 		for (size_t i = 0; i < meteorCount; i++)
 		{
             hueval = hueval + 48;
@@ -89,10 +107,11 @@ public:
 			hue[i] = hueval;
 			iPos[i] = (pGFX->GetLEDCount() / meteorCount) * i;
 			//bLeft[i] = (bool) randomDouble(0, 1);
-			speed[i] = randomDouble(meteorSpeedMin, meteorSpeedMax);
-			lastBeat[i] = g_AppTime.FrameStartTime();
+			speed[i] = random.Float(meteorSpeedMin, meteorSpeedMax);
+			lastBeat[i] = g_AppTime.FrameStartTicks();
 			bLeft[i] = i & 2;
 		}
+		return true;
 	}
 
 	virtual void Reverse(int iMeteor)
@@ -100,27 +119,22 @@ public:
 		bLeft[iMeteor] = !bLeft[iMeteor];
 	}
 
-	virtual void Draw(std::shared_ptr<LEDMatrixGFX> pGFX)
+	virtual void Draw(const std::shared_ptr<LEDMatrixGFX> & pGFX, FastRandom & random)
 	{
 		static CHSV hsv;
 		hsv.val = 255;
 		hsv.sat = 240;
 
-		for (size_t j = 0; j < pGFX->GetLEDCount(); j++)							// fade brightness all LEDs one step
-        {
-			if ((!meteorRandomDecay) || (randomDouble(0, 10)>2))			// BUGBUG Was 5 for everything before atomlight 
-            {
-                CRGB c = pGFX->getPixel(j, 0);
-                c.fadeToBlackBy(meteorTrailDecay);
-                pGFX->drawPixel(j, c);
-            }
-        }
+		if (meteorRandomDecay)                                              // fade brightness of most LEDs one step
+			stochasticFadeSpan(pGFX->GetLEDBuffer(), pGFX->GetLEDCount(), meteorTrailDecay, [&random]() { return random.Next(); }, true);  // BUGBUG Was half for everything before atomlight
+		else
+			fadeSpanToBlackBy(pGFX->GetLEDBuffer(), pGFX->GetLEDCount(), meteorTrailDecay);
 
 			// If there's a beat to the music in a band, reverse the direction of the meteor indexed by the same number
 		/*			
-		if (g_Beats.IsBeat[0] && (g_AppTime.FrameStartTime() - lastBeat[0] > minTimeBetweenBeats))
+		if (g_Beats.IsBeat[0] && (g_AppTime.FrameStartTicks() - lastBeat[0] > minTicksBetweenBeats))
 		{
-			lastBeat[0] = g_AppTime.FrameStartTime();
+			lastBeat[0] = g_AppTime.FrameStartTicks();
 			for (int j = 0; j < meteorCount; j++)
 				Reverse(j);
 		}
@@ -154,7 +168,7 @@ public:
 					hsv.hue = hue[i];
 					hsv2rgb_rainbow(hsv, rgb);
 					int x = iPos[i] - j;
-                    nblend(pGFX->GetLEDBuffer()[x], rgb, 75);						
+                    nblend((*pGFX)[x], rgb, 75);						
 				}
 			}
 		}
@@ -165,7 +179,6 @@ class MeteorEffect : public LEDStripEffect
 {
   private:
 	MeteorChannel   _Meteors;
-    std::shared_ptr<LEDMatrixGFX> * _gfx;
 
 	int				_cMeteors;
 	uint8_t         _meteorSize;
@@ -186,17 +199,15 @@ class MeteorEffect : public LEDStripEffect
 
     virtual bool Init(std::shared_ptr<LEDMatrixGFX> gfx)	
     {
-        _gfx = &gfx;
         if (!LEDStripEffect::Init(gfx))
             return false;
         
-		_Meteors.Init(gfx, _cMeteors, _meteorSize, _meteorTrailDecay, _meteorSpeedMin, _meteorSpeedMax);
-        return true;
+		return _Meteors.Init(gfx, _pArena, _random, _cMeteors, _meteorSize, _meteorTrailDecay, _meteorSpeedMin, _meteorSpeedMax);
     }
 
 	virtual void Draw() 
     {
-		_Meteors.Draw(*_gfx);
+		_Meteors.Draw(_GFX, _random);
     }
 	
     virtual const char * FriendlyName() const
@@ -35,6 +35,7 @@
 #include <errno.h>
 #include <iostream>
 #include <vector>
+#include <deque>
 #include <math.h>
 #define FASTLED_INTERNAL 1
 #include "FastLED.h"
@@ -63,7 +64,6 @@ public:
 	virtual void Draw()
 	{
 		fillRainbowAllChannels(0, _cLEDs, beatsin16(4, 0, 256), 8, _EveryNth);
-		delay(10);
 	}
 
 	virtual const char *FriendlyName() const
@@ -81,30 +81,24 @@ class RainbowTwinkleEffect : public LEDStripEffect
 private:
 	float _speedDivisor;
 	int _deltaHue;
+	float _hue;
 
 public:
 	RainbowTwinkleEffect(float speedDivisor = 12.0f, int deltaHue = 14)
 		: LEDStripEffect("RainowFill Rainbow"),
 		  _speedDivisor(speedDivisor),
-		  _deltaHue(deltaHue)
+		  _deltaHue(deltaHue),
+		  _hue(0.0f)
 	{
 	}
 
 	virtual void Draw()
 	{
-		static float hue = 0.0f;
-		static unsigned long lastms = millis();
+		_hue += FrameDeltaTime() * MILLIS_PER_SECOND / _speedDivisor;
+		_hue = fmod(_hue, 256.0);
+		fillRainbowAllChannels(0, _cLEDs, _hue, _deltaHue);
 
-		unsigned long msElapsed = millis() - lastms;
-		lastms = millis();
-
-		hue += (float)msElapsed / _speedDivisor;
-		hue = fmod(hue, 256.0);
-		fillRainbowAllChannels(0, _cLEDs, hue, _deltaHue);
-
-		if (random(0, 1) == 0)
-			setPixel(random(0, _cLEDs), CRGB::White);
-		delay(10);
+		setPixel(_random.Below(_cLEDs), CRGB::White);                  // random(0, 1) was always 0, so this always sparkled
 	}
 
 	virtual const char *FriendlyName() const
@@ -123,27 +117,22 @@ private:
 protected:
 	float _speedDivisor;
 	int _deltaHue;
+	float _hue;
 
 public:
 	RainbowFillEffect(float speedDivisor = 12.0f, int deltaHue = 14)
 		: LEDStripEffect("RainowFill Rainbow"),
 		  _speedDivisor(speedDivisor),
-		  _deltaHue(deltaHue)
+		  _deltaHue(deltaHue),
+		  _hue(0.0f)
 	{
 	}
 
 	virtual void Draw()
 	{
-		static float hue = 0.0f;
-		static unsigned long lastms = millis();
-
-		unsigned long msElapsed = millis() - lastms;
-		lastms = millis();
-
-		hue += (float)msElapsed / _speedDivisor;
-		hue = fmod(hue, 256.0);
-		fillRainbowAllChannels(0, _cLEDs, hue, _deltaHue);
-		delay(10);
+		_hue += FrameDeltaTime() * MILLIS_PER_SECOND / _speedDivisor;
+		_hue = fmod(_hue, 256.0);
+		fillRainbowAllChannels(0, _cLEDs, _hue, _deltaHue);
 	}
 
 	virtual const char *FriendlyName() const
@@ -224,21 +213,32 @@ public:
 		return _error;
 	}
 
-	virtual void Draw()
+	CRGB getErrorColor() const
 	{
-		CRGB color = _color;
-
 		if (_error == ERROR::GENERAL)
-			color = CRGB::Red;
+			return CRGB::Red;
 		else if (_error == ERROR::WIFI)
-			color = CRGB::Orange;
+			return CRGB::Orange;
 		else if (_error == ERROR::MQTT)
-			color = CRGB::Purple;
+			return CRGB::Purple;
 		else
-			color = CRGB::Green;
+			return CRGB::Green;
+	}
 
+	virtual void Draw()
+	{
 		fillSolidOnAllChannels(CRGB::Black);
-		fillSolidOnAllChannels(color, 0, 0, _everyNth);
+		fillSolidOnAllChannels(getErrorColor(), 0, 0, _everyNth);
+	}
+
+	// DrawOverlay
+	//
+	// Marks the error over whatever effect is running, on the first STATUS_OVERLAY_PIXELS pixels, so the effect
+	// keeps playing while the station is offline
+
+	void DrawOverlay()
+	{
+		fillSolidOnAllChannels(getErrorColor(), 0, STATUS_OVERLAY_PIXELS);
 	}
 
 	virtual const char *FriendlyName() const
@@ -270,16 +270,25 @@ protected:
 	size_t _countToDraw;
 	int _fadeFactor;
 	int _updateSpeed;
+	uint32_t _lastFadeTick;
 
 public:
 	TwinkleEffect(size_t countToDraw = NUM_LEDS / 2, uint8_t fadeFactor = 10, int updateSpeed = 10)
 		: LEDStripEffect("Twinkle"),
 		  _countToDraw(countToDraw),
 		  _fadeFactor(fadeFactor),
-		  _updateSpeed(updateSpeed)
+		  _updateSpeed(updateSpeed),
+		  _lastFadeTick(0)
 	{
 	}
 
+	// One new twinkle per frame, so the frame rate is the update speed
+
+	virtual uint16_t PreferredFPS() const
+	{
+		return 1000 / ::max(_updateSpeed, 1);
+	}
+
 	const int Count = 99;
 	int buffer[99] = {0};
 
@@ -288,44 +297,42 @@ public:
 	virtual void Draw()
 	{
 		CRGB *pPixels = _GFX->GetLEDBuffer();
-		EVERY_N_MILLISECONDS(_updateSpeed)
+		if (litPixels.size() > _countToDraw)
 		{
-			if (litPixels.size() > _countToDraw)
-			{
-				size_t i = litPixels.back();
-				litPixels.pop_back();
-				pPixels[i] = CRGB::Black;
-			}
+			size_t i = litPixels.back();
+			litPixels.pop_back();
+			pPixels[i] = CRGB::Black;
+		}
 
-			// Pick a random pixel and put it in the TOP slot
-			int iNew = -1;
-			for (int iPass = 0; iPass < NUM_LEDS * 10; iPass++)
-			{
-				size_t i = random(0, NUM_LEDS);
-				if (pPixels[i] != CRGB(0, 0, 0))
-					continue;
-				iNew = i;
-				break;
-			}
-			if (iNew == -1) // No empty slot could be found!
-			{
-				litPixels.clear();
-				setAllOnAllChannels(0, 0, 0);
-				return;
-			}
+		// Pick a random pixel and put it in the TOP slot
+		int iNew = -1;
+		for (int iPass = 0; iPass < NUM_LEDS * 10; iPass++)
+		{
+			size_t i = _random.Below(NUM_LEDS);
+			if (pPixels[i] != CRGB(0, 0, 0))
+				continue;
+			iNew = i;
+			break;
+		}
+		if (iNew == -1) // No empty slot could be found!
+		{
+			litPixels.clear();
+			setAllOnAllChannels(0, 0, 0);
+			return;
+		}
 
-			assert(litPixels.end() == find(litPixels.begin(), litPixels.end(), iNew));
-			pPixels[iNew] = TwinkleColors[random(0, ARRAYSIZE(TwinkleColors))];
+		assert(litPixels.end() == find(litPixels.begin(), litPixels.end(), iNew));
+		pPixels[iNew] = TwinkleColors[_random.Below(ARRAYSIZE(TwinkleColors))];
 
-			if (pPixels[iNew] == CRGB(0, 0, 0))
-			{
-			}
-
-			litPixels.push_front(iNew);
+		if (pPixels[iNew] == CRGB(0, 0, 0))
+		{
 		}
 
-		EVERY_N_MILLISECONDS(20)
+		litPixels.push_front(iNew);
+
+		if (g_AppTime.FrameStartTicks() - _lastFadeTick >= 20000)
 		{
+			_lastFadeTick = g_AppTime.FrameStartTicks();
 			fadeToBlackBy(FastLED.leds(), NUM_LEDS, _fadeFactor);
 		}
 	}
@@ -366,18 +373,20 @@ public:
 		return true;
 	}
 
+	virtual uint16_t PreferredFPS() const
+	{
+		return 50;
+	}
+
 	virtual void Draw()
 	{
-		EVERY_N_MILLISECONDS(20)
-		{
-			fadeToBlackBy(pLeds, NUM_LEDS, 64);
-			int iPos = beatsin16(32, 0, NUM_LEDS - m_iCometSize);
+		fadeToBlackBy(pLeds, NUM_LEDS, 64);
+		int iPos = beatsin16(32, 0, NUM_LEDS - m_iCometSize);
 
-			uint8_t hue = beatsin8(60);
+		uint8_t hue = beatsin8(60);
 
-			for (int i = iPos; i < iPos + m_iCometSize; i++)
-				setPixel(i, CHSV(hue, 255, 255));
-		}
+		for (int i = iPos; i < iPos + m_iCometSize; i++)
+			setPixel(i, CHSV(hue, 255, 255));
 	}
 };
 
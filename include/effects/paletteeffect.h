@@ -52,7 +52,7 @@ class PaletteEffect : public LEDStripEffect
 
     float _startIndex;
     float _paletteIndex;
-    const CRGBPalette256 _palette;
+    const PaletteHandle _palette;
     const float _density;
     const float _paletteSpeed;
     const float  _lightSize;
@@ -60,11 +60,21 @@ class PaletteEffect : public LEDStripEffect
     const float _LEDSPerSecond;
     const TBlendType  _blend;
     const bool  _bErase;
-    const float _brightness;
+    const uint8_t _brightness;                  // Left to the output stage, see OutputBrightness
+
+    // Lights are added when sharing an HDR accumulator with another effect, otherwise they replace what is there
+
+    inline void drawLightQ8(int32_t pos, int32_t count, CRGB c) const
+    {
+        if (_HDR)
+          addPixelsQ8(pos, count, c);
+        else
+          setPixelsQ8(pos, count, c, false);
+    }
 
   public:
 
-    PaletteEffect(const CRGBPalette256 & palette, 
+    PaletteEffect(PaletteHandle palette, 
                   float density = 4.0,                
                   float paletteSpeed = 0.25, 
                   float ledsPerSecond = 0.1, 
@@ -84,7 +94,7 @@ class PaletteEffect : public LEDStripEffect
         _LEDSPerSecond(ledsPerSecond),
         _blend(blend),
         _bErase(bErase),
-        _brightness(brightness)
+        _brightness((uint8_t)(255 * brightness))
     {
         _paletteIndex = 0.0f;
     }
@@ -98,7 +108,7 @@ class PaletteEffect : public LEDStripEffect
         if (_bErase)
           setAllOnAllChannels(0,0,0);
 
-        float deltaTime = g_AppTime.DeltaTime();
+        float deltaTime = FrameDeltaTime();
         float increment = (deltaTime * _LEDSPerSecond);      
         const int totalSize = _gapSize + _lightSize + 1;
         _startIndex   = totalSize > 1 ? fmodf(_startIndex + increment, totalSize) : 0;
@@ -112,10 +122,12 @@ class PaletteEffect : public LEDStripEffect
 
         if (_gapSize == 0)
         {
-          for (size_t i = 0; i < _cLEDs; i+=_lightSize)
+          const int32_t lightSizeQ8 = std::max<int32_t>(1, LEDMatrixGFX::toQ8(_lightSize));
+          const int32_t endQ8 = LEDMatrixGFX::toQ8((int)_cLEDs);
+          for (int32_t pos = 0; pos < endQ8; pos += lightSizeQ8)
           {
             iColor = fmodf(iColor + _density, 256);
-            setPixels(i, _lightSize, ColorFromPalette(_palette, iColor, 255 * _brightness, _blend), false);
+            drawLightQ8(pos, lightSizeQ8, ColorFromPalette(*_palette, iColor, 255, _blend));
           }
         }
         else
@@ -132,13 +144,18 @@ class PaletteEffect : public LEDStripEffect
               int index = fmodf(i, totalSize);
               if (index == 0)
               {
-                  CRGB c = ColorFromPalette(_palette, iColor, 255 * _brightness, _blend);
-                  setPixels(i+_startIndex, _lightSize, c,false);
+                  CRGB c = ColorFromPalette(*_palette, iColor, 255, _blend);
+                  drawLightQ8(LEDMatrixGFX::toQ8(i+_startIndex), LEDMatrixGFX::toQ8(_lightSize), c);
               }
           }
         }
     }
 
+    virtual uint8_t OutputBrightness() const
+    {
+        return _brightness;
+    }
+
     virtual const char * FriendlyName() const
     {
         return "Palette Effect";
@@ -53,20 +53,27 @@ class Lifespan
 {
   protected:
 
-    double                       _birthTime;
+    uint32_t                     _birthTick;
 
   public:
 
-    Lifespan() :_birthTime(g_AppTime.FrameStartTime())
+    Lifespan() :_birthTick(g_AppTime.FrameStartTicks())
     {
     }
 
     virtual ~Lifespan()
     {}    
 
+    // AgeTicks - Microseconds since the frame the object was born in
+
+    uint32_t AgeTicks() const
+    {
+        return g_AppTime.FrameStartTicks() - _birthTick;
+    }
+
     double Age() const
     {
-        return g_AppTime.FrameStartTime() - _birthTime;
+        return AgeTicks() / (double) MICROS_PER_SECOND;
     }    
 
     virtual double TotalLifetime() const = 0;
@@ -89,17 +96,17 @@ public:
 
     double                       _iPos;
 
-    MovingObject(double maxSpeed = 0.25) : _maxSpeed(maxSpeed)
+    MovingObject(FastRandom & random, double maxSpeed = 0.25) : _maxSpeed(maxSpeed)
     {
-        _velocity = randomDouble(0, _maxSpeed * 2) - _maxSpeed;
+        _velocity = random.Float(-_maxSpeed, _maxSpeed);
     }
 
     virtual ~MovingObject()
     {}
 
-    virtual void UpdatePosition()
+    virtual void UpdatePosition(float deltaTime)
     {
-        _iPos += _velocity * g_AppTime.DeltaTime();
+        _iPos += _velocity * deltaTime;
     }
 };
 
@@ -237,9 +244,9 @@ class MovingFadingPaletteObject: public FadingPaletteObject, public MovingObject
 {
   public:
 
-    MovingFadingPaletteObject(const CRGBPalette256 & palette, TBlendType blendType = NOBLEND, double maxSpeed = 1.0, uint8_t colorIndex = 0)
+    MovingFadingPaletteObject(FastRandom & random, const CRGBPalette256 & palette, TBlendType blendType = NOBLEND, double maxSpeed = 1.0, uint8_t colorIndex = 0)
       : FadingPaletteObject(palette, blendType, colorIndex), 
-        MovingObject(maxSpeed)
+        MovingObject(random, maxSpeed)
     {
     }
 };
@@ -252,9 +259,9 @@ class MovingFadingColoredObject: public FadingColoredObject, public MovingObject
 {
   public:
 
-    MovingFadingColoredObject(CRGB baseColor, double maxSpeed = 1.0)
+    MovingFadingColoredObject(FastRandom & random, CRGB baseColor, double maxSpeed = 1.0)
       : FadingColoredObject(baseColor),
-        MovingObject(maxSpeed)
+        MovingObject(random, maxSpeed)
     {
     }
 };
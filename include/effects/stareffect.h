@@ -36,291 +36,250 @@
 #include <iostream>
 #include <vector>
 #include <math.h>
-#include <deque>
 #include "colorutils.h"
 #include "globals.h"
 #include "ledstripeffect.h"
-#include "particles.h"
+#include "colordata.h"
 extern AppTime g_AppTime;
+extern volatile float gVURatio;
 
 const int cMaxNewStarsPerFrame = 144;
-const int cMaxStars = 500;
+const int cMaxStars = 256;                              // Most stars one effect keeps, 7 bytes of arena each
 const int starWidth = 1;
 
+// StarCapacity
+//
+// How many stars to make room for.  CreateStars starts cMaxNewStarsPerFrame * probability * LEDs / 5000
+// stars a second on average and each lives lifetimeMs, so that many are alive at once, plus half again and a
+// few for the swings of a random process.  At 1000 LEDs ChristmasLightStar keeps some 215 alive, while at 110
+// none of the star types needs more than 25.  Capped at cMaxStars, past which new stars are skipped.
 
-class Star : public MovingFadingPaletteObject, public ObjectSize
+constexpr size_t StarCapacity(size_t cLEDs, float probability, uint32_t lifetimeMs)
 {
-  public:
+    const float alive = cMaxNewStarsPerFrame * probability * cLEDs / 5000.0f * lifetimeMs / 1000.0f;
+    const size_t capacity = (size_t)(alive * 1.5f) + 8;
+    return capacity < (size_t)cMaxStars ? capacity : (size_t)cMaxStars;
+}
 
-    virtual double GetStarSize()
-    {
-        return _objectSize;
-    }
+// StarProfile
+//
+// What sets one kind of star apart from another: how long each stage of its life lasts, which palette entry
+// a new star takes its color from, and whether it is drawn at the effect's star size or one pixel wide.
+// The star types are rows in a table of these (see effectsFactory.cpp), all run by the one StarryNightEffect.
 
-    Star(const CRGBPalette256 & palette, TBlendType blendType = NOBLEND, double maxSpeed = 1.0, double starSize = 1.0)
-        : MovingFadingPaletteObject(palette, blendType, maxSpeed),
-          ObjectSize(starSize)
-    {
-    }
+enum class StarColor : uint8_t
+{
+    First,                                      // Palette entry 0
+    Random16,                                   // One of the 16 palette entries
+    Random                                      // Anywhere in the palette
 };
 
-class RandomPaletteColorStar : public MovingFadingPaletteObject, public ObjectSize
+enum class StarSize : uint8_t
 {
-  public:
-
-    virtual double GetStarSize()
-    {
-        return _objectSize;
-    }
-
-    RandomPaletteColorStar(const CRGBPalette256 & palette, TBlendType blendType = NOBLEND, double maxSpeed = 1.0, double starSize = 1.0)
-        : MovingFadingPaletteObject(palette, blendType, maxSpeed, random(16)*16),
-          ObjectSize(starSize)
-    {
-    }
+    Effect,                                     // The star size the effect was created with
+    OnePixel
 };
 
-class LongLifeSparkleStar : public MovingFadingPaletteObject, public ObjectSize
+struct StarProfile
 {
-    virtual float PreignitionTime() const         { return .25f;  }
-    virtual float IgnitionTime()    const         { return 5.0f;  }
-    virtual float HoldTime()        const         { return 0.00f; }
-    virtual float FadeTime()        const         { return 0.0f;  }
-
-  public:
-
-    virtual double GetStarSize()
-    {
-        return _objectSize;
-    }
-
-    LongLifeSparkleStar(const CRGBPalette256 & palette, TBlendType blendType = NOBLEND, double maxSpeed = 1.0, double starSize = 1.0)
-        : MovingFadingPaletteObject(palette, blendType, maxSpeed),
-          ObjectSize(starSize)
+    const char *name;
+    uint32_t    hash;
+    const char *effectName;                     // Friendly name of a StarryNightEffect made of these stars
+    uint16_t    preignitionMs;
+    uint16_t    ignitionMs;
+    uint16_t    holdMs;
+    uint16_t    fadeMs;
+    StarColor   color;
+    StarSize    size;
+
+    constexpr uint32_t LifetimeMs() const
     {
+        return (uint32_t)preignitionMs + ignitionMs + holdMs + fadeMs;
     }
 };
 
-class QuietStar : public RandomPaletteColorStar
+// StarPool
+//
+// Fixed number of stars kept as parallel arrays, so the pass over them each frame walks three small arrays
+// rather than a deque of objects with vtables.  The arrays come from the effect's arena.  Order means
+// nothing: when a star expires the last one is moved into its place.
+
+class StarPool
 {
-  public:
+  private:
 
-    QuietStar(const CRGBPalette256 & palette, TBlendType blendType = NOBLEND, double maxSpeed = 10.0, double starSize = 1)
-      : RandomPaletteColorStar(palette, blendType, maxSpeed, starSize)
-    {}
-        
-    virtual float PreignitionTime() const { return 1.0f; }
-    virtual float IgnitionTime()    const { return 0.00f; }
-    virtual float HoldTime()        const { return 0.00f; }
-    virtual float FadeTime()        const { return 2.0f;  }
-    virtual float StarSize()        const { return 1;     }    
-};
+    uint32_t * _pBirth;                                 // AppTime tick of the frame the star was born in
+    uint16_t * _pPos;
+    uint8_t  * _pColorIndex;
+    size_t     _capacity;
+    size_t     _count;
 
-class BubblyStar : public Star
-{
-    protected:
-    int         _hue;
+  public:
 
-    public:
-    
-    BubblyStar(const CRGBPalette256 & palette, TBlendType blendType = LINEARBLEND, double maxSpeed = 2.0, double starSize = 12)
-      : Star(palette, blendType, maxSpeed, starSize)
+    StarPool(size_t capacity)
+      : _pBirth(NULL), _pPos(NULL), _pColorIndex(NULL), _capacity(capacity), _count(0)
     {
-        static float lastHue = 0;
-        _hue        = lastHue;
-        lastHue += 16;
-        lastHue = fmod(lastHue, 256);
     }
 
-    virtual double GetStarSize()
+    static constexpr size_t BufferBytes(size_t capacity)
     {
-        float x = Age()/TotalLifetime();
-        float ratio1 = -1 * (2*(x-.5)) * (2*(x-.5)) + 1;
-        float width = ratio1 * _objectSize;
-        return width;
+        return ArenaBytes(sizeof(uint32_t) * capacity) + ArenaBytes(sizeof(uint16_t) * capacity) + ArenaBytes(capacity);
     }
 
-    virtual ~BubblyStar()
-    {}
-
-    virtual float PreignitionTime() const  { return 0.00f; }
-    virtual float IgnitionTime()    const  { return 0.05f; }
-    virtual float HoldTime()        const  { return 0.25f; }
-    virtual float FadeTime()        const  { return 0.50f; }
-};
-
-class FlashStar : public Star
-{
-    using Star::Star;
-
-    virtual float PreignitionTime() const  { return 0.00f; }
-    virtual float IgnitionTime()    const  { return 0.10f; }
-    virtual float HoldTime()        const  { return 0.10f; }
-    virtual float FadeTime()        const  { return 0.05f; }
-};
-
-class ColorCycleStar : public Star
-{
-    protected:
-    int         _brightness;
-
-    public:
-
-    ColorCycleStar(const CRGBPalette256 & palette, TBlendType blendType = LINEARBLEND, double maxSpeed = 2.0, int speedDivisor = 1)
-      : Star(palette, blendType, maxSpeed)
+    bool Attach(uint32_t * pBirth, uint16_t * pPos, uint8_t * pColorIndex)
     {
-        _brightness = randomDouble(128,255);
+        _pBirth = pBirth;
+        _pPos = pPos;
+        _pColorIndex = pColorIndex;
+        _count = 0;
+        return _pBirth && _pPos && _pColorIndex;
     }
 
-    virtual CRGB Render(TBlendType blend)
-    {
-        CRGB c = ColorFromPalette(_palette, millis() / 2048.0f, _brightness, blend);
-        fadeToBlackBy(&c, 1, 255 * FadeoutAmount());
-        return c;        
-    }
-    
-    virtual ~ColorCycleStar()
-    {}
-    
-    virtual float PreignitionTime() const { return 2.0f; }
-    virtual float IgnitionTime()    const { return 0.0f;}
-    virtual float HoldTime()        const { return 2.00f; }
-    virtual float FadeTime()        const { return 0.5f;  }
-    virtual float StarSize()        const { return 1;     }
-};
+    size_t Capacity() const     { return _capacity; }
+    size_t Count() const        { return _count; }
+    bool IsFull() const         { return _count >= _capacity; }
 
-class MultiColorStar : public Star
-{
-    protected:
-    uint8_t         _brightness;
-    uint8_t         _hue;
+    uint32_t Birth(size_t i) const      { return _pBirth[i]; }
+    uint16_t Position(size_t i) const   { return _pPos[i]; }
+    uint8_t ColorIndex(size_t i) const  { return _pColorIndex[i]; }
 
-    public:
-    MultiColorStar(const CRGBPalette256 & palette, TBlendType blendType = LINEARBLEND, double maxSpeed = 2.0, int speedDivisor = 1)
-      : Star(palette, blendType, maxSpeed)
+    void Add(uint32_t birth, uint16_t pos, uint8_t colorIndex)
     {
-        _brightness = randomDouble(128,255);
-        _hue        = randomDouble(0, 255);
+        _pBirth[_count] = birth;
+        _pPos[_count] = pos;
+        _pColorIndex[_count] = colorIndex;
+        _count++;
     }
 
-    virtual CRGB Render(TBlendType blend)
+    void Remove(size_t i)
     {
-        CRGB c = ColorFromPalette(_palette, _hue, _brightness, blend);
-        fadeToBlackBy(&c, 1, 255 * FadeoutAmount());
-        return c;        
+        _count--;
+        _pBirth[i] = _pBirth[_count];
+        _pPos[i] = _pPos[_count];
+        _pColorIndex[i] = _pColorIndex[_count];
     }
-    
-    virtual ~MultiColorStar()
-    {}
-
-    virtual float PreignitionTime() const { return 2.0f; }
-    virtual float IgnitionTime()    const { return 0.0f; }
-    virtual float HoldTime()        const { return 2.00f;}
-    virtual float FadeTime()        const { return 0.5f; }
-    virtual float StarSize()        const { return 1;    }
 };
 
-class ChristmasLightStar : public Star
+// StarryNightEffect
+//
+// Generates stars of the given profile, which twinkle in and out at random spots on the strip.  Room is made
+// for as many as the profile and probability keep alive on a strip of NUM_LEDS, see StarCapacity.
+
+class StarryNightEffect : public LEDStripEffect
 {
-  public:
+  protected:
+    StarPool                     _stars;
+    const StarProfile &          _profile;
+    const PaletteHandle          _palette;
+    float                        _newStarProbability;
+    float                        _starSize;
+    const TBlendType             _blendType;
+    double                       _maxSpeed;
+    double                       _blurFactor;
+    double                       _musicFactor;
+    CRGB                         _skyColor;
 
-    ChristmasLightStar(const CRGBPalette256 & palette, TBlendType blendType, double maxSpeed = 0.0, double starSize = 1.0)
-      : Star(palette, blendType, maxSpeed, starSize)
+    // Stage lengths of the profile in AppTime ticks, along with how many ticks each step of a fade lasts,
+    // so that dimming a star is one integer divide
 
+    struct Stage
     {
-        int iColor = randomDouble(0,255);
-        _colorIndex = iColor;
-    }
+        uint32_t ticks;
+        uint32_t ticksPerStep;
 
-    virtual ~ChristmasLightStar()
-    {}
-
-    virtual float PreignitionTime() const { return 0.20f; }
-    virtual float IgnitionTime()    const { return 0.00f; }
-    virtual float HoldTime()        const { return 6.0f;  }
-    virtual float FadeTime()        const { return 1.25f; }    
-    virtual float StarSize()        const { return 0.00f; }
-};
+        Stage(uint16_t ms)
+          : ticks(ms * 1000u), ticksPerStep(std::max<uint32_t>(1, ms * 1000u / 255))
+        {
+        }
 
-// Hot white stars that cool down through white, yellow, red
+        uint8_t Steps(uint32_t age) const
+        {
+            return std::min<uint32_t>(255, age / ticksPerStep);
+        }
+    };
 
-class HotWhiteStar : public Star
-{
-  public:
+    const Stage                  _preignition;
+    const Stage                  _ignition;
+    const Stage                  _hold;
+    const Stage                  _fade;
 
-    HotWhiteStar(const CRGBPalette256 & palette, TBlendType blendType = LINEARBLEND, double maxSpeed = 0.0, double size = 0.0)
-      : Star(palette, blendType, maxSpeed, size)
+    uint32_t TotalLifetime() const
     {
+        return _preignition.ticks + _ignition.ticks + _hold.ticks + _fade.ticks;
     }
 
-    virtual ~HotWhiteStar()
-    {}
-
-    virtual float PreignitionTime() const { return 0.00f;  }
-    virtual float IgnitionTime()    const { return 0.20f;  }
-    virtual float HoldTime()        const { return 0.00f;  }
-    virtual float FadeTime()        const { return 2.00f;  }  
+    // FadeoutAmount
+    //
+    // How much a star of the given age in ticks is dimmed, 0 while it is at full brightness and 255 once it
+    // has faded out
 
-    virtual CRGB Render(TBlendType blend)
+    uint8_t FadeoutAmount(uint32_t age) const
     {
-        if (Age() < IgnitionTime() + HoldTime())
-            return CRGB::White;
-        CRGB c = ColorFromPalette(_palette, 130*(1.0f-FadeoutAmount()), 256*(1.0f-FadeoutAmount()), blend);
-        return c;
-    }      
-};
-
-class MusicPulseStar : public Star
-{
-    public:
+        if (age < _preignition.ticks)
+            return 255 - _preignition.Steps(age);
+        age -= _preignition.ticks;
+        if (age < _ignition.ticks)
+            return _ignition.Steps(age);
+        age -= _ignition.ticks;
+        if (age < _hold.ticks)
+            return 0;                                                   // Just born
+        age -= _hold.ticks;
+        if (age >= _fade.ticks)
+            return 255;                                                 // Black hole, all faded out
+        return _fade.Steps(age);                                        // Fading star
+    }
 
-    MusicPulseStar(const CRGBPalette256 & palette, TBlendType blendType = LINEARBLEND, double maxSpeed = 0.0, double size = 0.0)
-      : Star(palette, blendType, maxSpeed, size)
+    CRGB StarColor(uint8_t colorIndex, uint32_t age) const
     {
+        CRGB c;
+        if (age >= _preignition.ticks && age < _ignition.ticks + _preignition.ticks)
+            c = CRGB::Green;
+        else
+            c = ColorFromPalette(*_palette, colorIndex, 255, _blendType);
 
+        fadeToBlackBy(&c, 1, FadeoutAmount(age));
+        return c;
     }
 
-    virtual ~MusicPulseStar()
+    uint8_t NewColorIndex()
     {
+        switch (_profile.color)
+        {
+            case StarColor::Random16:
+                return _random.Below(16)*16;
+            case StarColor::Random:
+                return _random.Below(255);
+            default:
+                return 0;
+        }
     }
 
-    virtual float PreignitionTime() const { return 0.00f;  }
-    virtual float IgnitionTime()    const { return 0.00f; }
-    virtual float HoldTime()        const { return 1.00f;  }
-    virtual float FadeTime()        const { return 2.00f; } 
-    virtual double GetStarSize()    const { return 1 + _objectSize * gVURatio; }
-};
-
-// StarryNightEffect template 
-//
-// Generates up to 
+    // SkipLength
+    //
+    // How many spawn chances in a row fail before the next one succeeds, given log(1 - chance of success)
 
-template <typename StarType> class StarryNightEffect : public LEDStripEffect
-{
-  protected:
-    std::deque<StarType>         _allParticles;
-    const CRGBPalette256         _palette;
-    float                        _newStarProbability;
-    float                        _starSize;
-    const TBlendType             _blendType;
-    double                       _maxSpeed;
-    double                       _blurFactor;
-    double                       _musicFactor;
-    CRGB                         _skyColor;
+    int SkipLength(float logMiss)
+    {
+        float u = 1.0f - _random.Float();                              // (0, 1], so the log is finite
+        float skip = logf(u) / logMiss;
+        return skip < cMaxNewStarsPerFrame ? (int) skip : cMaxNewStarsPerFrame;
+    }
 
   public:
 
-
-    StarryNightEffect<StarType>(const char * pszName,
-                                const CRGBPalette256& palette, 
-                                float probability = 1.0, 
-                                float starSize = 1.0, 
-                                TBlendType blendType = LINEARBLEND, 
-                                double maxSpeed = 100.0,
-                                double blurFactor = 0.0,
-                                double musicFactor = 1.0,
-                                CRGB skyColor = CRGB::Black)
+    StarryNightEffect(const char * pszName,
+                      const StarProfile & profile,
+                      PaletteHandle palette,
+                      float probability = 1.0, 
+                      float starSize = 1.0, 
+                      TBlendType blendType = LINEARBLEND, 
+                      double maxSpeed = 100.0,
+                      double blurFactor = 0.0,
+                      double musicFactor = 1.0,
+                      CRGB skyColor = CRGB::Black)
       : LEDStripEffect(pszName),
+        _stars(StarCapacity(NUM_LEDS, probability, profile.LifetimeMs())),
+        _profile(profile),
         _palette(palette),
         _newStarProbability(probability),
         _starSize(starSize),
@@ -328,8 +287,30 @@ template <typename StarType> class StarryNightEffect : public LEDStripEffect
         _maxSpeed(maxSpeed),
         _blurFactor(blurFactor),
         _musicFactor(musicFactor),
-        _skyColor(skyColor)
+        _skyColor(skyColor),
+        _preignition(profile.preignitionMs),
+        _ignition(profile.ignitionMs),
+        _hold(profile.holdMs),
+        _fade(profile.fadeMs)
+    {
+    }
+
+    // BufferBytes - How much of the effect arena Init takes for stars of the profile started at the probability
+    static constexpr size_t BufferBytes(const StarProfile &profile, float probability)
+    {
+        return StarPool::BufferBytes(StarCapacity(NUM_LEDS, probability, profile.LifetimeMs())) + ArenaBytes(sizeof(HDRAccumulator));
+    }
+
+    virtual bool Init(std::shared_ptr<LEDMatrixGFX> gfx)
     {
+        if (!LEDStripEffect::Init(gfx))
+            return false;
+
+        const size_t capacity = _stars.Capacity();
+        if (!_stars.Attach(AllocateBuffer<uint32_t>(capacity), AllocateBuffer<uint16_t>(capacity), AllocateBuffer<uint8_t>(capacity)))
+            return false;
+
+        return EnableHDR();                                             // Neighbouring stars overlap
     }
 
     virtual float StarSize()
@@ -354,15 +335,7 @@ template <typename StarType> class StarryNightEffect : public LEDStripEffect
             //    blur1d(_GFX[channel]->GetLEDBuffer(), _cLEDs, _blurFactor * 255);
 
 
-            for (size_t j = 0; j < _cLEDs; j++)							// fade brightness all LEDs one step
-            {
-                if (randomDouble(0, 10)>2) 
-                {
-                    CRGB c = getPixel(j);
-                    c.fadeToBlackBy(3);
-                    setPixel(j, c);
-                }
-            }
+            fadeRandomPixelsToBlackBy(3, true);                          // fade brightness of most LEDs one step
             fadeAllChannelsToBlackBy(1);
         }
         Update();
@@ -370,59 +343,68 @@ template <typename StarType> class StarryNightEffect : public LEDStripEffect
 
     }
 
+    // CreateStars
+    //
+    // Each frame has cMaxNewStarsPerFrame chances to start a star.  Rather than roll for every one of them we
+    // draw how many fail before the next success, which takes one random number per star actually started.
+
     virtual void CreateStars()
     {
-        for (int i = 0; i < cMaxNewStarsPerFrame; i++)
+        float prob = _newStarProbability;
+
+        if (_musicFactor != 1.0)
+        {
+            //prob = prob * 0.5 + (prob * 0.5 * gVURatio);
+            prob = prob * (gVURatio - 1.0) * _musicFactor;
+        }   
+
+        const float chance = FrameDeltaTime() * prob * (float) _cLEDs / 5000.0f;
+        const float logMiss = chance < 1.0f ? log1pf(-chance) : -INFINITY;
+        if (!(logMiss < 0.0f))                                          // No chance at all, or too small to register
+            return;
+
+        for (int i = SkipLength(logMiss); i < cMaxNewStarsPerFrame && !_stars.IsFull(); i += 1 + SkipLength(logMiss))
         {
-            float prob = _newStarProbability;
-
-            if (_musicFactor != 1.0)
-            {
-                //prob = prob * 0.5 + (prob * 0.5 * gVURatio);
-                prob = prob * (gVURatio - 1.0) * _musicFactor;
-            }   
-
-            if (randomDouble(0, 1.0) < g_AppTime.DeltaTime() * prob * (float) _cLEDs / 5000.0f)
-            {
-                StarType newstar(_palette, _blendType, _maxSpeed * _musicFactor, _starSize);
-                // This always starts stars on even pixel boundaries so they look like the desired width if not moving
-                newstar._iPos = (int) randomDouble(0, _cLEDs-1-starWidth);
-                _allParticles.push_back(newstar);
-            }
+            // This always starts stars on even pixel boundaries so they look like the desired width if not moving
+            _stars.Add(g_AppTime.FrameStartTicks(), _random.Range(0, _cLEDs-1-starWidth), NewColorIndex());
         }
     }
+
     virtual void Update()
     {
-        for(auto i = _allParticles.begin(); i != _allParticles.end(); i++)
-        {
-            float fPos = i->_iPos;
-            CRGB c = i->ObjectColor();
-            setPixels(fPos - i->_objectSize / 2.0, i->_objectSize, c);         
-        }
+        const uint32_t now = g_AppTime.FrameStartTicks();
+        const float size = _profile.size == StarSize::OnePixel ? 1.0f : _starSize;
+        const uint32_t lifetime = TotalLifetime();
 
-        while (_allParticles.size() > 0 && _allParticles.front().Age() >= _allParticles.front().TotalLifetime())
-            _allParticles.pop_front();
+        // Walk backwards so that the star moved into the place of an expired one has already been drawn
 
-        while (_allParticles.size() > cMaxStars)
-            _allParticles.pop_front();
+        for (size_t i = _stars.Count(); i-- > 0; )
+        {
+            uint32_t age = now - _stars.Birth(i);
+            addPixels(_stars.Position(i) - size * 0.5f, size, StarColor(_stars.ColorIndex(i), age));
+
+            if (age >= lifetime)
+                _stars.Remove(i);
+        }
+        resolveHDR();
     }
 
 };
 
-template <typename StarType> class BlurStarEffect : public StarryNightEffect<StarType>
+class BlurStarEffect : public StarryNightEffect
 {
   private:
 
   public:
 
-    BlurStarEffect<StarType>(const CRGBPalette256 & palette, float probability = 0.2, size_t starSize = 1, TBlendType blendType = LINEARBLEND, double maxSpeed = 20.0)
-        : StarryNightEffect<StarType>("StarryNightEffect", palette, probability, starSize, blendType, maxSpeed)
+    BlurStarEffect(const StarProfile & profile, PaletteHandle palette, float probability = 0.2, size_t starSize = 1, TBlendType blendType = LINEARBLEND, double maxSpeed = 20.0)
+        : StarryNightEffect("StarryNightEffect", profile, palette, probability, starSize, blendType, maxSpeed)
     {
     }
 
     virtual void Clear()
     {
-        StarryNightEffect<StarType>::setAllOnAllChannels(32,0,0);
+        setAllOnAllChannels(32,0,0);
     }
 };
 
@@ -471,7 +453,7 @@ public:
             setPixel(buffer[0], 0, 0, 0);
 
         // Pick a random pixel and put it in the TOP slot
-        int iNew = (int) randomDouble(0, _cLEDs);
+        int iNew = _random.Below(_cLEDs);
         setPixel(iNew, RandomRainbowColor());
         buffer[NUM_TWINKLES - 1] = iNew;
 	}
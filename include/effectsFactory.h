@@ -3,28 +3,99 @@
 
 #pragma once
 #include "effects/ledstripeffect.h"
+#include "effectParams.h"
+#include "effectArena.h"
+#include "colordata.h"
 #include <ArduinoJson.h>
 
 #define JSON_DOC_SIZE 1000
 
+// EffectEntry
+//
+// One row of the effect registry: the name requests use, its hash, the thunk that builds the effect in the
+// arena it is given, the parameters it takes and how much of the arena it needs.  The thunk returns NULL and
+// fills in strError if the parameters do not make sense.
+
+struct EffectEntry
+{
+    const char        *name;
+    uint32_t           hash;
+    LEDStripEffect    *(*create)(EffectArena &arena, const EffectArgs &args, String &strError);
+    const EffectParam *params;
+    size_t             cParams;
+    size_t             cbArena;
+};
+
+// JsonEffectParams
+//
+// Reads effect parameters out of a parsed JSON request, the counterpart of BinaryEffectParams
+
+class JsonEffectParams : public IEffectParams
+{
+  private:
+
+    JsonObjectConst _obj;
+
+  public:
+
+    JsonEffectParams(JsonObjectConst obj)
+      : _obj(obj)
+    {
+    }
+
+    virtual bool GetNumber(const EffectParam &param, float *pValue) const
+    {
+        JsonVariantConst value = _obj[param.name];
+        if (value.is<bool>())
+            *pValue = value.as<bool>() ? 1.0f : 0.0f;
+        else if (value.is<float>())
+            *pValue = value.as<float>();
+        else
+            return false;
+        return true;
+    }
+
+    virtual bool GetName(const EffectParam &param, uint32_t *pHash) const
+    {
+        const char *psz = _obj[param.name].as<const char *>();
+        if (psz == NULL)
+            return false;
+        *pHash = NameHash(psz);
+        return true;
+    }
+};
+
 class EffectsFactory
 {
 public:
-    bool CreateEffect(String jsonParams, int8_t* piChannel, LEDStripEffect** poutEffect);
-    
+    // The effect is built in the arena, which the caller must have Reset
+    bool CreateEffect(JsonObjectConst request, EffectArena& arena, LEDStripEffect** poutEffect);
+    bool CreateEffect(uint32_t nameHash, const IEffectParams& params, EffectArena& arena, LEDStripEffect** poutEffect);
+
+    // Lists every effect with its parameters and defaults, then the palettes, one per line
+    String GetCatalog() const;
+
+    static const EffectEntry* FindEffect(uint32_t nameHash);
+
+    // For walking the registry, NULL past the last effect
+    static const EffectEntry* GetEffectEntry(size_t i);
+
+    // GetParamChoice
+    //
+    // The i-th value a Name parameter of the effect accepts (a palette, a star type, a buildIn preset), NULL past
+    // the last one or if the parameter takes no fixed set of names
+    static const char* GetParamChoice(const EffectEntry& entry, const EffectParam& param, size_t i);
+
+    // Size of an effect arena: enough for the largest effect in the registry at its defaults, plus slack
+    static size_t ArenaSize();
+
     String getLastError()
     {
         return m_strLastError;
     }
 
-protected:
-    bool CreateStarryNightEffect(StaticJsonDocument<JSON_DOC_SIZE>* doc, LEDStripEffect** poutEffect);
-    bool CreatePaletterEffect(StaticJsonDocument<JSON_DOC_SIZE>* doc, LEDStripEffect** poutEffect);
-
-    bool GetPaletterFromString(String name, CRGBPalette256** pout);
-
 protected:
     String m_strLastError;
 };
 
-#endif
\ No newline at end of file
+#endif
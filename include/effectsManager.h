@@ -5,8 +5,10 @@
 #include "effects/ledstripeffect.h"
 #include "effectsFactory.h"
 #include <string>
+#include <vector>
 #include "effects/misceffects.h"
 #include "IErrorReported.h"
+#include "outputstage.h"
 
 class EffectsManager
 {
@@ -20,14 +22,39 @@ public:
 
     void setBrightnes(uint8_t value);
     void setEnabled(bool bEnabled);
+    void setGamma(float gamma) { _output.SetGamma(gamma); };
+    void setColorCorrection(CRGB correction) { _output.SetCorrection(correction); };
+    void setDithering(bool bDither) { _output.SetDithering(bDither); };
 
-    uint8_t getBrightnes() { return _brightnes; };
+    uint8_t getBrightnes() { return _output.GetBrightness(); };
+    bool getDithering() { return _output.GetDithering(); };
     bool getEnabled() { return _bEnabled; };
 
+    void setKeepAliveInterval(unsigned long ms) { _keepAliveMs = ms; };
+    unsigned long getKeepAliveInterval() { return _keepAliveMs; };
+    void setTargetFPS(uint16_t fps);
+    uint16_t getTargetFPS() { return _targetFPS; };
+    uint32_t getSkippedFrames() { return _skippedFrames; };
+
+    // Estimated draw of the channel's strip, and how much of the brightness the power limit lets through, see OutputStage
+    uint32_t getMilliwatts() { return _bEnabled ? _output.GetMilliwatts() : LEDMatrixGFX::LEDCount * LED_DARK_MW; };
+    uint8_t getPowerScale() { return _output.GetPowerScale(); };
+
+    // Effect arena statistics, the high water mark is the most any effect has needed since boot
+    size_t getArenaSize() { return _pArenas[0] ? _pArenas[0]->Capacity() : 0; };
+    size_t getArenaHighWater();
+    uint32_t getArenaFailures();
+
     void init(IErrorReporter* errReporter);
-    void changeEffect(String jsonParams);
+    void changeEffect(JsonObjectConst request);
+    void changeEffect(uint32_t effectId, const IEffectParams &params);
+    void setEffectError(const String &strError);
     void loop();
 
+    // Frame pacing, the station draws a channel's next frame once it is due and idles until then
+    bool isFrameDue(uint32_t now) { return (int32_t)(now - _nextFrameTick) >= 0; };
+    uint32_t ticksUntilFrame(uint32_t now) { return isFrameDue(now) ? 0 : _nextFrameTick - now; };
+
     void onWiFiStatusChanged(bool up);
     void onMqttStatusChanged(bool up);
 
@@ -35,18 +62,68 @@ public:
 
 private:
 
+    void bindFrontBuffer();
+    void startEffect(bool bCreated, LEDStripEffect* newEffect);
+    void destroyEffect(LEDStripEffect*& pEffect, uint8_t iSlot);
+    void composeFrame();
+    uint32_t frameIntervalTicks();
+    uint8_t effectBrightness();
+
     StatusEffect* _statusEffect;
     LEDStripEffect* _currEffect;
+    LEDStripEffect* _prevEffect;    // Outgoing effect, kept alive while we cross-fade away from it
     EffectsFactory _factory;
     IErrorReporter* _errReporter;
 
-    uint8_t _brightnes;
     unsigned long _lastErrTime;
     uint8_t _bChannelNum;
 
     bool _bEnabled;
 
-    std::shared_ptr<LEDMatrixGFX> m_pLedStrip; // Each LED strip gets its own channel
+    // Frame change detection
+    uint32_t _lastFrameHash;
+    unsigned long _lastShowTime;
+    unsigned long _keepAliveMs;
+    uint32_t _skippedFrames;
+
+    // Frame pacing
+    uint16_t _targetFPS;
+    uint32_t _nextFrameTick;
+
+    // Cross-fade state
+    unsigned long _fadeStartTime;
+    bool _bFading;
+    uint8_t _fadeFromBrightness;    // Effect brightness the output stage had when the cross-fade started
+
+    std::shared_ptr<LEDMatrixGFX> m_pFrames[2]; // Front (current effect) and back (outgoing effect) buffers
+    uint8_t _iFront;
+    std::unique_ptr<EffectArena> _pArenas[2];   // Where the effects drawing into each of those buffers are built
+
+    OutputStage _output;                        // Brightness, gamma and white balance applied on the way out
+
+    std::shared_ptr<LEDMatrixGFX> m_pLedStrip; // Each LED strip gets its own channel, this is what gets sent to it
 };
 
+// RouteToChannels
+//
+// Hands build the channel a setEffect request names, 0-based, or every channel for -1, the way both the JSON and
+// the binary form are routed.  False if the request names a channel there is not.
+
+template <typename Fn>
+bool RouteToChannels(const std::vector<EffectsManager *> &channels, int iChannel, Fn build)
+{
+    if (iChannel < 0)
+    {
+        for (EffectsManager *pChannel : channels)
+            build(pChannel);
+        return true;
+    }
+
+    if (iChannel >= (int)channels.size())
+        return false;
+
+    build(channels[iChannel]);
+    return true;
+}
+
 #endif
\ No newline at end of file
@@ -0,0 +1,130 @@
+//+--------------------------------------------------------------------------
+//
+// File:        fastrandom.h
+//
+// Description:
+//
+//    Small, fast, seedable random numbers for effects.  Every effect owns
+//    a FastRandom of its own, seeded from g_EffectSeeds when it is built,
+//    so the numbers one effect draws never depend on what another channel
+//    is doing, and seeding g_EffectSeeds (or the effect itself) replays
+//    exactly the same frames.  The generator is a 32-bit xorshift: three
+//    shifts and three xors per word, no multiply, no divide.
+//
+//---------------------------------------------------------------------------
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+class FastRandom
+{
+  private:
+
+    uint32_t _state;                            // Never zero, xorshift would get stuck there
+
+  public:
+
+    explicit FastRandom(uint32_t seed = 1)
+    {
+        Seed(seed);
+    }
+
+    // Seed
+    //
+    // Any value will do, including 0.  The seed is hashed first so that neighbouring seeds give unrelated sequences.
+
+    void Seed(uint32_t seed)
+    {
+        seed ^= seed >> 16;                     // murmur3 finalizer
+        seed *= 0x85EBCA6Bu;
+        seed ^= seed >> 13;
+        seed *= 0xC2B2AE35u;
+        seed ^= seed >> 16;
+        _state = seed ? seed : 0x9E3779B9u;
+    }
+
+    // Next - 32 random bits
+
+    uint32_t Next()
+    {
+        uint32_t x = _state;
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        _state = x;
+        return x;
+    }
+
+    uint8_t Byte()
+    {
+        return (uint8_t)(Next() >> 24);
+    }
+
+    // Below
+    //
+    // Uniform integer in [0, n), 0 when n is 0 or 1.  Draws are masked down to the next power of two and the ones
+    // that land past n are thrown away, so there is no modulo and no bias, and on average less than two draws.
+
+    uint32_t Below(uint32_t n)
+    {
+        if (n <= 1)
+            return 0;
+
+        const uint32_t mask = 0xFFFFFFFFu >> __builtin_clz(n - 1);
+        uint32_t value;
+        do
+        {
+            value = Next() & mask;
+        } while (value >= n);
+        return value;
+    }
+
+    // Range - Uniform integer in [lower, upper), lower when the range is empty, the same contract as Arduino's random
+
+    int32_t Range(int32_t lower, int32_t upper)
+    {
+        if (upper <= lower)
+            return lower;
+        return lower + (int32_t)Below((uint32_t)(upper - lower));
+    }
+
+    // Float - Uniform in [0, 1), from the top 24 bits so every value is exact
+
+    float Float()
+    {
+        return (Next() >> 8) * (1.0f / 16777216.0f);
+    }
+
+    float Float(float lower, float upper)
+    {
+        return lower + (upper - lower) * Float();
+    }
+
+    // FillBytes
+    //
+    // Fills a buffer with random bytes, four to each draw, for loops that want a fresh random value per pixel
+
+    void FillBytes(uint8_t * pBytes, size_t cb)
+    {
+        size_t i = 0;
+        for (; i + 4 <= cb; i += 4)
+        {
+            uint32_t word = Next();
+            memcpy(pBytes + i, &word, 4);
+        }
+        if (i < cb)
+        {
+            uint32_t word = Next();
+            memcpy(pBytes + i, &word, cb - i);
+        }
+    }
+};
+
+// g_EffectSeeds
+//
+// Where each new effect draws its seed.  Seeded once from the hardware at boot, host tests seed it with a constant.
+
+extern FastRandom g_EffectSeeds;
@@ -19,7 +19,7 @@
 #define PERIOD_FROM_FREQ(f) (round(1000000 * (1.0 / f)))	// Calculate period in microseconds (us) from frequency in Hz
 #define FREQ_FROM_PERIOD(p) (1.0 / p * 1000000)				// Calculate frequency in Hz given the period in microseconds (us)
 
-#define EFFECT_CROSS_FADE_TIME 600.0    // How long for an effect to ramp brightness fader down and back during effect change
+#define EFFECT_CROSS_FADE_TIME 600.0    // How long (ms) the outgoing and incoming effects are blended for during an effect change
 
 
 #define FASTLED_INTERNAL        1   // Suppresses the compilation banner from FastLED
@@ -72,12 +72,52 @@ std::string to_string(T value)
 #define LED_PIN1                12
 #define COLOR_ORDER             RGB
 
+// The strip length can be given on the command line, which is how the benchmark builds try several
+#ifndef MATRIX_WIDTH
 #define MATRIX_WIDTH            110
+#endif
 #define MATRIX_HEIGHT           1
 #define NUM_LEDS                (MATRIX_WIDTH*MATRIX_HEIGHT)
 #define NUM_CHANNELS            2
 
-#define POWER_LIMIT_MW       3 * 12 * 1000   // 3 amp supply at 12 volts assumed
+// Bounds checks on the unchecked framebuffer accessors, turn on for debug builds
+
+#ifndef CHECKED_PIXEL_ACCESS
+#define CHECKED_PIXEL_ACCESS    0
+#endif
+
+#define POWER_LIMIT_MW       (3 * 12 * 1000) // 3 amp supply at 12 volts assumed
+
+// What the output stage reckons an LED draws with each color at full, and with all of them off.  These are the
+// WS2812 figures FastLED's power model uses, change them to suit other strips.  The channels share the one
+// supply, so each is held to its share of POWER_LIMIT_MW.
+#define LED_RED_MW              80
+#define LED_GREEN_MW            55
+#define LED_BLUE_MW             75
+#define LED_DARK_MW             5
+#define CHANNEL_POWER_LIMIT_MW  (POWER_LIMIT_MW / NUM_CHANNELS)
+
+// A channel the power limit has dimmed comes back up by at most this much brightness (of 255) a frame
+#define POWER_LIMIT_RECOVERY    2
+
+// How often the estimated draw of each channel is published while connected
+#define POWER_REPORT_INTERVAL_MS 10000
+
+// Output stage defaults: gamma applied to every channel (1.0 is linear) and the white balance of the strips
+
+#define OUTPUT_GAMMA            1.0f
+#define OUTPUT_COLOR_CORRECTION UncorrectedColor
+
+// Each channel builds its effects in fixed arenas sized for the largest effect, plus this much for effects
+// asked for with bigger parameters than their defaults (more meteors or balls, more fire cells per LED)
+#define EFFECT_ARENA_SLACK 512
+
+// Unchanged frames are not sent to the strip, except once per this many milliseconds to keep it refreshed
+#define FRAME_KEEPALIVE_MS 1000
+
+// Frames a second each channel draws unless told otherwise, and the most it can be told to draw
+#define DEFAULT_TARGET_FPS 60
+#define MAX_TARGET_FPS     120
 
 // How long should the error be shown in milliseconds
 #define ERROR_SHOW_TIME 30 * 1000
@@ -96,6 +136,11 @@ const char WiFiAPPSK[] = "123456789";
 #define CONFIG_FILE_SEPAREATOR '&'
 #define CONFIG_FILE_EQUALS '='
 #define CONFIG_FILE_END '#'
+#define CONFIG_SSID_SIZE 33         // The longest SSID there is, 32 chars, and the terminator
+#define CONFIG_PSK_SIZE 65          // A 63 char passphrase or a 64 digit hex key
+#define CONFIG_HOST_SIZE 40         // The broker's address
+#define CONFIG_KEY_SIZE 16          // Longer than any key we know, longer ones are skipped
+#define CONFIG_READ_CHUNK 64        // Bytes read from the file at a time, on the stack
 
 #define SYS_LED_CHANNEL 0
 
@@ -107,9 +152,35 @@ const char reportErrorTopic[] = STATION_ID "/get/error";
 const char reportCurrEffectTopic[] = STATION_ID "/get/effect";
 const char reportCurrBrightnessTopic[] = STATION_ID "/get/brightness";
 const char reportCurrPowerStatus[] = STATION_ID "/get/power";
+const char reportArenaTopic[] = STATION_ID "/get/arena";
+const char reportFramesTopic[] = STATION_ID "/get/frames";
+const char reportMilliwattsTopic[] = STATION_ID "/get/milliwatts";
+const char reportCatalogTopic[] = STATION_ID "/get/catalog";
+// Numbered /set topics
+//
+// brightness, dither, gamma, correction, fps and keepalive take a channel and a value in one number,
+// channel * scale + value, where channel 0 means every channel and 1 to NUM_CHANNELS one of them:
+//
+//   brightness   1000        0 to 255, ie: 2128 is 128 on the second channel
+//   dither       10          1 on, 0 off, ie: 21 turns it on for the second channel
+//   gamma        1000        Gamma in hundredths, ie: 1220 is 2.2 on the first channel
+//   correction   0x1000000   In hex, RRGGBB white balance, ie: 1FFB0F0 on the first channel
+//   fps          1000        Frames a second
+//   keepalive    100000      Milliseconds between refreshes of an unchanged frame
+//
+// /set/power is older and counts channels from 0, channel * 10 + 1 for on, as setEffect's "channel" does,
+// where -1 is every channel.
+
 const char setEffectTopic[] = STATION_ID "/set/effect";
+const char setEffectBinTopic[] = STATION_ID "/set/effect_bin";
 const char setBrightnessTopic[] = STATION_ID "/set/brightness";
 const char setPower[] = STATION_ID "/set/power";
+const char setDitherTopic[] = STATION_ID "/set/dither";
+const char setGammaTopic[] = STATION_ID "/set/gamma";
+const char setCorrectionTopic[] = STATION_ID "/set/correction";
+const char setFpsTopic[] = STATION_ID "/set/fps";
+const char setKeepAliveTopic[] = STATION_ID "/set/keepalive";
+const char setCatalogTopic[] = STATION_ID "/set/catalog";      // Any payload, the catalog comes back on /get/catalog
 const char subscribeTopic[] = STATION_ID "/set/#";
 
 // !!! WARNING !!!!
@@ -117,17 +188,17 @@ const char subscribeTopic[] = STATION_ID "/set/#";
 // (EPS8266 reenters boot loader mode, if not reset via reset button or power circle)
 #define WAIT_BEFORE_RESTART_SEC 5 * 60
 
-#define ELAPSED_SECONDS (millis() / 1000)
+// Failed MQTT connection attempts are retried after this long, doubling each time up to the maximum
+#define RECONNECT_BACKOFF_MIN_MS 1000
+#define RECONNECT_BACKOFF_MAX_MS 32000
 
-#define WIFI_WAIT_FOR_CONNECTION unsigned \
-long ulRestartTime = ELAPSED_SECONDS + WAIT_BEFORE_RESTART_SEC; \
-while (WiFi.status() != WL_CONNECTED) \
-{\
-    Print(".");\
-    if (ulRestartTime < ELAPSED_SECONDS)\
-        { Println("Failed to reconnect to WIFI for 5 mins. Calling ESP.restart()"); SERIAL_END; ESP.restart(); } \
-    delay(1000); \
-}
+// Longest a single attempt to reach the broker can hold up the frame loop.  PubSubClient can only connect
+// blocking, so this is kept to a few frames; a broker on the local network answers well within it.
+#define MQTT_CONNECT_TIMEOUT_MS  250
+#define MQTT_SOCKET_TIMEOUT_SEC  1
+
+// While the station is offline its status color is drawn over the first few pixels of the system channel
+#define STATUS_OVERLAY_PIXELS 4
 
 // Real Global Definitions
 #define PRINT_LINES 1
@@ -261,14 +332,22 @@ inline int FPS(uint32_t start, uint32_t end, uint32_t perSecond = MILLIS_PER_SEC
 
 // AppTime
 //
-// A class that keeps track of the clock, how long the last frame took, calculating FPS, etc.
+// A class that keeps track of the clock, how long the last frame took, calculating FPS, etc.  Time is
+// kept as a 32-bit microsecond tick straight from micros().  Ticks wrap every 71 minutes, so compare
+// them by subtracting, ie: FrameStartTicks() - birthTick, which stays right across the wrap for any
+// span shorter than that.
+
+#define DELTA_TIME_FRACTION_BITS 16             // DeltaTimeQ16 is seconds in 16.16 fixed point
+#define MAX_DELTA_TICKS          MICROS_PER_SECOND
 
 class AppTime
 {
   protected:
 
-    double _lastFrame;
-    double _deltaTime;
+    uint32_t _frameStartTicks;
+    uint32_t _deltaTicks;
+    uint32_t _deltaTimeQ16;
+    float    _deltaTime;
   
   public:
 
@@ -279,32 +358,58 @@ class AppTime
 
     void NewFrame()
     {
-        timeval tv;
-        gettimeofday(&tv, nullptr);
-        double current = CurrentTime();
-        _deltaTime = current - _lastFrame;
+        uint32_t current = micros();
+        _deltaTicks = current - _frameStartTicks;
 
         // Cap the delta time at one full second
 
-        if (_deltaTime > 1.0f)
-            _deltaTime = 1.0f;
+        if (_deltaTicks > MAX_DELTA_TICKS)
+            _deltaTicks = MAX_DELTA_TICKS;
 
-        _lastFrame = current;
+        // 2^16 / 10^6 reduces to 2^10 / 15625, which keeps the whole thing in 32 bits for deltas up to the cap
+        _deltaTimeQ16 = (_deltaTicks << (DELTA_TIME_FRACTION_BITS - 6)) / (MICROS_PER_SECOND >> 6);
+        _deltaTime = _deltaTicks / (float) MICROS_PER_SECOND;
+        _frameStartTicks = current;
     }
 
-    AppTime() : _lastFrame(CurrentTime())
+    AppTime() : _frameStartTicks(micros())
     {
         NewFrame();
     }
 
+    uint32_t FrameStartTicks() const
+    {
+        return _frameStartTicks;
+    }
+
+    // DeltaTicks - Microseconds since the previous frame, at most MAX_DELTA_TICKS
+
+    uint32_t DeltaTicks() const
+    {
+        return _deltaTicks;
+    }
+
+    uint32_t DeltaTimeQ16() const
+    {
+        return _deltaTimeQ16;
+    }
+
+    // Compatibility shims for code that still wants seconds.  DeltaTime is worked out once per frame,
+    // the others convert on every call.
+
+    float DeltaTime() const
+    {
+        return _deltaTime;
+    }
+
     double FrameStartTime() const
     {
-        return _lastFrame;
+        return _frameStartTicks / (double) MICROS_PER_SECOND;
     }
 
     static double CurrentTime()
     {
-        return micros() / 1000000.0;
+        return micros() / (double) MICROS_PER_SECOND;
     }
 
     static double TimeFromTimeval(const timeval & tv)
@@ -319,22 +424,11 @@ class AppTime
         tv.tv_usec = t - tv.tv_sec;
         return tv;
     }
-
-    double DeltaTime() const
-    {
-        return _deltaTime;
-    }
 };
 
 // C Helpers
 //
-// Simple inline utility functions like random numbers, mapping, conversion, etc
-
-inline static double randomDouble(double lower, double upper)
-{
-    double result = (lower + ((upper - lower) * rand()) / RAND_MAX);
-    return result;
-}
+// Simple inline utility functions like mapping, conversion, etc
 
 inline double mapDouble(double x, double in_min, double in_max, double out_min, double out_max)
 {
@@ -376,7 +470,7 @@ inline bool CheckBlueBuffer(CRGB * prgb, size_t count)
         {
             if (prgb[i].r > 0 || prgb[i].g > 0)
             {
-                Serial.printf("Other color detected at offset %d\n", i);
+                Serial.printf("Other color detected at offset %u\n", (unsigned)i);
                 bOK = false;
             }
         }
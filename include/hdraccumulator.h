@@ -0,0 +1,139 @@
+//+--------------------------------------------------------------------------
+//
+// File:        hdraccumulator.h
+//
+// Description:
+//
+//    Optional high range buffer that effects can draw into additively.
+//    Each color component is 16 bits with HDR_FRACTION_BITS of fraction,
+//    so overlapping lights and anti-aliased edges sum without clipping or
+//    losing their low bits.  At the end of the frame the accumulator is
+//    resolved onto the 8-bit framebuffer in one pass: pixels that went past
+//    full scale are scaled back down as a whole, keeping their hue instead
+//    of clipping each channel on its own.
+//
+//---------------------------------------------------------------------------
+
+#pragma once
+
+#include "globals.h"
+#include "ledmatrixgfx.h"
+#include <string.h>
+
+// HDR_FRACTION_BITS
+//
+// Bits below one 8-bit color step.  5 leaves headroom for about eight full brightness lights on one pixel.
+
+#define HDR_FRACTION_BITS 5
+
+struct CRGB16
+{
+    uint16_t r;
+    uint16_t g;
+    uint16_t b;
+};
+
+template <size_t N>
+class HDRAccumulatorT
+{
+  private:
+
+    CRGB16 _pixels[N];
+
+    static constexpr uint32_t FullScale = 255u << HDR_FRACTION_BITS;
+    static constexpr uint32_t Half      = (1u << HDR_FRACTION_BITS) >> 1;
+
+    static inline uint16_t addSaturate(uint16_t a, uint32_t b)
+    {
+        return (uint16_t)std::min<uint32_t>(a + b, 0xFFFF);
+    }
+
+  public:
+
+    HDRAccumulatorT()
+    {
+        Clear();
+    }
+
+    void Clear()
+    {
+        memset(_pixels, 0, sizeof(_pixels));
+    }
+
+    // addCoverage
+    //
+    // Adds a color to one pixel, scaled by how much of it is covered in 256ths
+
+    inline void addCoverage(int32_t i, CRGB c, uint32_t coverage)
+    {
+        if ((uint32_t)i >= N)
+            return;
+
+        constexpr int shift = 8 - HDR_FRACTION_BITS;
+        CRGB16 &p = _pixels[i];
+        p.r = addSaturate(p.r, (c.r * coverage) >> shift);
+        p.g = addSaturate(p.g, (c.g * coverage) >> shift);
+        p.b = addSaturate(p.b, (c.b * coverage) >> shift);
+    }
+
+    // addPixelsQ8
+    //
+    // Same span rules as LEDMatrixGFX::setPixelsQ8, except the edge coverage is kept at full precision
+
+    inline void addPixelsQ8(int32_t pos, int32_t count, CRGB c)
+    {
+        if (count <= 0)
+            return;
+
+        const int32_t end = pos + count;
+        int32_t i = pos >> 8;
+        const int32_t iEnd = end >> 8;
+
+        if (i == iEnd)
+        {
+            addCoverage(i, c, count);
+            return;
+        }
+
+        addCoverage(i++, c, 256 - (pos & 0xFF));
+
+        for (i = std::max<int32_t>(i, 0); i < std::min<int32_t>(iEnd, N); i++)
+            addCoverage(i, c, 256);
+
+        if (end & 0xFF)
+            addCoverage(iEnd, c, end & 0xFF);
+    }
+
+    // ResolveOnto
+    //
+    // Adds the accumulated light onto the framebuffer, tone maps whatever went over full scale, and clears
+    // the accumulator for the next frame.  Pixels nothing was drawn on are left exactly as they were.  Layers
+    // drawn by 2^averageShift effects sharing the accumulator can be averaged rather than summed.
+
+    void ResolveOnto(CRGB *pLEDs, int averageShift = 0)
+    {
+        for (size_t i = 0; i < N; i++)
+        {
+            CRGB16 &acc = _pixels[i];
+            if ((acc.r | acc.g | acc.b) == 0)
+                continue;
+
+            uint32_t r = ((uint32_t)pLEDs[i].r << HDR_FRACTION_BITS) + (acc.r >> averageShift);
+            uint32_t g = ((uint32_t)pLEDs[i].g << HDR_FRACTION_BITS) + (acc.g >> averageShift);
+            uint32_t b = ((uint32_t)pLEDs[i].b << HDR_FRACTION_BITS) + (acc.b >> averageShift);
+
+            const uint32_t peak = std::max(r, std::max(g, b));
+            if (peak > FullScale)
+            {
+                r = r * FullScale / peak;
+                g = g * FullScale / peak;
+                b = b * FullScale / peak;
+            }
+
+            pLEDs[i] = CRGB((r + Half) >> HDR_FRACTION_BITS, (g + Half) >> HDR_FRACTION_BITS, (b + Half) >> HDR_FRACTION_BITS);
+            acc = { 0, 0, 0 };
+        }
+    }
+};
+
+typedef HDRAccumulatorT<LEDMatrixGFX::LEDCount> HDRAccumulator;
@@ -38,8 +38,9 @@
 #include "FastLED.h"
 #include <SPI.h>
 #include "pixeltypes.h"
+#include "pixelkernels.h"
 #include <string>
-#include <stdexcept>
+#include <assert.h>
 
 // 5:6:5 Color definitions
 #define BLACK16 0x0000
@@ -51,42 +52,13 @@
 #define YELLOW16 0xFFE0
 #define WHITE16 0xFFFF
 
-class LEDMatrixGFX
-{
-  friend class LEDStripEffect; // I might a shower after this lifetime first, but it needs access to the pixels to do its job, so BUGBUG expose this more nicely
-
-private:
-  CRGB *_pLEDs;
-  size_t _width;
-  size_t _height;
+// LEDMatrixGFXBase
+//
+// Color conversion helpers and tables shared by every framebuffer size
 
+class LEDMatrixGFXBase
+{
 public:
-  LEDMatrixGFX(size_t w, size_t h)
-      : _width(w), _height(h)
-  {
-    _pLEDs = static_cast<CRGB *>(calloc(w * h, sizeof(CRGB)));
-    if (!_pLEDs)
-    {
-      throw std::runtime_error("Unable to allocate LEDs in LEDMatrixGFX");
-    }
-  }
-
-  ~LEDMatrixGFX()
-  {
-    free(_pLEDs);
-    _pLEDs = nullptr;
-  }
-
-  CRGB *GetLEDBuffer() const
-  {
-    return _pLEDs;
-  }
-
-  size_t GetLEDCount() const
-  {
-    return _width * _height;
-  }
-
   static const uint8_t gamma5[];
   static const uint8_t gamma6[];
 
@@ -113,121 +85,264 @@ public:
   {
     return to16bit(CRGB(code));
   }
+};
+
+// LEDMatrixGFXT
+//
+// Framebuffer whose dimensions are known at compile time, so loops over it have constant trip counts.  The
+// getPixel/drawPixel family is bounds checked and never throws; pixel() and operator[] are unchecked and meant
+// for the per-pixel hot paths (they only assert when CHECKED_PIXEL_ACCESS is turned on for debug builds).
+
+template <size_t W, size_t H>
+class LEDMatrixGFXT : public LEDMatrixGFXBase
+{
+  friend class LEDStripEffect; // I might a shower after this lifetime first, but it needs access to the pixels to do its job, so BUGBUG expose this more nicely
+
+private:
+  alignas(uint32_t) CRGB _pLEDs[W * H];         // Word aligned so the pixel kernels can run on it a word at a time
+
+public:
+  static constexpr size_t Width    = W;
+  static constexpr size_t Height   = H;
+  static constexpr size_t LEDCount = W * H;
+
+  LEDMatrixGFXT()
+  {
+    memset((void *)_pLEDs, 0, sizeof(_pLEDs));
+  }
+
+  CRGB *GetLEDBuffer()
+  {
+    return _pLEDs;
+  }
+
+  const CRGB *GetLEDBuffer() const
+  {
+    return _pLEDs;
+  }
+
+  constexpr size_t GetLEDCount() const
+  {
+    return LEDCount;
+  }
 
   inline uint16_t getPixelIndex(int16_t x, int16_t y) const
   {
     if (x & 0x01)
     {
       // Odd rows run backwards
-      uint8_t reverseY = (_height - 1) - y;
-      return (x * _height) + reverseY;
+      uint8_t reverseY = (H - 1) - y;
+      return (x * H) + reverseY;
     }
     else
     {
       // Even rows run forwards
-      return (x * _height) + y;
+      return (x * H) + y;
     }
   }
 
+  // Unchecked accessors
+
+  inline CRGB &pixel(size_t i)
+  {
+#if CHECKED_PIXEL_ACCESS
+    assert(i < LEDCount);
+#endif
+    return _pLEDs[i];
+  }
+
+  inline const CRGB &pixel(size_t i) const
+  {
+#if CHECKED_PIXEL_ACCESS
+    assert(i < LEDCount);
+#endif
+    return _pLEDs[i];
+  }
+
+  inline CRGB &operator[](size_t i)
+  {
+    return pixel(i);
+  }
+
+  inline const CRGB &operator[](size_t i) const
+  {
+    return pixel(i);
+  }
+
+  // Checked accessors
+
+  static inline bool isValid(int x)
+  {
+    return (size_t)x < LEDCount;
+  }
+
+  static inline bool isValid(int x, int y)
+  {
+    return (size_t)x < W && (size_t)y < H;
+  }
+
   inline CRGB getPixel(int16_t x) const
   {
-    if (x >= 0 && x <= MATRIX_WIDTH * MATRIX_HEIGHT)
+    if (isValid(x))
       return _pLEDs[x];
-    else
-    {
-      throw std::runtime_error("Invalid index in getPixel: " + x);
-      return CRGB::Black;
-    }
+
+#if CHECKED_PIXEL_ACCESS
+    Serial.printf("Invalid index in getPixel: %d\n", x);
+#endif
+    return CRGB::Black;
   }
 
   inline CRGB getPixel(int16_t x, int16_t y) const
   {
-    if (x >= 0 && x <= MATRIX_WIDTH && y >= 0 && y <= MATRIX_HEIGHT)
+    if (isValid(x, y))
       return _pLEDs[getPixelIndex(x, y)];
-    else
-    {
-      char szBuffer[80];
-      Serial.printf(szBuffer, 80, "Invalid index in getPixel: x=%d, y=%d, NUM_LEDS=%d", x, y, NUM_LEDS);
-      throw std::runtime_error(szBuffer);
-    }
+
+#if CHECKED_PIXEL_ACCESS
+    Serial.printf("Invalid index in getPixel: x=%d, y=%d, NUM_LEDS=%d\n", x, y, NUM_LEDS);
+#endif
+    return CRGB::Black;
   }
 
-  inline virtual void drawPixel(int16_t x, int16_t y, uint16_t color)
+  inline void drawPixel(int16_t x, int16_t y, uint16_t color)
   {
-    if (x >= 0 && x <= MATRIX_WIDTH && y >= 0 && y <= MATRIX_HEIGHT)
+    if (isValid(x, y))
       _pLEDs[getPixelIndex(x, y)] = from16Bit(color);
   }
 
-  inline virtual void drawPixel(int16_t x, int16_t y, CRGB color)
+  inline void drawPixel(int16_t x, int16_t y, CRGB color)
   {
-    if (x >= 0 && x <= MATRIX_WIDTH && y >= 0 && y <= MATRIX_HEIGHT)
+    if (isValid(x, y))
       _pLEDs[getPixelIndex(x, y)] = color;
   }
 
-  inline virtual void drawPixel(int x, CRGB color)
+  inline void drawPixel(int x, CRGB color)
   {
-    if (x >= 0 && x <= MATRIX_WIDTH * MATRIX_HEIGHT)
+    if (isValid(x))
       _pLEDs[x] = color;
   }
 
   inline void clearPixels()
   {
-    this->setPixels(0, this->GetLEDCount(), CRGB::Black);
+    memset((void *)_pLEDs, 0, sizeof(_pLEDs));
+  }
+
+  // GetFrameHash
+  //
+  // Cheap FNV-1a style hash of the frame, a word at a time, mixed with the brightness it would be shown at.
+  // Used by the output stage to skip sending frames that have not changed.
+
+  inline uint32_t GetFrameHash(uint8_t brightness) const
+  {
+    const uint8_t *pBytes = reinterpret_cast<const uint8_t *>(_pLEDs);
+    constexpr size_t cBytes = sizeof(_pLEDs);
+
+    uint32_t hash = 2166136261u ^ brightness;
+    size_t i = 0;
+    for (; i + sizeof(uint32_t) <= cBytes; i += sizeof(uint32_t))
+    {
+      uint32_t word;
+      memcpy(&word, pBytes + i, sizeof(word));
+      hash = (hash ^ word) * 16777619u;
+    }
+    for (; i < cBytes; i++)
+      hash = (hash ^ pBytes[i]) * 16777619u;
+
+    return hash;
+  }
+
+  // Q8 fixed point helpers
+  //
+  // Positions and lengths used by the span renderer are in 24.8 fixed point, ie: 1/256ths of a pixel.  Floats
+  // are floored rather than truncated, so that -0.5 lands in pixel -1 as it does on the Q8 side.
+
+  static inline int32_t toQ8(float f)
+  {
+    return (int32_t)floorf(f * 256.0f);
   }
 
-  inline void setPixels(float fPos, float count, CRGB c, bool bMerge = false) const
+  static inline int32_t toQ8(int i)
   {
-    float frac1 = fPos - floor(fPos);                 // eg:   3.25 becomes 0.25
-    float frac2 = fPos + count - floor(fPos + count); // eg:   3.25 + 1.5 yields 4.75 which becomes 0.75
+    return (int32_t)i << 8;
+  }
 
-    /*
-      Starting at 3.25, draw for 1.5:
-      We start at pixel 3.
-      We fill pixel with .75 worth of color
-      We advance to next pixel
+  // setPixelsQ8
+  //
+  // Anti-aliased span renderer.  Starting at 3.25 (832) and drawing for 2.5 (640) we fill pixel 3 with .75 worth
+  // of color, pixel 4 with the full color and pixel 5 with .75 worth of color.  The ESP8266 has no FPU, and this
+  // is the hottest function in nearly every effect, so it is integer only.
 
-      We fill one pixel and advance to next pixel
+  inline void setPixelsQ8(int32_t pos, int32_t count, CRGB c, bool bMerge = false)
+  {
+    if (count <= 0)
+      return;
+
+    const int32_t end = pos + count;
+    int32_t i = pos >> 8;                                 // Arithmetic shift, so negative positions floor correctly
+    const int32_t iEnd = end >> 8;
 
-      We are now at pixel 5, frac2 = .75
-      We fill pixel with .75 worth of color
-    */
+    // Whole span lands inside a single pixel
 
-    uint8_t fade1 = (std::max(frac1, 1.0f - count)) * 255; // Fraction is how far past pixel boundary we are (up to our total size) so larger fraction is more dimming
-    uint8_t fade2 = (1.0 - frac2) * 255;                   // Fraction is how far we are poking into this pixel, so larger fraction is less dimming
-    CRGB c1 = c;
-    CRGB c2 = c;
-    c1 = c1.fadeToBlackBy(fade1);
-    c2 = c2.fadeToBlackBy(fade2);
+    if (i == iEnd)
+    {
+      plotCoverage(i, c, count, bMerge);
+      return;
+    }
 
-    float p = fPos;
-    if (p >= 0 && p < GetLEDCount())
-      _pLEDs[(int)p] = bMerge ? _pLEDs[(int)p] + c1 : c1;
-    p = fPos + (1.0 - frac1);
-    count -= (1.0 - frac1);
+    // Lead pixel gets the part of it we cover, then the body pixels get full color, clipped to the strip
 
-    // Middle (body) pixels
+    plotCoverage(i++, c, 256 - (pos & 0xFF), bMerge);
 
-    while (count >= 1)
+    const int32_t iFirst = std::max<int32_t>(i, 0);
+    const int32_t iStop  = std::min<int32_t>(iEnd, LEDCount);
+    if (iStop > iFirst)
     {
-      if (p >= 0 && p < GetLEDCount())
-        _pLEDs[(int)p] = bMerge ? _pLEDs[(int)p] + c : c;
-      count--;
-      p++;
-    };
+      if (bMerge)
+        addColorToSpan(_pLEDs + iFirst, iStop - iFirst, c);
+      else
+        fillSpan(_pLEDs + iFirst, iStop - iFirst, c);
+    }
+
+    // Trail pixel gets however far we poke into it
 
-    // Final pixel, if in bounds
-    if (count > 0)
-      if (p >= 0 && p < GetLEDCount())
-        _pLEDs[(int)p] = bMerge ? _pLEDs[(int)p] + c2 : c2;
+    if (end & 0xFF)
+      plotCoverage(iEnd, c, end & 0xFF, bMerge);
+  }
+
+  // setPixels
+  //
+  // Floating point version of the span renderer, kept for effects that track their positions in floats
+
+  inline void setPixels(float fPos, float count, CRGB c, bool bMerge = false)
+  {
+    setPixelsQ8(toQ8(fPos), toQ8(count), c, bMerge);
   }
 
   inline uint16_t xy(uint8_t x, uint8_t y)
   {
-    if (x >= MATRIX_WIDTH || x < 0)
+    if (x >= W)
       return 0;
-    if (y >= MATRIX_HEIGHT || y < 0)
+    if (y >= H)
       return 0;
 
-    return (y * MATRIX_WIDTH) + x; // everything offset by one to capute out of bounds stuff - never displayed by ShowFrame()
+    return (y * W) + x; // everything offset by one to capute out of bounds stuff - never displayed by ShowFrame()
+  }
+
+private:
+
+  // plotCoverage
+  //
+  // Writes (or merges) a single pixel scaled by how much of it is covered, in 256ths
+
+  inline void plotCoverage(int32_t i, CRGB c, int32_t coverage, bool bMerge)
+  {
+    if ((uint32_t)i >= LEDCount)
+      return;
+
+    if (coverage < 256)
+      c.nscale8((uint8_t)coverage);
+
+    _pLEDs[i] = bMerge ? _pLEDs[i] + c : c;
   }
 };
+
+typedef LEDMatrixGFXT<MATRIX_WIDTH, MATRIX_HEIGHT> LEDMatrixGFX;
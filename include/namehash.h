@@ -0,0 +1,96 @@
+//+--------------------------------------------------------------------------
+//
+// File:        namehash.h
+//
+// Description:
+//
+//    Compile-time name hashing and the fixed hash index used by the effect,
+//    star type and palette registries.  Tables are keyed by the hash of a
+//    name, so looking something up from an MQTT message is one hash of the
+//    incoming name and a probe into a table that was laid out by the
+//    compiler, no String compares.
+//
+//---------------------------------------------------------------------------
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// NameHash
+//
+// 32-bit FNV-1a.  constexpr so tables can be keyed at compile time, and the same function hashes names at run time.
+
+constexpr uint32_t NameHash(const char *psz, size_t len)
+{
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < len; i++)
+        hash = (hash ^ (uint8_t)psz[i]) * 16777619u;
+    return hash;
+}
+
+constexpr uint32_t NameHash(const char *psz)
+{
+    uint32_t hash = 2166136261u;
+    while (*psz)
+        hash = (hash ^ (uint8_t)*psz++) * 16777619u;
+    return hash;
+}
+
+constexpr uint32_t operator""_h(const char *psz, size_t len)
+{
+    return NameHash(psz, len);
+}
+
+// HasUniqueHashes
+//
+// For static_asserts on the tables, two names landing on the same hash would make one of them unreachable
+
+template <typename Entry, size_t N>
+constexpr bool HasUniqueHashes(const Entry (&entries)[N])
+{
+    for (size_t i = 0; i < N; i++)
+        for (size_t j = i + 1; j < N; j++)
+            if (entries[i].hash == entries[j].hash)
+                return false;
+    return true;
+}
+
+// HashIndex
+//
+// Open addressing index over a table of entries that each have a 'hash' member.  It is built by the compiler, and
+// with the table at most half full a lookup is nearly always a single probe.
+
+template <size_t Slots>
+class HashIndex
+{
+  private:
+
+    uint8_t _slots[Slots];                      // Index of the entry + 1, 0 marks an empty slot
+
+  public:
+
+    template <typename Entry, size_t N>
+    constexpr HashIndex(const Entry (&entries)[N])
+      : _slots{}
+    {
+        static_assert(N < Slots && N < 255, "HashIndex needs more slots than entries");
+
+        for (size_t i = 0; i < N; i++)
+        {
+            size_t slot = entries[i].hash % Slots;
+            while (_slots[slot] != 0)
+                slot = (slot + 1) % Slots;
+            _slots[slot] = (uint8_t)(i + 1);
+        }
+    }
+
+    template <typename Entry, size_t N>
+    constexpr const Entry *Find(const Entry (&entries)[N], uint32_t hash) const
+    {
+        for (size_t slot = hash % Slots; _slots[slot] != 0; slot = (slot + 1) % Slots)
+            if (entries[_slots[slot] - 1].hash == hash)
+                return &entries[_slots[slot] - 1];
+        return nullptr;
+    }
+};
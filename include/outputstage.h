@@ -0,0 +1,256 @@
+//+--------------------------------------------------------------------------
+//
+// File:        outputstage.h
+//
+// Description:
+//
+//    Last step before a frame goes out to the strip.  Brightness, gamma and
+//    white balance are folded into one 256 entry table per color channel,
+//    rebuilt only when one of them changes, so applying all three costs a
+//    single table lookup per color byte.  Effects draw full scale colors
+//    and leave dimming to this stage.
+//
+//    The tables are 8.8 fixed point.  With dithering on, every color byte
+//    of every pixel keeps the fraction that was dropped last frame and adds
+//    it back in, so at low brightness a level between two 8-bit steps is
+//    shown by alternating between them rather than banding.
+//
+//    The same pass adds up the color bytes it sends, which is all an
+//    estimate of what the strip draws needs, so holding a channel to its
+//    power budget costs three adds a pixel rather than another pass over
+//    the frame.  Over budget, what comes out of the tables is scaled down
+//    from the next frame on with an integer multiply, see UpdatePower, so
+//    limiting never has the tables rebuilt.  The effect's own brightness
+//    goes into the same multiply, as it changes with every cross-fade.
+//
+//---------------------------------------------------------------------------
+
+#pragma once
+
+#include "globals.h"
+#include <math.h>
+#include <memory>
+
+class OutputStage
+{
+  protected:
+
+    uint16_t _lut[3][256];                      // 8.8 fixed point, never above 0xFF00 so adding a fraction can not overflow
+    uint8_t  _brightness;
+    uint8_t  _effectBrightness;                 // What the running effect asks to be shown at, see LEDStripEffect::OutputBrightness
+    uint8_t  _powerScale;                       // What the power limit leaves of the table values, 255 while it is not limiting
+    uint32_t _powerLimitMW;                     // 0 for no limit
+    uint32_t _milliwatts;                       // Estimated draw of the last frame applied
+    float    _gamma;
+    CRGB     _correction;
+    bool     _bDirty;
+
+    bool     _bDither;
+    std::unique_ptr<uint8_t[]> _pError;         // Fraction carried over per color byte, only allocated while dithering
+    size_t   _cErrorBytes;
+
+    void Rebuild()
+    {
+        for (int channel = 0; channel < 3; channel++)
+        {
+            // Everything is folded into one scale factor per channel, then gamma shapes the input
+
+            const float scale = _brightness * _correction[channel] / (255.0f * 255.0f);
+            for (int value = 0; value < 256; value++)
+            {
+                float x = value / 255.0f;
+                if (_gamma != 1.0f)
+                    x = powf(x, _gamma);
+                _lut[channel][value] = (uint16_t)std::min(x * scale * 255.0f * 256.0f + 0.5f, 65280.0f);
+            }
+        }
+        _bDirty = false;
+    }
+
+    // UpdatePower
+    //
+    // Estimates the draw of the frame just applied from the sums of its color bytes, then picks the power scale
+    // the next frame is applied with.  Drive power goes up and down with the scale, so the frame shows what scale
+    // would just fit the budget.  Over it, the scale drops straight there; under it, the scale climbs back by at
+    // most POWER_LIMIT_RECOVERY a frame, and never past what fits, so it does not see-saw around the limit.
+
+    void UpdatePower(uint32_t sumR, uint32_t sumG, uint32_t sumB, size_t count)
+    {
+        const uint32_t driveMW = (sumR * LED_RED_MW + sumG * LED_GREEN_MW + sumB * LED_BLUE_MW) / 255;
+        const uint32_t darkMW = count * LED_DARK_MW;
+        _milliwatts = driveMW + darkMW;
+
+        uint32_t scale = 255;
+        if (_powerLimitMW != 0 && driveMW != 0)
+        {
+            const uint32_t budgetMW = _powerLimitMW > darkMW ? _powerLimitMW - darkMW : 0;
+            scale = (uint32_t)std::min<uint64_t>((uint64_t)_powerScale * budgetMW / driveMW, 255);
+        }
+        scale = std::min<uint32_t>(scale, _powerScale + POWER_LIMIT_RECOVERY);
+
+        _powerScale = (uint8_t)scale;
+    }
+
+    // Error bytes start out staggered so that a flat area does not flip between levels all at once
+
+    void AllocateError(size_t cBytes)
+    {
+        _pError.reset(new uint8_t[cBytes]);
+        _cErrorBytes = cBytes;
+        for (size_t i = 0; i < cBytes; i++)
+            _pError[i] = (uint8_t)(i * 167);
+    }
+
+  public:
+
+    OutputStage()
+      : _brightness(255),
+        _effectBrightness(255),
+        _powerScale(255),
+        _powerLimitMW(0),
+        _milliwatts(0),
+        _gamma(OUTPUT_GAMMA),
+        _correction(OUTPUT_COLOR_CORRECTION),
+        _bDirty(true),
+        _bDither(false),
+        _cErrorBytes(0)
+    {
+    }
+
+    void SetBrightness(uint8_t brightness)
+    {
+        _bDirty |= brightness != _brightness;
+        _brightness = brightness;
+    }
+
+    uint8_t GetBrightness() const
+    {
+        return _brightness;
+    }
+
+    // SetEffectBrightness - How much of the brightness the effect is shown at, of 255, applied without a rebuild
+
+    void SetEffectBrightness(uint8_t brightness)
+    {
+        _effectBrightness = brightness;
+    }
+
+    uint8_t GetEffectBrightness() const
+    {
+        return _effectBrightness;
+    }
+
+    // SetPowerLimit - Most the strip may draw in milliwatts, 0 for no limit
+
+    void SetPowerLimit(uint32_t milliwatts)
+    {
+        _powerLimitMW = milliwatts;
+    }
+
+    // GetMilliwatts - Estimated draw of the last frame applied, with the power limit already taken into account
+
+    uint32_t GetMilliwatts() const
+    {
+        return _milliwatts;
+    }
+
+    // GetPowerScale - How much of the brightness the power limit lets through, 255 when it is not limiting
+
+    uint8_t GetPowerScale() const
+    {
+        return _powerScale;
+    }
+
+    void SetGamma(float gamma)
+    {
+        _bDirty |= gamma != _gamma;
+        _gamma = gamma;
+    }
+
+    void SetCorrection(CRGB correction)
+    {
+        _bDirty |= correction != _correction;
+        _correction = correction;
+    }
+
+    void SetDithering(bool bDither)
+    {
+        _bDither = bDither;
+        if (!bDither)
+        {
+            _pError.reset();
+            _cErrorBytes = 0;
+        }
+    }
+
+    bool GetDithering() const
+    {
+        return _bDither;
+    }
+
+    // Apply
+    //
+    // Maps a frame through the tables, pIn and pOut may be the same buffer.  Each table value is scaled by the
+    // effect's brightness and the power limit as it is read, 8.8 times (scale + 1) / 256, which leaves it as it
+    // is when both are 255.
+
+    void Apply(CRGB *pOut, const CRGB *pIn, size_t count)
+    {
+        if (_bDirty)
+            Rebuild();
+
+        const uint16_t *lutR = _lut[0];
+        const uint16_t *lutG = _lut[1];
+        const uint16_t *lutB = _lut[2];
+        const uint32_t power = ((_powerScale + 1) * (_effectBrightness + 1)) >> 8;
+
+        uint32_t sumR = 0, sumG = 0, sumB = 0;
+
+        if (!_bDither)
+        {
+            for (size_t i = 0; i < count; i++)
+            {
+                uint8_t r = (((lutR[pIn[i].r] * power) >> 8) + 0x80) >> 8;
+                uint8_t g = (((lutG[pIn[i].g] * power) >> 8) + 0x80) >> 8;
+                uint8_t b = (((lutB[pIn[i].b] * power) >> 8) + 0x80) >> 8;
+
+                pOut[i].r = r;
+                pOut[i].g = g;
+                pOut[i].b = b;
+
+                sumR += r;
+                sumG += g;
+                sumB += b;
+            }
+        }
+        else
+        {
+            if (_cErrorBytes != count * 3)
+                AllocateError(count * 3);
+
+            // Whole part goes out, fraction stays behind for next frame, no branches
+
+            uint8_t *pError = _pError.get();
+            for (size_t i = 0; i < count; i++, pError += 3)
+            {
+                uint16_t r = ((lutR[pIn[i].r] * power) >> 8) + pError[0];
+                uint16_t g = ((lutG[pIn[i].g] * power) >> 8) + pError[1];
+                uint16_t b = ((lutB[pIn[i].b] * power) >> 8) + pError[2];
+
+                pError[0] = (uint8_t)r;
+                pError[1] = (uint8_t)g;
+                pError[2] = (uint8_t)b;
+
+                pOut[i].r = r >> 8;
+                pOut[i].g = g >> 8;
+                pOut[i].b = b >> 8;
+
+                sumR += r >> 8;
+                sumG += g >> 8;
+                sumB += b >> 8;
+            }
+        }
+
+        UpdatePower(sumR, sumG, sumB, count);
+    }
+};
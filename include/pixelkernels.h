@@ -0,0 +1,233 @@
+//+--------------------------------------------------------------------------
+//
+// File:        pixelkernels.h
+//
+// Description:
+//
+//    Bulk operations on raw CRGB spans.  A CRGB span is just a run of color
+//    bytes, so most of these work a 32-bit word (four color channels) at a
+//    time, SWAR style: the even and odd bytes of a word are split into
+//    0x00FF00FF lanes so a single multiply or add handles two channels
+//    without one carrying into the next.  Spans do not have to be aligned,
+//    the leading bytes are done one at a time until the pointer is.
+//
+//---------------------------------------------------------------------------
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include "FastLED.h"
+
+namespace PixelKernels
+{
+    static const uint32_t EvenLanes = 0x00FF00FF;
+    static const uint32_t OddLanes  = 0xFF00FF00;
+
+    inline uint32_t loadWord(const uint8_t *p)
+    {
+        uint32_t word;
+        memcpy(&word, __builtin_assume_aligned(p, sizeof(uint32_t)), sizeof(word));
+        return word;
+    }
+
+    inline void storeWord(uint8_t *p, uint32_t word)
+    {
+        memcpy(__builtin_assume_aligned(p, sizeof(uint32_t)), &word, sizeof(word));
+    }
+
+    inline size_t bytesToAlign(const void *p)
+    {
+        return (sizeof(uint32_t) - ((uintptr_t)p & (sizeof(uint32_t) - 1))) & (sizeof(uint32_t) - 1);
+    }
+
+    // Scales every byte of a word by (scale + 1) / 256, the same rounding FastLED's scale8 uses
+
+    inline uint32_t scaleWord(uint32_t word, uint16_t scale)
+    {
+        uint32_t even = (((word & EvenLanes) * scale) >> 8) & EvenLanes;
+        uint32_t odd  = (((word >> 8) & EvenLanes) * scale) & OddLanes;
+        return even | odd;
+    }
+
+    // Per byte saturating add of two words
+
+    inline uint32_t addSaturateWord(uint32_t a, uint32_t b)
+    {
+        uint32_t sum      = ((a & 0x7F7F7F7F) + (b & 0x7F7F7F7F)) ^ ((a ^ b) & 0x80808080);
+        uint32_t overflow = ((a & b) | ((a | b) & ~sum)) & 0x80808080;
+        return sum | ((overflow >> 7) * 0xFF);
+    }
+
+    // Per byte lerp of two words, weight is 0..256 towards b
+
+    inline uint32_t lerpWord(uint32_t a, uint32_t b, uint16_t weight)
+    {
+        const uint32_t wA = 256 - weight;
+        uint32_t even = (((a & EvenLanes) * wA + (b & EvenLanes) * weight) >> 8) & EvenLanes;
+        uint32_t odd  = (((a >> 8) & EvenLanes) * wA + ((b >> 8) & EvenLanes) * weight) & OddLanes;
+        return even | odd;
+    }
+}
+
+// fillSpan
+//
+// Four pixels are exactly three words, so the color is pre-rotated into those three words once
+// and then stamped out twelve bytes at a time.
+
+inline void fillSpan(CRGB *pLEDs, size_t count, CRGB color)
+{
+    size_t i = 0;
+    while (i < count && PixelKernels::bytesToAlign(pLEDs + i) != 0)
+        pLEDs[i++] = color;
+
+    alignas(uint32_t) uint8_t pattern[12];
+    for (size_t j = 0; j < sizeof(pattern); j += sizeof(CRGB))
+        memcpy(pattern + j, color.raw, sizeof(CRGB));
+
+    const uint32_t w0 = PixelKernels::loadWord(pattern);
+    const uint32_t w1 = PixelKernels::loadWord(pattern + 4);
+    const uint32_t w2 = PixelKernels::loadWord(pattern + 8);
+
+    for (; i + 4 <= count; i += 4)
+    {
+        uint8_t *p = reinterpret_cast<uint8_t *>(pLEDs + i);
+        PixelKernels::storeWord(p, w0);
+        PixelKernels::storeWord(p + 4, w1);
+        PixelKernels::storeWord(p + 8, w2);
+    }
+
+    for (; i < count; i++)
+        pLEDs[i] = color;
+}
+
+// scaleSpan
+//
+// Same as calling nscale8 on every pixel
+
+inline void scaleSpan(CRGB *pLEDs, size_t count, uint8_t scale)
+{
+    uint8_t *p = reinterpret_cast<uint8_t *>(pLEDs);
+    const size_t cBytes = count * sizeof(CRGB);
+    const uint16_t scale16 = scale + 1;
+
+    size_t i = 0;
+    for (size_t head = std::min(PixelKernels::bytesToAlign(p), cBytes); i < head; i++)
+        p[i] = (p[i] * scale16) >> 8;
+
+    for (; i + sizeof(uint32_t) <= cBytes; i += sizeof(uint32_t))
+        PixelKernels::storeWord(p + i, PixelKernels::scaleWord(PixelKernels::loadWord(p + i), scale16));
+
+    for (; i < cBytes; i++)
+        p[i] = (p[i] * scale16) >> 8;
+}
+
+// fadeSpanToBlackBy
+//
+// Same as calling fadeToBlackBy on every pixel
+
+inline void fadeSpanToBlackBy(CRGB *pLEDs, size_t count, uint8_t fadeBy)
+{
+    scaleSpan(pLEDs, count, 255 - fadeBy);
+}
+
+// addSpan
+//
+// Saturating add of one span into another, what setPixels does with bMerge set
+
+inline void addSpan(CRGB *pDest, const CRGB *pSrc, size_t count)
+{
+    uint8_t *d = reinterpret_cast<uint8_t *>(pDest);
+    const uint8_t *s = reinterpret_cast<const uint8_t *>(pSrc);
+    const size_t cBytes = count * sizeof(CRGB);
+
+    size_t i = 0;
+    if (PixelKernels::bytesToAlign(d) == PixelKernels::bytesToAlign(s))
+    {
+        for (size_t head = std::min(PixelKernels::bytesToAlign(d), cBytes); i < head; i++)
+            d[i] = qadd8(d[i], s[i]);
+
+        for (; i + sizeof(uint32_t) <= cBytes; i += sizeof(uint32_t))
+            PixelKernels::storeWord(d + i, PixelKernels::addSaturateWord(PixelKernels::loadWord(d + i), PixelKernels::loadWord(s + i)));
+    }
+
+    for (; i < cBytes; i++)
+        d[i] = qadd8(d[i], s[i]);
+}
+
+// addColorToSpan
+//
+// Saturating add of a single color into every pixel of a span
+
+inline void addColorToSpan(CRGB *pLEDs, size_t count, CRGB color)
+{
+    size_t i = 0;
+    while (i < count && PixelKernels::bytesToAlign(pLEDs + i) != 0)
+        pLEDs[i++] += color;
+
+    alignas(uint32_t) uint8_t pattern[12];
+    for (size_t j = 0; j < sizeof(pattern); j += sizeof(CRGB))
+        memcpy(pattern + j, color.raw, sizeof(CRGB));
+
+    const uint32_t w0 = PixelKernels::loadWord(pattern);
+    const uint32_t w1 = PixelKernels::loadWord(pattern + 4);
+    const uint32_t w2 = PixelKernels::loadWord(pattern + 8);
+
+    for (; i + 4 <= count; i += 4)
+    {
+        uint8_t *p = reinterpret_cast<uint8_t *>(pLEDs + i);
+        PixelKernels::storeWord(p,     PixelKernels::addSaturateWord(PixelKernels::loadWord(p),     w0));
+        PixelKernels::storeWord(p + 4, PixelKernels::addSaturateWord(PixelKernels::loadWord(p + 4), w1));
+        PixelKernels::storeWord(p + 8, PixelKernels::addSaturateWord(PixelKernels::loadWord(p + 8), w2));
+    }
+
+    for (; i < count; i++)
+        pLEDs[i] += color;
+}
+
+// lerpSpan
+//
+// Per-pixel blend of two spans into a third, weight is 0..256 towards pB
+
+inline void lerpSpan(CRGB *pOut, const CRGB *pA, const CRGB *pB, size_t count, uint16_t weight)
+{
+    uint8_t *out = reinterpret_cast<uint8_t *>(pOut);
+    const uint8_t *a = reinterpret_cast<const uint8_t *>(pA);
+    const uint8_t *b = reinterpret_cast<const uint8_t *>(pB);
+    const size_t cBytes = count * sizeof(CRGB);
+    const uint16_t wA = 256 - weight;
+
+    size_t i = 0;
+    if (PixelKernels::bytesToAlign(out) == PixelKernels::bytesToAlign(a) && PixelKernels::bytesToAlign(a) == PixelKernels::bytesToAlign(b))
+    {
+        for (size_t head = std::min(PixelKernels::bytesToAlign(out), cBytes); i < head; i++)
+            out[i] = (a[i] * wA + b[i] * weight) >> 8;
+
+        for (; i + sizeof(uint32_t) <= cBytes; i += sizeof(uint32_t))
+            PixelKernels::storeWord(out + i, PixelKernels::lerpWord(PixelKernels::loadWord(a + i), PixelKernels::loadWord(b + i), weight));
+    }
+
+    for (; i < cBytes; i++)
+        out[i] = (a[i] * wA + b[i] * weight) >> 8;
+}
+
+// stochasticFadeSpan
+//
+// Fades a random half of the pixels (three quarters when bDense is set) by fadeBy.  Rather than rolling
+// the dice per pixel, one random word supplies the coin flips for 32 pixels, and the fade amount is
+// masked by the bit rather than branched on.  nextWord is any callable returning a random uint32_t.
+
+template <typename RandomWord>
+inline void stochasticFadeSpan(CRGB *pLEDs, size_t count, uint8_t fadeBy, RandomWord nextWord, bool bDense = false)
+{
+    for (size_t base = 0; base < count; base += 32)
+    {
+        uint32_t mask = nextWord();
+        if (bDense)
+            mask |= nextWord();
+
+        const size_t cChunk = std::min<size_t>(32, count - base);
+        for (size_t i = 0; i < cChunk; i++, mask >>= 1)
+            pLEDs[base + i].nscale8(255 - (fadeBy & (uint8_t)(0 - (mask & 1))));
+    }
+}
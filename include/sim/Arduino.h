@@ -0,0 +1,233 @@
+//+--------------------------------------------------------------------------
+//
+// File:        Arduino.h
+//
+// Description:
+//
+//    Host stand-in for the parts of the Arduino core the station uses, for
+//    the native build only (see [env:native] in platformio.ini).  Time comes
+//    from the simulator clock, which either follows the wall clock or only
+//    moves when the code waits, Serial goes to stdout, and ESP.restart()
+//    ends the simulation.  Only what this tree calls is here.
+//
+//---------------------------------------------------------------------------
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+
+#include "WString.h"
+
+// ARDUINO is left undefined so that ArduinoJson builds its plain C++ flavor
+
+#define PROGMEM
+#define IRAM_ATTR
+#define ICACHE_RAM_ATTR
+#define PSTR(s) (s)
+#define F(s) (s)
+#define pgm_read_byte(p)  (*(const uint8_t *)(p))
+#define pgm_read_word(p)  (*(const uint16_t *)(p))
+#define pgm_read_dword(p) (*(const uint32_t *)(p))
+
+#define LOW    0
+#define HIGH   1
+#define INPUT  0
+#define OUTPUT 1
+
+#define DEC 10
+#define HEX 16
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+using std::min;
+using std::max;
+
+template <typename T, typename L, typename H>
+inline T constrain(T x, L low, H high)
+{
+    return x < low ? low : (x > high ? high : x);
+}
+
+inline long map(long x, long in_min, long in_max, long out_min, long out_max)
+{
+    return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
+}
+
+// Time, see SimClock in simulator.h
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+
+// Random numbers, seeded by the simulator so that a run can be repeated
+
+long random(long howBig);
+long random(long howSmall, long howBig);
+void randomSeed(unsigned long seed);
+
+uint32_t SimHardwareRandom();
+#define RANDOM_REG32 SimHardwareRandom()
+
+// GPIO does nothing on the host
+
+inline void pinMode(uint8_t, uint8_t)
+{
+}
+
+inline void digitalWrite(uint8_t, uint8_t)
+{
+}
+
+inline int digitalRead(uint8_t)
+{
+    return LOW;
+}
+
+// Print
+//
+// Base of everything that can be printed to, as in the Arduino core: subclasses only write bytes.
+
+class Print;
+
+class Printable
+{
+  public:
+
+    virtual ~Printable()
+    {
+    }
+
+    virtual size_t printTo(Print &p) const = 0;
+};
+
+class Print
+{
+  private:
+
+    size_t printNumber(unsigned long long n, int base);
+
+  public:
+
+    virtual ~Print()
+    {
+    }
+
+    virtual size_t write(uint8_t c) = 0;
+
+    virtual size_t write(const uint8_t *buffer, size_t size)
+    {
+        size_t n = 0;
+        while (n < size && write(buffer[n]))
+            n++;
+        return n;
+    }
+
+    size_t write(const char *psz)
+    {
+        return psz ? write((const uint8_t *)psz, strlen(psz)) : 0;
+    }
+
+    virtual void flush()
+    {
+    }
+
+    size_t print(const char *psz)                        { return write(psz); }
+    size_t print(const String &s)                        { return write((const uint8_t *)s.c_str(), s.length()); }
+    size_t print(char c)                                 { return write((uint8_t)c); }
+    size_t print(unsigned char n, int base = DEC)        { return print((unsigned long)n, base); }
+    size_t print(int n, int base = DEC)                  { return print((long)n, base); }
+    size_t print(unsigned int n, int base = DEC)         { return print((unsigned long)n, base); }
+    size_t print(long n, int base = DEC);
+    size_t print(unsigned long n, int base = DEC)        { return printNumber(n, base); }
+    size_t print(long long n, int base = DEC);
+    size_t print(unsigned long long n, int base = DEC)   { return printNumber(n, base); }
+    size_t print(double n, int digits = 2);
+    size_t print(const Printable &x)                     { return x.printTo(*this); }
+
+    size_t println()
+    {
+        return write("\r\n");
+    }
+
+    template <typename T>
+    size_t println(const T &value)
+    {
+        size_t n = print(value);
+        return n + println();
+    }
+
+    template <typename T>
+    size_t println(const T &value, int format)
+    {
+        size_t n = print(value, format);
+        return n + println();
+    }
+
+    size_t printf(const char *format, ...) __attribute__((format(printf, 2, 3)));
+};
+
+// Serial
+//
+// Writes to stdout unless the simulator was asked to be quiet
+
+class HardwareSerial : public Print
+{
+  public:
+
+    void begin(unsigned long)
+    {
+    }
+
+    void end()
+    {
+    }
+
+    virtual size_t write(uint8_t c);
+    virtual size_t write(const uint8_t *buffer, size_t size);
+    virtual void flush();
+
+    using Print::write;
+};
+
+extern HardwareSerial Serial;
+
+// ESP
+//
+// The little of the ESP8266 SDK the station touches.  restart() ends the simulation, as there is nothing to
+// restart into.
+
+class EspClass
+{
+  public:
+
+    void restart();
+
+    uint32_t getFreeHeap()
+    {
+        return 0;
+    }
+
+    uint32_t getMaxFreeBlockSize()
+    {
+        return 0;
+    }
+
+    uint8_t getHeapFragmentation()
+    {
+        return 0;
+    }
+
+    uint32_t getCycleCount();
+};
+
+extern EspClass ESP;
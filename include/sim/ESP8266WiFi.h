@@ -0,0 +1,174 @@
+//+--------------------------------------------------------------------------
+//
+// File:        ESP8266WiFi.h
+//
+// Description:
+//
+//    WiFi for the native build.  The host is always on the network, so
+//    WiFi.begin connects at once.  WiFiClient is a plain TCP socket, which
+//    is what PubSubClient talks to the stand-in broker over.
+//
+//---------------------------------------------------------------------------
+
+#pragma once
+
+#include "Arduino.h"
+
+typedef enum
+{
+    WL_IDLE_STATUS     = 0,
+    WL_NO_SSID_AVAIL   = 1,
+    WL_SCAN_COMPLETED  = 2,
+    WL_CONNECTED       = 3,
+    WL_CONNECT_FAILED  = 4,
+    WL_CONNECTION_LOST = 5,
+    WL_WRONG_PASSWORD  = 6,
+    WL_DISCONNECTED    = 7
+} wl_status_t;
+
+typedef enum
+{
+    WIFI_OFF    = 0,
+    WIFI_STA    = 1,
+    WIFI_AP     = 2,
+    WIFI_AP_STA = 3
+} WiFiMode_t;
+
+class IPAddress : public Printable
+{
+  private:
+
+    uint8_t _bytes[4];
+
+  public:
+
+    IPAddress() : _bytes{0, 0, 0, 0}
+    {
+    }
+
+    IPAddress(uint8_t b1, uint8_t b2, uint8_t b3, uint8_t b4) : _bytes{b1, b2, b3, b4}
+    {
+    }
+
+    // fromString - Dotted quad only, the host names the ESP8266 core also takes are not needed here
+    bool fromString(const char *psz);
+
+    uint8_t operator[](int index) const
+    {
+        return _bytes[index];
+    }
+
+    bool isSet() const
+    {
+        return _bytes[0] || _bytes[1] || _bytes[2] || _bytes[3];
+    }
+
+    String toString() const;
+
+    virtual size_t printTo(Print &p) const
+    {
+        return p.print(toString());
+    }
+};
+
+// WiFiClient
+//
+// A TCP connection.  Reads never block; connect gives up after the timeout set with setTimeout.
+
+class WiFiClient : public Print
+{
+  private:
+
+    int           _socket;
+    unsigned long _timeoutMs;
+
+  public:
+
+    WiFiClient() : _socket(-1), _timeoutMs(1000)
+    {
+    }
+
+    virtual ~WiFiClient()
+    {
+        stop();
+    }
+
+    WiFiClient(const WiFiClient &) = delete;
+    WiFiClient &operator=(const WiFiClient &) = delete;
+
+    void setTimeout(unsigned long timeoutMs)
+    {
+        _timeoutMs = timeoutMs;
+    }
+
+    int connect(const char *host, uint16_t port);
+    int connect(IPAddress ip, uint16_t port);
+    uint8_t connected();
+    int available();
+    int read();
+    int read(uint8_t *buffer, size_t size);
+    void stop();
+
+    virtual size_t write(uint8_t c)
+    {
+        return write(&c, 1);
+    }
+
+    virtual size_t write(const uint8_t *buffer, size_t size);
+
+    using Print::write;
+};
+
+class ESP8266WiFiClass
+{
+  private:
+
+    wl_status_t _status;
+    WiFiMode_t  _mode;
+
+  public:
+
+    ESP8266WiFiClass() : _status(WL_IDLE_STATUS), _mode(WIFI_OFF)
+    {
+    }
+
+    bool mode(WiFiMode_t mode)
+    {
+        _mode = mode;
+        return true;
+    }
+
+    wl_status_t begin(const char *, const char * = NULL)
+    {
+        _status = WL_CONNECTED;
+        return _status;
+    }
+
+    bool disconnect(bool = false)
+    {
+        _status = WL_DISCONNECTED;
+        return true;
+    }
+
+    wl_status_t status() const
+    {
+        return _status;
+    }
+
+    bool isConnected() const
+    {
+        return _status == WL_CONNECTED;
+    }
+
+    bool setAutoReconnect(bool)
+    {
+        return true;
+    }
+
+    IPAddress localIP() const
+    {
+        return IPAddress(127, 0, 0, 1);
+    }
+};
+
+extern ESP8266WiFiClass WiFi;
@@ -0,0 +1,13 @@
+//+--------------------------------------------------------------------------
+//
+// File:        ESP8266WiFiSTA.h
+//
+// Description:
+//
+//    Station mode lives in ESP8266WiFi.h in the native build
+//
+//---------------------------------------------------------------------------
+
+#pragma once
+
+#include "ESP8266WiFi.h"
@@ -0,0 +1,105 @@
+//+--------------------------------------------------------------------------
+//
+// File:        FS.h
+//
+// Description:
+//
+//    Flash file system for the native build, kept in a directory on the
+//    host.  Paths are the device's, ie: "/config.txt", and land under the
+//    simulator's file system root, the project's data folder by default,
+//    which is also what gets uploaded to the device's LittleFS.
+//
+//---------------------------------------------------------------------------
+
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include "Arduino.h"
+
+class File : public Print
+{
+  private:
+
+    std::shared_ptr<FILE> _file;                        // Shared, as File is passed around by value
+
+  public:
+
+    File()
+    {
+    }
+
+    explicit File(FILE *file) : _file(file, fclose)
+    {
+    }
+
+    explicit operator bool() const
+    {
+        return _file != nullptr;
+    }
+
+    virtual size_t write(uint8_t c)
+    {
+        return write(&c, 1);
+    }
+
+    virtual size_t write(const uint8_t *buffer, size_t size)
+    {
+        return _file ? fwrite(buffer, 1, size, _file.get()) : 0;
+    }
+
+    using Print::write;
+
+    virtual void flush()
+    {
+        if (_file)
+            fflush(_file.get());
+    }
+
+    int read()
+    {
+        return _file ? fgetc(_file.get()) : -1;
+    }
+
+    size_t read(uint8_t *buffer, size_t size)
+    {
+        return _file ? fread(buffer, 1, size, _file.get()) : 0;
+    }
+
+    size_t size() const;
+    size_t position() const;
+    bool seek(uint32_t pos);
+
+    int available() const
+    {
+        return (int)(size() - position());
+    }
+
+    String readString();
+
+    void close()
+    {
+        _file.reset();
+    }
+};
+
+class FS
+{
+  private:
+
+    std::string Resolve(const char *path) const;
+
+  public:
+
+    bool begin();
+
+    void end()
+    {
+    }
+
+    File open(const char *path, const char *mode = "r");
+    bool exists(const char *path);
+    bool remove(const char *path);
+    bool mkdir(const char *path);
+};
@@ -0,0 +1,683 @@
+//+--------------------------------------------------------------------------
+//
+// File:        FastLED.h
+//
+// Description:
+//
+//    The slice of FastLED the effects draw with, for the native build:
+//    CRGB and CHSV, the 8-bit math helpers, 16 and 256 entry palettes and
+//    the handful of fill, fade and blend functions.  The math follows
+//    FastLED's portable C versions, so frames match the strip's closely but
+//    not bit for bit.  Controllers do not drive pins: showLeds hands the
+//    frame to the simulator, which can write it to a file.
+//
+//---------------------------------------------------------------------------
+
+#pragma once
+
+#include "Arduino.h"
+
+typedef uint8_t  fract8;
+typedef uint16_t fract16;
+
+// lib8tion
+
+inline uint8_t scale8(uint8_t i, fract8 scale)
+{
+    return (uint8_t)(((uint16_t)i * (1 + (uint16_t)scale)) >> 8);
+}
+
+// scale8_video - Like scale8, but never scales a nonzero value all the way to zero
+inline uint8_t scale8_video(uint8_t i, fract8 scale)
+{
+    return (uint8_t)((((int)i * (int)scale) >> 8) + ((i && scale) ? 1 : 0));
+}
+
+inline uint16_t scale16(uint16_t i, fract16 scale)
+{
+    return (uint16_t)(((uint32_t)i * (1 + (uint32_t)scale)) >> 16);
+}
+
+inline uint8_t qadd8(uint8_t i, uint8_t j)
+{
+    unsigned t = (unsigned)i + j;
+    return t > 255 ? 255 : (uint8_t)t;
+}
+
+inline uint8_t qsub8(uint8_t i, uint8_t j)
+{
+    int t = (int)i - j;
+    return t < 0 ? 0 : (uint8_t)t;
+}
+
+inline uint8_t blend8(uint8_t a, uint8_t b, fract8 amountOfB)
+{
+    uint16_t partial = (uint16_t)((a << 8) | b);
+    partial += (uint16_t)(b * amountOfB);
+    partial -= (uint16_t)(a * amountOfB);
+    return (uint8_t)(partial >> 8);
+}
+
+inline uint8_t lerp8by8(uint8_t a, uint8_t b, fract8 frac)
+{
+    return b > a ? (uint8_t)(a + scale8(b - a, frac)) : (uint8_t)(a - scale8(a - b, frac));
+}
+
+inline int16_t sin16(uint16_t theta)
+{
+    return (int16_t)lrintf(32767.0f * sinf(theta * (6.2831853f / 65536.0f)));
+}
+
+inline uint8_t sin8(uint8_t theta)
+{
+    return (uint8_t)(128 + lrintf(127.0f * sinf(theta * (6.2831853f / 256.0f))));
+}
+
+uint8_t random8();
+uint8_t random8(uint8_t lim);
+uint16_t random16();
+uint16_t random16(uint16_t lim);
+void random16_set_seed(uint16_t seed);
+void random16_add_entropy(uint16_t entropy);
+
+// beat16 - Sawtooth that goes round 65536 times a minute at the given beats per minute
+inline uint16_t beat16(uint16_t bpm, uint32_t timebase = 0)
+{
+    if (bpm < 256)
+        bpm <<= 8;                              // Whole beats per minute rather than Q8.8
+    return (uint16_t)(((millis() - timebase) * bpm * 280) >> 16);
+}
+
+inline uint16_t beatsin16(uint16_t bpm, uint16_t lowest = 0, uint16_t highest = 65535, uint32_t timebase = 0, uint16_t phase = 0)
+{
+    uint16_t beatsin = (uint16_t)(sin16(beat16(bpm, timebase) + phase) + 32768);
+    return (uint16_t)(lowest + scale16(beatsin, highest - lowest));
+}
+
+inline uint8_t beatsin8(uint16_t bpm, uint8_t lowest = 0, uint8_t highest = 255, uint32_t timebase = 0, uint8_t phase = 0)
+{
+    uint8_t beatsin = sin8((uint8_t)(beat16(bpm, timebase) >> 8) + phase);
+    return (uint8_t)(lowest + scale8(beatsin, highest - lowest));
+}
+
+// Colors
+
+enum HSVHue
+{
+    HUE_RED    = 0,
+    HUE_ORANGE = 32,
+    HUE_YELLOW = 64,
+    HUE_GREEN  = 96,
+    HUE_AQUA   = 128,
+    HUE_BLUE   = 160,
+    HUE_PURPLE = 192,
+    HUE_PINK   = 224
+};
+
+struct CHSV
+{
+    union
+    {
+        struct
+        {
+            uint8_t hue;
+            uint8_t sat;
+            uint8_t val;
+        };
+        uint8_t raw[3];
+    };
+
+    CHSV() : hue(0), sat(0), val(0)
+    {
+    }
+
+    CHSV(uint8_t ih, uint8_t is, uint8_t iv) : hue(ih), sat(is), val(iv)
+    {
+    }
+};
+
+struct CRGB;
+void hsv2rgb_rainbow(const CHSV &hsv, CRGB &rgb);
+
+struct CRGB
+{
+    union
+    {
+        struct
+        {
+            uint8_t r;
+            uint8_t g;
+            uint8_t b;
+        };
+        uint8_t raw[3];
+    };
+
+    enum HTMLColorCode : uint32_t
+    {
+        Black           = 0x000000,
+        Blue            = 0x0000FF,
+        Cyan            = 0x00FFFF,
+        DarkBlue        = 0x00008B,
+        DarkGreen       = 0x006400,
+        DarkMagenta     = 0x8B008B,
+        DarkRed         = 0x8B0000,
+        DarkSalmon      = 0xE9967A,
+        DarkViolet      = 0x9400D3,
+        DeepPink        = 0xFF1493,
+        Gray            = 0x808080,
+        Green           = 0x008000,
+        HotPink         = 0xFF69B4,
+        Indigo          = 0x4B0082,
+        LightCoral      = 0xF08080,
+        LightPink       = 0xFFB6C1,
+        LimeGreen       = 0x32CD32,
+        Magenta         = 0xFF00FF,
+        Maroon          = 0x800000,
+        MediumBlue      = 0x0000CD,
+        MediumPurple    = 0x9370DB,
+        MediumVioletRed = 0xC71585,
+        Orange          = 0xFFA500,
+        OrangeRed       = 0xFF4500,
+        Pink            = 0xFFC0CB,
+        Purple          = 0x800080,
+        Red             = 0xFF0000,
+        Violet          = 0xEE82EE,
+        White           = 0xFFFFFF,
+        Yellow          = 0xFFFF00
+    };
+
+    CRGB() : r(0), g(0), b(0)
+    {
+    }
+
+    constexpr CRGB(uint8_t ir, uint8_t ig, uint8_t ib) : r(ir), g(ig), b(ib)
+    {
+    }
+
+    constexpr CRGB(uint32_t colorcode) : r((colorcode >> 16) & 0xFF), g((colorcode >> 8) & 0xFF), b(colorcode & 0xFF)
+    {
+    }
+
+    constexpr CRGB(HTMLColorCode colorcode) : CRGB((uint32_t)colorcode)
+    {
+    }
+
+    CRGB(const CHSV &rhs)
+    {
+        hsv2rgb_rainbow(rhs, *this);
+    }
+
+    CRGB &operator=(const CHSV &rhs)
+    {
+        hsv2rgb_rainbow(rhs, *this);
+        return *this;
+    }
+
+    uint8_t &operator[](uint8_t x)
+    {
+        return raw[x];
+    }
+
+    const uint8_t &operator[](uint8_t x) const
+    {
+        return raw[x];
+    }
+
+    CRGB &setRGB(uint8_t nr, uint8_t ng, uint8_t nb)
+    {
+        r = nr;
+        g = ng;
+        b = nb;
+        return *this;
+    }
+
+    CRGB &setHSV(uint8_t hue, uint8_t sat, uint8_t val)
+    {
+        hsv2rgb_rainbow(CHSV(hue, sat, val), *this);
+        return *this;
+    }
+
+    CRGB &setHue(uint8_t hue)
+    {
+        return setHSV(hue, 255, 255);
+    }
+
+    CRGB &operator+=(const CRGB &rhs)
+    {
+        r = qadd8(r, rhs.r);
+        g = qadd8(g, rhs.g);
+        b = qadd8(b, rhs.b);
+        return *this;
+    }
+
+    CRGB &operator-=(const CRGB &rhs)
+    {
+        r = qsub8(r, rhs.r);
+        g = qsub8(g, rhs.g);
+        b = qsub8(b, rhs.b);
+        return *this;
+    }
+
+    CRGB &nscale8(uint8_t scale)
+    {
+        r = scale8(r, scale);
+        g = scale8(g, scale);
+        b = scale8(b, scale);
+        return *this;
+    }
+
+    CRGB &nscale8_video(uint8_t scale)
+    {
+        r = scale8_video(r, scale);
+        g = scale8_video(g, scale);
+        b = scale8_video(b, scale);
+        return *this;
+    }
+
+    CRGB &fadeToBlackBy(uint8_t fadefactor)
+    {
+        return nscale8(255 - fadefactor);
+    }
+
+    CRGB &operator%=(uint8_t scale)
+    {
+        return nscale8_video(scale);
+    }
+
+    CRGB &operator*=(uint8_t d)
+    {
+        r = (uint8_t)std::min(255, r * d);
+        g = (uint8_t)std::min(255, g * d);
+        b = (uint8_t)std::min(255, b * d);
+        return *this;
+    }
+
+    CRGB &operator/=(uint8_t d)
+    {
+        r /= d;
+        g /= d;
+        b /= d;
+        return *this;
+    }
+
+    CRGB &operator|=(const CRGB &rhs)
+    {
+        r = std::max(r, rhs.r);
+        g = std::max(g, rhs.g);
+        b = std::max(b, rhs.b);
+        return *this;
+    }
+
+    explicit operator bool() const
+    {
+        return r || g || b;
+    }
+
+    uint8_t getLuma() const
+    {
+        return scale8(r, 54) + scale8(g, 183) + scale8(b, 18);
+    }
+
+    uint8_t getAverageLight() const
+    {
+        return scale8(r, 85) + scale8(g, 85) + scale8(b, 85);
+    }
+
+    CRGB lerp8(const CRGB &other, fract8 frac) const
+    {
+        return CRGB(lerp8by8(r, other.r, frac), lerp8by8(g, other.g, frac), lerp8by8(b, other.b, frac));
+    }
+};
+
+inline bool operator==(const CRGB &lhs, const CRGB &rhs)
+{
+    return lhs.r == rhs.r && lhs.g == rhs.g && lhs.b == rhs.b;
+}
+
+inline bool operator!=(const CRGB &lhs, const CRGB &rhs)
+{
+    return !(lhs == rhs);
+}
+
+inline CRGB operator+(const CRGB &p1, const CRGB &p2)
+{
+    return CRGB(qadd8(p1.r, p2.r), qadd8(p1.g, p2.g), qadd8(p1.b, p2.b));
+}
+
+inline CRGB operator-(const CRGB &p1, const CRGB &p2)
+{
+    return CRGB(qsub8(p1.r, p2.r), qsub8(p1.g, p2.g), qsub8(p1.b, p2.b));
+}
+
+inline CRGB operator*(const CRGB &p1, uint8_t d)
+{
+    CRGB result(p1);
+    return result *= d;
+}
+
+inline CRGB operator%(const CRGB &p1, uint8_t d)
+{
+    CRGB result(p1);
+    return result %= d;
+}
+
+inline CRGB blend(const CRGB &p1, const CRGB &p2, fract8 amountOfP2)
+{
+    return CRGB(blend8(p1.r, p2.r, amountOfP2), blend8(p1.g, p2.g, amountOfP2), blend8(p1.b, p2.b, amountOfP2));
+}
+
+CRGB &nblend(CRGB &existing, const CRGB &overlay, fract8 amountOfOverlay);
+void fill_solid(CRGB *leds, int numToFill, const CRGB &color);
+void fill_rainbow(CRGB *leds, int numToFill, uint8_t initialhue, uint8_t deltahue = 5);
+void fadeToBlackBy(CRGB *leds, uint16_t numLeds, uint8_t fadeBy);
+void nscale8(CRGB *leds, uint16_t numLeds, uint8_t scale);
+void blur1d(CRGB *leds, uint16_t numLeds, fract8 blurAmount);
+
+// Palettes
+
+typedef uint32_t TProgmemRGBPalette16[16];
+typedef uint8_t TProgmemRGBGradientPalette_byte;
+typedef const TProgmemRGBGradientPalette_byte *TProgmemRGBGradientPalette_bytes;
+typedef TProgmemRGBGradientPalette_bytes TProgmemRGBGradientPaletteRef;
+
+#define FL_PROGMEM
+#define DEFINE_GRADIENT_PALETTE(X) extern const TProgmemRGBGradientPalette_byte X[] FL_PROGMEM =
+#define DECLARE_GRADIENT_PALETTE(X) extern const TProgmemRGBGradientPalette_byte X[] FL_PROGMEM
+
+enum TBlendType
+{
+    NOBLEND     = 0,
+    LINEARBLEND = 1
+};
+
+class CRGBPalette16;
+class CRGBPalette256;
+
+CRGB ColorFromPalette(const CRGBPalette16 &pal, uint8_t index, uint8_t brightness = 255, TBlendType blendType = LINEARBLEND);
+CRGB ColorFromPalette(const CRGBPalette256 &pal, uint8_t index, uint8_t brightness = 255, TBlendType blendType = NOBLEND);
+
+// FillGradient - Spreads a gradient palette (index, r, g, b quads ending at index 255) across count entries
+void FillGradient(CRGB *entries, int count, TProgmemRGBGradientPalette_bytes gradient);
+
+class CRGBPalette16
+{
+  public:
+
+    CRGB entries[16];
+
+    CRGBPalette16()
+    {
+    }
+
+    CRGBPalette16(const TProgmemRGBPalette16 &rhs)
+    {
+        for (int i = 0; i < 16; i++)
+            entries[i] = CRGB(rhs[i]);
+    }
+
+    CRGBPalette16(TProgmemRGBGradientPalette_bytes gradient)
+    {
+        FillGradient(entries, 16, gradient);
+    }
+
+    CRGBPalette16(const CRGB &c00, const CRGB &c01, const CRGB &c02, const CRGB &c03,
+                  const CRGB &c04, const CRGB &c05, const CRGB &c06, const CRGB &c07,
+                  const CRGB &c08, const CRGB &c09, const CRGB &c10, const CRGB &c11,
+                  const CRGB &c12, const CRGB &c13, const CRGB &c14, const CRGB &c15)
+      : entries{c00, c01, c02, c03, c04, c05, c06, c07, c08, c09, c10, c11, c12, c13, c14, c15}
+    {
+    }
+
+    CRGB &operator[](uint8_t x)
+    {
+        return entries[x];
+    }
+
+    const CRGB &operator[](uint8_t x) const
+    {
+        return entries[x];
+    }
+};
+
+class CRGBPalette256
+{
+  public:
+
+    CRGB entries[256];
+
+    CRGBPalette256()
+    {
+    }
+
+    CRGBPalette256(const CRGBPalette16 &rhs)
+    {
+        for (int i = 0; i < 256; i++)
+            entries[i] = ColorFromPalette(rhs, (uint8_t)i);
+    }
+
+    CRGBPalette256(const TProgmemRGBPalette16 &rhs)
+      : CRGBPalette256(CRGBPalette16(rhs))
+    {
+    }
+
+    CRGBPalette256(TProgmemRGBGradientPalette_bytes gradient)
+    {
+        FillGradient(entries, 256, gradient);
+    }
+
+    CRGBPalette256(const CRGB &c1, const CRGB &c2)
+    {
+        for (int i = 0; i < 256; i++)
+            entries[i] = blend(c1, c2, (fract8)i);
+    }
+
+    CRGBPalette256(const CRGB &c00, const CRGB &c01, const CRGB &c02, const CRGB &c03,
+                   const CRGB &c04, const CRGB &c05, const CRGB &c06, const CRGB &c07,
+                   const CRGB &c08, const CRGB &c09, const CRGB &c10, const CRGB &c11,
+                   const CRGB &c12, const CRGB &c13, const CRGB &c14, const CRGB &c15)
+      : CRGBPalette256(CRGBPalette16(c00, c01, c02, c03, c04, c05, c06, c07, c08, c09, c10, c11, c12, c13, c14, c15))
+    {
+    }
+
+    CRGB &operator[](uint8_t x)
+    {
+        return entries[x];
+    }
+
+    const CRGB &operator[](uint8_t x) const
+    {
+        return entries[x];
+    }
+};
+
+extern const TProgmemRGBPalette16 RainbowColors_p;
+extern const TProgmemRGBPalette16 RainbowStripeColors_p;
+extern const TProgmemRGBPalette16 HeatColors_p;
+
+// Controllers
+
+enum EOrder
+{
+    RGB = 0012,
+    RBG = 0021,
+    GRB = 0102,
+    GBR = 0120,
+    BRG = 0201,
+    BGR = 0210
+};
+
+enum EDitherMode
+{
+    DISABLE_DITHER = 0x00,
+    BINARY_DITHER  = 0x01
+};
+
+enum LEDColorCorrection : uint32_t
+{
+    TypicalSMD5050  = 0xFFB0F0,
+    TypicalLEDStrip = 0xFFB0F0,
+    Typical8mmPixel = 0xFFE08C,
+    UncorrectedColor = 0xFFFFFF
+};
+
+enum ColorTemperature : uint32_t
+{
+    UncorrectedTemperature = 0xFFFFFF
+};
+
+template <uint8_t DATA_PIN, EOrder RGB_ORDER>
+class WS2812
+{
+};
+
+template <uint8_t DATA_PIN, EOrder RGB_ORDER>
+class WS2812B
+{
+};
+
+// CLEDController
+//
+// One strip.  showLeds passes the frame, scaled by the brightness, on to the simulator's frame sink.
+
+class CLEDController
+{
+  private:
+
+    int     _index;
+    CRGB   *_leds;
+    int     _nLeds;
+    CRGB    _correction;
+    uint8_t _ditherMode;
+
+  public:
+
+    CLEDController() : _index(0), _leds(NULL), _nLeds(0), _correction(UncorrectedColor), _ditherMode(BINARY_DITHER)
+    {
+    }
+
+    void Attach(int index, CRGB *leds, int nLeds)
+    {
+        _index = index;
+        setLeds(leds, nLeds);
+    }
+
+    CLEDController &setLeds(CRGB *leds, int nLeds)
+    {
+        _leds = leds;
+        _nLeds = nLeds;
+        return *this;
+    }
+
+    CLEDController &setCorrection(CRGB correction)
+    {
+        _correction = correction;
+        return *this;
+    }
+
+    CLEDController &setDither(uint8_t ditherMode)
+    {
+        _ditherMode = ditherMode;
+        return *this;
+    }
+
+    void clearLedData()
+    {
+        if (_leds)
+            fill_solid(_leds, _nLeds, CRGB::Black);
+    }
+
+    void showLeds(uint8_t brightness = 255);
+
+    CRGB *leds()
+    {
+        return _leds;
+    }
+
+    int size() const
+    {
+        return _nLeds;
+    }
+};
+
+#define FASTLED_MAX_CONTROLLERS 8
+
+class CFastLED
+{
+  private:
+
+    CLEDController _controllers[FASTLED_MAX_CONTROLLERS];
+    int            _nControllers;
+    uint8_t        _brightness;
+
+    CLEDController &AddController(CRGB *leds, int nLeds);
+
+  public:
+
+    CFastLED() : _nControllers(0), _brightness(255)
+    {
+    }
+
+    template <template <uint8_t DATA_PIN, EOrder RGB_ORDER> class CHIPSET, uint8_t DATA_PIN, EOrder RGB_ORDER = RGB>
+    CLEDController &addLeds(CRGB *data, int nLedsOrOffset, int nLedsIfOffset = 0)
+    {
+        return nLedsIfOffset > 0 ? AddController(data + nLedsOrOffset, nLedsIfOffset) : AddController(data, nLedsOrOffset);
+    }
+
+    CLEDController &operator[](int x)
+    {
+        return _controllers[x < _nControllers ? x : 0];
+    }
+
+    int count() const
+    {
+        return _nControllers;
+    }
+
+    CRGB *leds()
+    {
+        return _controllers[0].leds();
+    }
+
+    int size()
+    {
+        return _controllers[0].size();
+    }
+
+    void setBrightness(uint8_t scale)
+    {
+        _brightness = scale;
+    }
+
+    uint8_t getBrightness() const
+    {
+        return _brightness;
+    }
+
+    void setCorrection(CRGB correction)
+    {
+        for (int i = 0; i < _nControllers; i++)
+            _controllers[i].setCorrection(correction);
+    }
+
+    void setDither(uint8_t ditherMode)
+    {
+        for (int i = 0; i < _nControllers; i++)
+            _controllers[i].setDither(ditherMode);
+    }
+
+    void show()
+    {
+        for (int i = 0; i < _nControllers; i++)
+            _controllers[i].showLeds(_brightness);
+    }
+
+    void clear(bool writeData = false)
+    {
+        for (int i = 0; i < _nControllers; i++)
+            _controllers[i].clearLedData();
+        if (writeData)
+            show();
+    }
+};
+
+extern CFastLED FastLED;
@@ -0,0 +1,15 @@
+//+--------------------------------------------------------------------------
+//
+// File:        LITTLEFS.h
+//
+// Description:
+//
+//    LittleFS for the native build, a directory on the host, see FS.h
+//
+//---------------------------------------------------------------------------
+
+#pragma once
+
+#include "FS.h"
+
+extern FS LittleFS;
@@ -0,0 +1,107 @@
+//+--------------------------------------------------------------------------
+//
+// File:        PubSubClient.h
+//
+// Description:
+//
+//    MQTT client for the native build.  With no broker given it talks to an
+//    in-process stand-in that accepts the connection, prints what the
+//    station publishes and delivers the messages queued with
+//    SimQueueMessage.  Given a host and port (see simulator.h) it talks to
+//    anything there that takes a TCP connection and exchanges lines of
+//    text, ie: `nc -lk 1883`:
+//
+//      topic payload\n     each way, a message to or from the station
+//
+//    Newlines in what the station publishes are sent as the two characters
+//    \n, so that each message stays on its line.
+//
+//    Either way, messages on a topic the station has subscribed to are
+//    handed to the callback from loop().
+//
+//---------------------------------------------------------------------------
+
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "Arduino.h"
+#include "ESP8266WiFi.h"
+
+#define MQTTQOS0 0
+#define MQTTQOS1 1
+
+#define MQTT_MAX_PACKET_SIZE 256
+
+#define MQTT_CONNECTION_TIMEOUT     -4
+#define MQTT_CONNECTION_LOST        -3
+#define MQTT_CONNECT_FAILED         -2
+#define MQTT_DISCONNECTED           -1
+#define MQTT_CONNECTED               0
+
+#define MQTT_CALLBACK_SIGNATURE std::function<void(char *, uint8_t *, unsigned int)> callback
+
+class PubSubClient
+{
+  private:
+
+    WiFiClient              &_client;
+    IPAddress                _ip;
+    uint16_t                 _port;
+    int                      _state;
+    bool                     _bInProcess;               // Talking to the stand-in, not over a socket
+    unsigned long            _connectedMs;
+    MQTT_CALLBACK_SIGNATURE;
+    std::vector<std::string> _subscriptions;
+    std::string              _pending;                  // Received bytes not yet making up a whole line
+    std::string              _publishTopic;             // Of the message beginPublish started
+    std::string              _publishPayload;
+
+    bool Matches(const std::string &topic) const;
+    void DispatchLine(std::string &line);
+    void Dispatch(const std::string &topic, const std::string &payload);
+
+  public:
+
+    explicit PubSubClient(WiFiClient &client)
+      : _client(client), _port(1883), _state(MQTT_DISCONNECTED), _bInProcess(false), _connectedMs(0)
+    {
+    }
+
+    PubSubClient &setServer(IPAddress ip, uint16_t port)
+    {
+        _ip = ip;
+        _port = port;
+        return *this;
+    }
+
+    PubSubClient &setCallback(MQTT_CALLBACK_SIGNATURE)
+    {
+        this->callback = callback;
+        return *this;
+    }
+
+    PubSubClient &setSocketTimeout(uint16_t)
+    {
+        return *this;
+    }
+
+    bool connect(const char *id);
+    void disconnect();
+    bool connected();
+    bool loop();
+    bool subscribe(const char *topic, uint8_t qos = MQTTQOS0);
+    bool publish(const char *topic, const char *payload, bool retained = false);
+
+    // A message longer than the buffer, written a piece at a time and sent by endPublish
+    bool beginPublish(const char *topic, unsigned int length, bool retained);
+    size_t write(const uint8_t *buffer, size_t size);
+    int endPublish();
+
+    int state() const
+    {
+        return _state;
+    }
+};
@@ -0,0 +1,13 @@
+//+--------------------------------------------------------------------------
+//
+// File:        SPI.h
+//
+// Description:
+//
+//    Nothing in the native build talks to a SPI bus, the header only has to exist
+//
+//---------------------------------------------------------------------------
+
+#pragma once
+
+#include "Arduino.h"
@@ -0,0 +1,194 @@
+//+--------------------------------------------------------------------------
+//
+// File:        WString.h
+//
+// Description:
+//
+//    Arduino's String for the native build, kept in a std::string.  Covers
+//    the members this tree uses, with the same behavior for
+//    numbers (base 10, two decimals for floating point).
+//
+//---------------------------------------------------------------------------
+
+#pragma once
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <type_traits>
+
+class String
+{
+  private:
+
+    std::string _s;
+
+    static std::string FromUnsigned(unsigned long long value, unsigned char base)
+    {
+        char buffer[8 * sizeof(value) + 1];
+        char *p = &buffer[sizeof(buffer) - 1];
+        *p = '\0';
+        if (base < 2)
+            base = 10;
+        do
+        {
+            unsigned digit = value % base;
+            *--p = (char)(digit < 10 ? '0' + digit : 'a' + digit - 10);
+            value /= base;
+        } while (value);
+        return p;
+    }
+
+    static std::string FromSigned(long long value, unsigned char base)
+    {
+        if (value < 0 && base == 10)
+            return "-" + FromUnsigned(0ULL - (unsigned long long)value, base);
+        return FromUnsigned((unsigned long long)value, base);
+    }
+
+    static std::string FromDouble(double value, unsigned char decimals)
+    {
+        char buffer[64];
+        snprintf(buffer, sizeof(buffer), "%.*f", decimals, value);
+        return buffer;
+    }
+
+  public:
+
+    String()
+    {
+    }
+
+    String(const char *psz) : _s(psz ? psz : "")
+    {
+    }
+
+    String(const std::string &s) : _s(s)
+    {
+    }
+
+    explicit String(char c) : _s(1, c)
+    {
+    }
+
+    explicit String(unsigned char n, unsigned char base = 10)      : _s(FromUnsigned(n, base)) {}
+    explicit String(int n, unsigned char base = 10)                : _s(FromSigned(n, base)) {}
+    explicit String(unsigned int n, unsigned char base = 10)       : _s(FromUnsigned(n, base)) {}
+    explicit String(long n, unsigned char base = 10)               : _s(FromSigned(n, base)) {}
+    explicit String(unsigned long n, unsigned char base = 10)      : _s(FromUnsigned(n, base)) {}
+    explicit String(long long n, unsigned char base = 10)          : _s(FromSigned(n, base)) {}
+    explicit String(unsigned long long n, unsigned char base = 10) : _s(FromUnsigned(n, base)) {}
+    explicit String(float n, unsigned char decimals = 2)           : _s(FromDouble(n, decimals)) {}
+    explicit String(double n, unsigned char decimals = 2)          : _s(FromDouble(n, decimals)) {}
+
+    const char *c_str() const             { return _s.c_str(); }
+    unsigned int length() const           { return (unsigned int)_s.length(); }
+    bool isEmpty() const                  { return _s.empty(); }
+    bool reserve(unsigned int size)       { _s.reserve(size); return true; }
+
+    char charAt(unsigned int index) const { return index < _s.length() ? _s[index] : '\0'; }
+    char operator[](unsigned int index) const { return charAt(index); }
+    char &operator[](unsigned int index)  { return _s[index]; }
+
+    long toInt() const                    { return atol(_s.c_str()); }
+    float toFloat() const                 { return (float)atof(_s.c_str()); }
+    double toDouble() const               { return atof(_s.c_str()); }
+
+    void toCharArray(char *buffer, unsigned int size, unsigned int index = 0) const
+    {
+        if (!buffer || size == 0)
+            return;
+        size_t n = index < _s.length() ? std::min<size_t>(size - 1, _s.length() - index) : 0;
+        memcpy(buffer, _s.c_str() + index, n);
+        buffer[n] = '\0';
+    }
+
+    String substring(unsigned int from) const
+    {
+        return from < _s.length() ? String(_s.substr(from)) : String();
+    }
+
+    String substring(unsigned int from, unsigned int to) const
+    {
+        if (from > to)
+            std::swap(from, to);
+        return from < _s.length() ? String(_s.substr(from, to - from)) : String();
+    }
+
+    int indexOf(char c, unsigned int from = 0) const
+    {
+        size_t pos = _s.find(c, from);
+        return pos == std::string::npos ? -1 : (int)pos;
+    }
+
+    int indexOf(const String &s, unsigned int from = 0) const
+    {
+        size_t pos = _s.find(s._s, from);
+        return pos == std::string::npos ? -1 : (int)pos;
+    }
+
+    bool startsWith(const String &prefix) const
+    {
+        return _s.compare(0, prefix._s.length(), prefix._s) == 0;
+    }
+
+    bool endsWith(const String &suffix) const
+    {
+        return _s.length() >= suffix._s.length() &&
+               _s.compare(_s.length() - suffix._s.length(), suffix._s.length(), suffix._s) == 0;
+    }
+
+    void trim()
+    {
+        const char *ws = " \t\r\n";
+        size_t first = _s.find_first_not_of(ws);
+        if (first == std::string::npos)
+        {
+            _s.clear();
+            return;
+        }
+        _s = _s.substr(first, _s.find_last_not_of(ws) - first + 1);
+    }
+
+    bool equals(const String &s) const             { return _s == s._s; }
+    bool operator==(const String &s) const         { return _s == s._s; }
+    bool operator==(const char *psz) const         { return _s == (psz ? psz : ""); }
+    bool operator!=(const String &s) const         { return _s != s._s; }
+    bool operator!=(const char *psz) const         { return !(*this == psz); }
+    bool operator<(const String &s) const          { return _s < s._s; }
+
+    bool concat(const String &s)                   { _s += s._s; return true; }
+    bool concat(const char *psz)                   { if (psz) _s += psz; return true; }
+    bool concat(const char *p, unsigned int cb)    { if (p) _s.append(p, cb); return true; }
+    bool concat(char c)                            { _s += c; return true; }
+
+    // Arduino's String appends numbers as text
+    template <typename T, typename std::enable_if<std::is_arithmetic<T>::value && !std::is_same<T, char>::value, int>::type = 0>
+    bool concat(T n)
+    {
+        return concat(String(n));
+    }
+
+    template <typename T>
+    String &operator+=(const T &value)
+    {
+        concat(value);
+        return *this;
+    }
+
+    template <typename T>
+    friend String operator+(const String &lhs, const T &rhs)
+    {
+        String result(lhs);
+        result.concat(rhs);
+        return result;
+    }
+
+    friend String operator+(const char *lhs, const String &rhs)
+    {
+        String result(lhs);
+        result.concat(rhs);
+        return result;
+    }
+};
@@ -0,0 +1,65 @@
+//+--------------------------------------------------------------------------
+//
+// File:        WiFiUdp.h
+//
+// Description:
+//
+//    UDP for the native build.  The host already keeps its own time, so
+//    packets go nowhere and nothing ever arrives.
+//
+//---------------------------------------------------------------------------
+
+#pragma once
+
+#include "ESP8266WiFi.h"
+
+class WiFiUDP : public Print
+{
+  public:
+
+    uint8_t begin(uint16_t)
+    {
+        return 1;
+    }
+
+    void stop()
+    {
+    }
+
+    int beginPacket(IPAddress, uint16_t)
+    {
+        return 1;
+    }
+
+    int endPacket()
+    {
+        return 1;
+    }
+
+    virtual size_t write(uint8_t)
+    {
+        return 1;
+    }
+
+    virtual size_t write(const uint8_t *, size_t size)
+    {
+        return size;
+    }
+
+    using Print::write;
+
+    int parsePacket()
+    {
+        return 0;
+    }
+
+    int read(char *, size_t)
+    {
+        return 0;
+    }
+
+    int read(uint8_t *, size_t)
+    {
+        return 0;
+    }
+};
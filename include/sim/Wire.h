@@ -0,0 +1,13 @@
+//+--------------------------------------------------------------------------
+//
+// File:        Wire.h
+//
+// Description:
+//
+//    Nothing in the native build talks to a Wire bus, the header only has to exist
+//
+//---------------------------------------------------------------------------
+
+#pragma once
+
+#include "Arduino.h"
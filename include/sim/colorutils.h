@@ -0,0 +1,13 @@
+//+--------------------------------------------------------------------------
+//
+// File:        colorutils.h
+//
+// Description:
+//
+//    FastLED's colorutils.h for the native build, everything is in FastLED.h
+//
+//---------------------------------------------------------------------------
+
+#pragma once
+
+#include "FastLED.h"
@@ -0,0 +1,162 @@
+//+--------------------------------------------------------------------------
+//
+// File:        effectvariants.h
+//
+// Description:
+//
+//    Every way the factory can build each effect in the registry, and a
+//    way to draw one of them that comes out the same on every run.  Shared
+//    by the benchmark and the golden frame check of the native build.
+//
+//    Variants are the defaults, every value of a Name parameter that has a
+//    fixed set of them (palette, starType, starEffect, buildIn) and the
+//    other value of each Bool parameter, one change at a time.  A Name
+//    parameter with no default is set to its first value, except buildIn,
+//    which picks a whole preset and so is only ever set on its own.
+//
+//---------------------------------------------------------------------------
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "globals.h"
+#include "effectsFactory.h"
+
+// VariantParams
+//
+// Parameter values for one variant, at most one change from the defaults plus the names the effect cannot
+// do without
+
+class VariantParams : public IEffectParams
+{
+  private:
+
+    struct Value
+    {
+        uint32_t paramHash;
+        float    number;
+        uint32_t nameHash;
+    };
+
+    std::vector<Value> _values;
+
+    const Value *Find(uint32_t paramHash) const
+    {
+        for (const Value &value : _values)
+            if (value.paramHash == paramHash)
+                return &value;
+        return nullptr;
+    }
+
+  public:
+
+    void SetNumber(const EffectParam &param, float number)
+    {
+        _values.push_back({ param.hash, number, 0 });
+    }
+
+    void SetName(const EffectParam &param, const char *pszName)
+    {
+        _values.push_back({ param.hash, 0.0f, NameHash(pszName) });
+    }
+
+    virtual bool GetNumber(const EffectParam &param, float *pValue) const
+    {
+        const Value *value = Find(param.hash);
+        if (!value || param.type == ParamType::Name)
+            return false;
+        *pValue = value->number;
+        return true;
+    }
+
+    virtual bool GetName(const EffectParam &param, uint32_t *pHash) const
+    {
+        const Value *value = Find(param.hash);
+        if (!value || param.type != ParamType::Name)
+            return false;
+        *pHash = value->nameHash;
+        return true;
+    }
+};
+
+struct EffectVariant
+{
+    std::string   label;                        // The change from the defaults, ie: "turbo=true", empty for the defaults
+    VariantParams params;
+};
+
+// DefaultName
+//
+// What a Name parameter is when the variant leaves it alone: its default, or its first value if it has no
+// default.  NULL for buildIn and for names that may be left out.
+
+const char *DefaultName(const EffectEntry &entry, const EffectParam &param);
+
+// BuildVariants - The defaults first, then one change at a time
+std::vector<EffectVariant> BuildVariants(const EffectEntry &entry);
+
+// VariantRun
+//
+// One variant built in an arena and drawn a frame at a time on the virtual clock.  Create seeds every random
+// number source, puts the clock back to the same time and starts from an empty strip, so a variant draws the
+// same frames whenever it is run and whatever ran before it.  The simulator's clock must be SimClock::Virtual.
+
+class VariantRun
+{
+  private:
+
+    EffectArena                  &_arena;
+    std::shared_ptr<LEDMatrixGFX> _gfx;
+    LEDStripEffect               *_pEffect;
+    uint32_t                      _frameMicros;
+    String                        _strError;
+
+  public:
+
+    VariantRun(EffectArena &arena, std::shared_ptr<LEDMatrixGFX> gfx)
+      : _arena(arena), _gfx(gfx), _pEffect(NULL), _frameMicros(0)
+    {
+    }
+
+    ~VariantRun()
+    {
+        Destroy();
+    }
+
+    VariantRun(const VariantRun &) = delete;
+    VariantRun &operator=(const VariantRun &) = delete;
+
+    // Create - Builds and initialises the effect, false with Error() saying why if the factory would not
+    bool Create(const EffectEntry &entry, const IEffectParams &params, uint32_t seed);
+
+    bool Create(const EffectEntry &entry, const EffectVariant &variant, uint32_t seed)
+    {
+        return Create(entry, variant.params, seed);
+    }
+
+    // NextFrame
+    //
+    // Moves the clock on by one frame at the rate the effect prefers, as a channel would, and starts the
+    // frame.  The caller then draws it with Effect()->DrawFrame().
+
+    void NextFrame();
+
+    void Destroy();
+
+    LEDStripEffect *Effect() const
+    {
+        return _pEffect;
+    }
+
+    const CRGB *GetLEDBuffer() const
+    {
+        return _gfx->GetLEDBuffer();
+    }
+
+    const String &Error() const
+    {
+        return _strError;
+    }
+};
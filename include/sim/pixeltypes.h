@@ -0,0 +1,13 @@
+//+--------------------------------------------------------------------------
+//
+// File:        pixeltypes.h
+//
+// Description:
+//
+//    FastLED's pixeltypes.h for the native build, everything is in FastLED.h
+//
+//---------------------------------------------------------------------------
+
+#pragma once
+
+#include "FastLED.h"
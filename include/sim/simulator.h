@@ -0,0 +1,76 @@
+//+--------------------------------------------------------------------------
+//
+// File:        simulator.h
+//
+// Description:
+//
+//    Controls for the native build's shims, set by the simulator's main
+//    before it runs the station's setup() and loop().  Nothing here exists
+//    in the device build.
+//
+//---------------------------------------------------------------------------
+
+#pragma once
+
+#include <functional>
+
+#include "Arduino.h"
+#include "FastLED.h"
+
+// SimClock
+//
+// RealTime follows the host's monotonic clock and delay() really sleeps.  Virtual time only moves when the
+// station waits: delay() and delayMicroseconds() advance it by what was asked, yield() by SIM_YIELD_MICROS, as
+// if the network stack had run that long.  A virtual run is as fast as the host allows and, given the same
+// seed, replays exactly.
+
+#define SIM_YIELD_MICROS 100
+
+enum class SimClock
+{
+    RealTime,
+    Virtual
+};
+
+void SimSetClock(SimClock clock);
+void SimAdvanceMicros(uint32_t us);
+
+// SimSetVirtualMicros - Puts the virtual clock at the given time, even backwards, for runs that must start alike
+void SimSetVirtualMicros(uint64_t us);
+
+// SimHostNanos - The host's monotonic clock whatever the station's clock is doing, for timing the code itself
+uint64_t SimHostNanos();
+
+// SimIdleNanos - Host time spent so far waiting in delay(), delayMicroseconds() and yield()
+uint64_t SimIdleNanos();
+
+// SimSetSeed - Seeds random(), random8/16 and RANDOM_REG32, which otherwise start from the time
+void SimSetSeed(uint32_t seed);
+
+// SimSetQuiet - Drops everything written to Serial
+void SimSetQuiet(bool bQuiet);
+
+// SimSetFileSystemRoot - Host directory that LittleFS lives in
+void SimSetFileSystemRoot(const char *pszDirectory);
+
+// SimSetBroker
+//
+// A stand-in broker for PubSubClient to connect to over TCP, in place of the server from /config.txt.  Without
+// one, or with an empty host, the station talks to an in-process broker instead, see PubSubClient.h.
+
+void SimSetBroker(const char *pszHost, uint16_t port);
+
+// SimQueueMessage - A message for the station, delivered once it has subscribed and been connected for atMs
+void SimQueueMessage(uint32_t atMs, const char *pszTopic, const char *pszPayload);
+
+// SimFrameSink
+//
+// Called from CLEDController::showLeds with the controller's index, in the order the controllers were added,
+// and the frame as sent, brightness already applied.
+
+typedef std::function<void(int controller, const CRGB *leds, int count)> SimFrameSink;
+
+void SimSetFrameSink(SimFrameSink sink);
+
+// SimSetRestartHandler - What ESP.restart() does, by default the process exits with status 3
+void SimSetRestartHandler(std::function<void()> handler);
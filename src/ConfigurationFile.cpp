@@ -1,59 +1,43 @@
 #include "ConfigurationFile.h"
+#include <limits.h>
 #include <LITTLEFS.h>
 #include "globals.h"
 
-CConfigurationFile::~CConfigurationFile()
-{
-    if (m_ssid)
-        delete[] m_ssid;
-
-    if (m_psk)
-        delete[] m_psk;
-
-    if (m_mqttServerIP)
-        delete[] m_mqttServerIP;
-
-    if (m_map)
-        delete[] m_map;
-}
-
 /*
 *
 *
 */
-bool CConfigurationFile::SetConfiguration(String config)
+bool CConfigurationFile::SetConfiguration(const char *config)
 {
-    File confFile = LittleFS.open(CONFIG_FILE_NAME, "r");
-    if (confFile)
-    {
-        String config = confFile.readString();
-        confFile.close();
+    // Worked out in a scratch copy, so that a value such as psk= does not wipe the setting unless the
+    // result is good and has been written
 
-        ExtractConfigFileData(config);
-    }
+    CConfigurationFile scratch;
+    scratch.ReadFile();
+    scratch.m_truncated = false;
 
-    ExtractConfigFileData(config);
+    ParseState parse;
+    scratch.ExtractConfigFileData(parse, config, strlen(config));
+    scratch.EndPair(parse);
 
-    if (!(m_ssid && strlen(m_ssid) > 0) ||
-        !(m_psk && strlen(m_psk) > 0) ||
-        !(m_mqttServerIP && strlen(m_mqttServerIP) > 0) ||
-        !(m_mqttServerPort > 0))
-    {
+    if (scratch.m_truncated)
         return false;
-    }
 
-    confFile = LittleFS.open(CONFIG_FILE_NAME, "w+");
-    if (!confFile)
+    if (strlen(scratch.m_ssid) == 0 ||
+        strlen(scratch.m_psk) == 0 ||
+        strlen(scratch.m_mqttServerIP) == 0 ||
+        !(scratch.m_mqttServerPort > 0))
     {
-        Println("Fail to create or open file");
         return false;
     }
 
-    String configStr = GetConfigFileData();
-
-    confFile.print(configStr);
-    confFile.close();
+    if (!scratch.WriteFile())
+        return false;
 
+    memcpy(m_ssid, scratch.m_ssid, sizeof(m_ssid));
+    memcpy(m_psk, scratch.m_psk, sizeof(m_psk));
+    memcpy(m_mqttServerIP, scratch.m_mqttServerIP, sizeof(m_mqttServerIP));
+    m_mqttServerPort = scratch.m_mqttServerPort;
     return true;
 }
 
@@ -63,173 +47,214 @@ bool CConfigurationFile::SetConfiguration(String config)
 *
 *
 */
-void CConfigurationFile::ParseConfiguration()
+bool CConfigurationFile::ParseConfiguration()
 {
-    File f = LittleFS.open(CONFIG_FILE_NAME, "r");
-    if (!f)
+    if (!ReadFile())
     {
         Println("Failed to open file /config.txt");
-        return;
+        return false;
     }
 
-    String config = f.readString();
-    f.close();
+    Print("Config: SSID ");
+    Print(m_ssid);
+    Print(", MQTT ");
+    Print(m_mqttServerIP);
+    Print(":");
+    Println(m_mqttServerPort);
+    return true;
+}
 
-    Println("Parsing config...");
-    ExtractConfigFileData(config);
 
-    Print("SSID: ");
-    Println(m_ssid);
 
-    Print("PSK: ");
-    Println(m_psk);
+// ReadFile
+//
+// Parses the file a chunk at a time, false if there is no file
 
-    Print("MQTT: ");
-    Println(m_mqttServerIP);
+bool CConfigurationFile::ReadFile()
+{
+    File f = LittleFS.open(CONFIG_FILE_NAME, "r");
+    if (!f)
+        return false;
 
-    Print("MQTT Port: ");
-    Println(m_mqttServerPort);
+    ParseState parse;
+    uint8_t buffer[CONFIG_READ_CHUNK];
+    size_t cb;
+    while ((cb = f.read(buffer, sizeof(buffer))) > 0)
+        ExtractConfigFileData(parse, (const char *)buffer, cb);
+    EndPair(parse);
+
+    f.close();
+    return true;
 }
 
 
-// [orig buffer] <- Pointer1 <- Pointer2
-void CConfigurationFile::StringToCharPtr(String str, char ** ch)
-{
-    if (*ch)
-        delete[] * ch;
 
-    unsigned int chLen = str.length() + 1;
-    *ch = new char[chLen];
-    memset(*ch, 0, chLen);
-    str.toCharArray(*ch, chLen);
-}
+void CConfigurationFile::ExtractConfigFileData(ParseState& parse, const char* data, size_t length)
+{
+    for (const char* end = data + length; data < end; data++)
+    {
+        const char ch = *data;
 
+        if (CONFIG_FILE_SEPAREATOR == ch || '\r' == ch || '\n' == ch)
+        {
+            EndPair(parse);
+            continue;
+        }
 
+        switch (parse.m_state)
+        {
+        case StateParser::READING_KEY:
+
+            if (CONFIG_FILE_EQUALS == ch)
+                BeginValue(parse);
+            else if (parse.m_cchKey < sizeof(parse.m_key) - 1)
+                parse.m_key[parse.m_cchKey++] = ch;
+            else
+                parse.m_cchKey = sizeof(parse.m_key);
+            break;
 
-bool CConfigurationFile::ExtractConfigFileData(String str)
-{
-    unsigned int currPoss = 0;
-    unsigned int configLen = str.length();
+        case StateParser::READING_VALUE:
 
-    String tmpParam;
-    String tmpKey;
+            AppendValue(parse, ch);
+            break;
 
-    if (currPoss == configLen)
-        return false;
+        case StateParser::SKIPPING_VALUE:
 
-    StateParser currState = StateParser::WAIT_EQUALS;
-    while (true)
-    {
-        if (currPoss >= configLen)
             break;
+        }
+    }
+}
 
-        char ch = str.charAt(currPoss++);
 
-        if (CONFIG_FILE_EQUALS == ch)
-            currState = StateParser::GOT_EQUALS;
 
-        if (CONFIG_FILE_SEPAREATOR == ch)
-            currState = StateParser::GOT_SEPARATOR;
+// BeginValue
+//
+// The key is complete, finds its field and empties it for the value
 
-        if (currPoss >= configLen)
-            currState = StateParser::END_OF_FILE;
+void CConfigurationFile::BeginValue(ParseState& parse)
+{
+    parse.m_state = StateParser::SKIPPING_VALUE;
+    parse.m_param = NULL;
 
-        switch (currState)
-        {
-        case StateParser::WAIT_EQUALS:
+    if (parse.m_cchKey >= sizeof(parse.m_key))
+        return;
+    parse.m_key[parse.m_cchKey] = '\0';
 
-            tmpKey += ch;
-            break;
+    for (int i = 0; i < m_mapSize; ++i)
+    {
+        if (strcmp(m_map[i].m_key, parse.m_key) != 0)
+            continue;
 
-        case StateParser::GOT_EQUALS:
+        parse.m_param = &m_map[i];
+        parse.m_state = StateParser::READING_VALUE;
+        parse.m_cchValue = 0;
+        parse.m_truncated = false;
+        parse.m_number = 0;
+        parse.m_negative = false;
+        parse.m_numberDone = false;
 
-            currState = StateParser::WAIT_SEPARATOR;
-            break;
+        if (m_map[i].m_type == ParamType::CHAR_ARRAY)
+            m_map[i].m_charArr[0] = '\0';
+        return;
+    }
+}
 
-        case StateParser::WAIT_SEPARATOR:
 
-            tmpParam += ch;
-            break;
 
-        case StateParser::END_OF_FILE:
+void CConfigurationFile::AppendValue(ParseState& parse, char ch)
+{
+    ParamMap& param = *parse.m_param;
 
-            // Fall through to parse the last param.
-            // Append char if it is not an EQUAL sign.
-            if (CONFIG_FILE_EQUALS != ch)
-                tmpParam += ch;
+    switch (param.m_type)
+    {
+    case ParamType::CHAR_ARRAY:
 
-        case StateParser::GOT_SEPARATOR:
+        if (parse.m_cchValue < param.m_cbCharArr - 1)
+        {
+            param.m_charArr[parse.m_cchValue++] = ch;
+            param.m_charArr[parse.m_cchValue] = '\0';
+        }
+        else
+        {
+            parse.m_truncated = true;
+        }
+        break;
 
-            if (tmpParam.length() == 0)
-                return false;
+    case ParamType::INT:
 
-            SetConfigParam(tmpParam, tmpKey);
-            tmpParam = "";
-            tmpKey = "";
-            currState = StateParser::WAIT_EQUALS;
+        if (parse.m_numberDone)
             break;
-        }
-    }
 
-    return true;
+        if (ch >= '0' && ch <= '9' && parse.m_number <= (INT_MAX - 9) / 10)
+            parse.m_number = parse.m_number * 10 + (ch - '0');
+        else if (ch == '-' && parse.m_cchValue == 0)
+            parse.m_negative = true;
+        else
+            parse.m_numberDone = true;
+
+        parse.m_cchValue++;
+        break;
+    }
 }
 
 
 
-void CConfigurationFile::SetConfigParam(String configParam, String key)
-{
-    Print("Config param: ");
-    Print(key);
-    Print(" Value: ");
-    Println(configParam);
+// EndPair - Stores a number once all of it is in, notes a value cut short and starts on the next key
 
-    for (int i = 0; i < m_mapSize; ++i)
+void CConfigurationFile::EndPair(ParseState& parse)
+{
+    if (parse.m_state == StateParser::READING_VALUE)
     {
-        if (m_map[i].m_key != key)
-            continue;
+        ParamMap& param = *parse.m_param;
 
-        switch (m_map[i].m_type)
+        if (param.m_type == ParamType::INT)
+            *param.m_int = parse.m_negative ? -parse.m_number : parse.m_number;
+
+        if (parse.m_truncated)
         {
-        case ParamType::CHAR_ARRAY:
-            StringToCharPtr(configParam, m_map[i].m_charArr);
-            Print("Char member: ");
-            Println(*m_map[i].m_charArr);
-            break;
-        case ParamType::INT:
-            *(m_map[i].m_int) = configParam.toInt();
-            Print("Int member: ");
-            Println(*m_map[i].m_int);
-            break;
+            m_truncated = true;
+            Print("Config value too long: ");
+            Println(param.m_key);
         }
     }
+
+    parse.m_state = StateParser::READING_KEY;
+    parse.m_cchKey = 0;
+    parse.m_param = NULL;
 }
 
 
 
-String CConfigurationFile::GetConfigFileData()
+bool CConfigurationFile::WriteFile()
 {
-    String result;
+    File confFile = LittleFS.open(CONFIG_FILE_NAME, "w+");
+    if (!confFile)
+    {
+        Println("Fail to create or open file");
+        return false;
+    }
 
     for (int i = 0; i < m_mapSize; ++i)
     {
-        result += m_map[i].m_key;
-        result += CONFIG_FILE_EQUALS;
+        if (i > 0)
+            confFile.print(CONFIG_FILE_SEPAREATOR);
+
+        confFile.print(m_map[i].m_key);
+        confFile.print(CONFIG_FILE_EQUALS);
 
         switch (m_map[i].m_type)
         {
         case ParamType::CHAR_ARRAY:
 
-            result += *(m_map[i].m_charArr);
+            confFile.print(m_map[i].m_charArr);
             break;
         case ParamType::INT:
 
-            result += *(m_map[i].m_int);
+            confFile.print(*m_map[i].m_int);
             break;
         }
-
-        if (i < m_mapSize - 1)
-            result += CONFIG_FILE_SEPAREATOR;
     }
 
-    return result;
+    confFile.close();
+    return true;
 }
@@ -1,10 +1,12 @@
 #include "WorkingStation.h"
-#include "ConfigurationFile.h"
+#include "binaryCommand.h"
 #include "globals.h"
+#include "fastrandom.h"
 
 struct CRGB;
 
 AppTime g_AppTime;             // Keeps track of frame times
+FastRandom g_EffectSeeds;      // Seeds for each effect's own random numbers
 
 /*
  *	\brief Initialize the component
@@ -12,6 +14,8 @@ AppTime g_AppTime;             // Keeps track of frame times
  */
 bool CWorkingStation::Init()
 {
+    g_EffectSeeds.Seed(RANDOM_REG32);
+
     for (int i = 0; i < NUM_CHANNELS; i++)
     {
         EffectsManager* pEffectsManager = new EffectsManager(i);
@@ -20,38 +24,12 @@ bool CWorkingStation::Init()
         m_vecEffects.push_back(pEffectsManager);
     }
 
-    m_vecEffects.at(SYS_LED_CHANNEL)->onWiFiStatusChanged(false);
-    m_vecEffects.at(SYS_LED_CHANNEL)->loop();
-
-    CConfigurationFile configFile;
-    configFile.ParseConfiguration();
-
-    int ssidLen = strlen(configFile.m_ssid) + 1;
-    int pskLen = strlen(configFile.m_psk) + 1;
-
-    if (m_ssid)
-        delete[] m_ssid;
-
-    m_ssid = new char[ssidLen];
-
-    if (m_psk)
-        delete[] m_psk;
-
-    m_psk = new char[pskLen];
-
-    memcpy(m_ssid, configFile.m_ssid, ssidLen);
-    memcpy(m_psk, configFile.m_psk, pskLen);
-
-    ConnectToWifi();
-
-    m_vecEffects.at(SYS_LED_CHANNEL)->onWiFiStatusChanged(true);
-    m_vecEffects.at(SYS_LED_CHANNEL)->onMqttStatusChanged(false);
-    m_vecEffects.at(SYS_LED_CHANNEL)->loop();
+    m_config.ParseConfiguration();
 
     IPAddress mqttServerIPAddr;
-    mqttServerIPAddr.fromString(configFile.m_mqttServerIP);
+    mqttServerIPAddr.fromString(m_config.m_mqttServerIP);
 
-    m_client.setServer(mqttServerIPAddr, configFile.m_mqttServerPort);
+    m_client.setServer(mqttServerIPAddr, m_config.m_mqttServerPort);
 
     MQTT_CALLBACK_SIGNATURE = std::bind(
         &CWorkingStation::MQTT_Callback,
@@ -62,11 +40,12 @@ bool CWorkingStation::Init()
 
     m_client.setCallback(callback);
 
-    // Connect to MQTT Broker.
-    ReconnectMQTT();
+    // A broker that is down or unreachable must not stall the frame loop for long, see PollConnection
+    m_espClient.setTimeout(MQTT_CONNECT_TIMEOUT_MS);
+    m_client.setSocketTimeout(MQTT_SOCKET_TIMEOUT_SEC);
 
-    m_vecEffects.at(SYS_LED_CHANNEL)->onMqttStatusChanged(true);
-    m_vecEffects.at(SYS_LED_CHANNEL)->loop();
+    // Start joining WiFi, Work carries on from there while the effects run
+    ConnectToWifi();
 
     return true;
 }
@@ -80,42 +59,41 @@ void CWorkingStation::Work()
 {
     g_AppTime.NewFrame();
 
-    // Check WiFi state
-    // and if down - try to reconnect
-    if (WL_CONNECTED != WiFi.status())
-    {
-        m_vecEffects.at(0)->onWiFiStatusChanged(false);
-        m_vecEffects.at(0)->loop(); // Loop the effects to redraw the error since we will be blocking untill reconnection
+    // Draw each channel whose next frame is due.  While the station is offline the system channel draws
+    // even when it is switched off, as it is what shows the connection status.
 
-        Print("WIFI DOWN! Reconnecting");
-        WIFI_WAIT_FOR_CONNECTION
+    const bool bOffline = m_connState != ConnectionState::Connected;
+    const uint32_t now = g_AppTime.FrameStartTicks();
+    for (int i = 0; i < NUM_CHANNELS; i++)
+    {
+        auto effectsManager = m_vecEffects.at(i);
+        if (!effectsManager->getEnabled() && !(bOffline && i == SYS_LED_CHANNEL))
+            continue;
 
-        m_vecEffects.at(0)->onWiFiStatusChanged(true);
+        if (effectsManager->isFrameDue(now))
+            effectsManager->loop();
     }
-    else if (!m_client.connected())
-    {
-        m_vecEffects.at(0)->onMqttStatusChanged(false);
-        m_vecEffects.at(0)->loop(); // Loop the effects to redraw the error since we will be blocking untill reconnection
 
-        Println("MQTT Client is disconnected. Will try to reconnect in a moment.");
-        this->ReconnectMQTT();
+    // Straight after the frames have gone out, so that a connection attempt, which can block for up to
+    // MQTT_CONNECT_TIMEOUT_MS, eats into the time until the next frames rather than holding up due ones
 
-        m_vecEffects.at(0)->onMqttStatusChanged(true);
-    }
-    else
-    {
-        m_client.loop();
+    PollConnection();
 
-        for (int i = 0; i < NUM_CHANNELS; i++)
-        {
-            auto effectsManager = m_vecEffects.at(i);
-            if (effectsManager->getEnabled())
-                effectsManager->loop();
-        }
+    // Hand the time until the soonest next frame to the network stack.  delay() is what lets the ESP8266's
+    // WiFi and TCP tasks run, yield() when it is short.
+
+    uint32_t idleTicks = MICROS_PER_SECOND / DEFAULT_TARGET_FPS;
+    for (int i = 0; i < NUM_CHANNELS; i++)
+    {
+        auto effectsManager = m_vecEffects.at(i);
+        if (effectsManager->getEnabled() || (m_connState != ConnectionState::Connected && i == SYS_LED_CHANNEL))
+            idleTicks = std::min(idleTicks, effectsManager->ticksUntilFrame(micros()));
     }
 
-    //
-    // delay(10);
+    if (idleTicks >= 1000)
+        delay(idleTicks / 1000);
+    else
+        yield();
 }
 
 /*
@@ -134,70 +112,151 @@ void CWorkingStation::Work()
     5 : MQTT_CONNECT_UNAUTHORIZED - the client was not authorized to connect
 */
 
-/*
- *	\brief This will loop in main
- */
-bool CWorkingStation::ReconnectMQTT()
+// PollConnection
+//
+// One step of getting, and staying, connected to WiFi and then the broker, called on every pass of Work.  Nothing
+// here waits: the ESP8266 rejoins WiFi on its own, and a broker connection that fails is tried again later, backing
+// off from RECONNECT_BACKOFF_MIN_MS up to RECONNECT_BACKOFF_MAX_MS, so a broker restart costs a few seconds of MQTT
+// rather than every frame until it is back.  Offline for WAIT_BEFORE_RESTART_SEC in a row, the station restarts.
+
+void CWorkingStation::PollConnection()
 {
-    unsigned long ulRestartTime = ELAPSED_SECONDS + WAIT_BEFORE_RESTART_SEC;
-    while (!m_client.connected())
+    const unsigned long now = millis();
+
+    if (m_connState != ConnectionState::Connected && now - m_offlineSinceMs > WAIT_BEFORE_RESTART_SEC * 1000UL)
     {
-        if (ulRestartTime < ELAPSED_SECONDS)
-        {
-            Println("Failed to reconnect to MQTT Brocker for 5 mins. Calling ESP.restart()");
-            SERIAL_END;
-            ESP.restart();
-        }
+        Println(m_connState == ConnectionState::WiFiConnecting ? "Failed to reconnect to WIFI for 5 mins. Calling ESP.restart()"
+                                                               : "Failed to reconnect to MQTT Broker for 5 mins. Calling ESP.restart()");
+        SERIAL_END;
+        ESP.restart();
+    }
 
-        if (m_client.connect(stationID))
-        {
-            Println("MQTT Client connected!");
-            PublishCurrPlayEffect();
-        }
-        else
-        {
-            Print("failed, rc=");
-            Print(m_client.state());
-            Println(" try again in 2 seconds");
-            // Wait 2 seconds before retrying
-            delay(2000);
-        }
+    switch (m_connState)
+    {
+        case ConnectionState::WiFiConnecting:
+            if (WiFi.status() == WL_CONNECTED)
+            {
+                Print("Connected, IP address: ");
+                Println(WiFi.localIP());
+
+                m_vecEffects.at(SYS_LED_CHANNEL)->onWiFiStatusChanged(true);
+                m_vecEffects.at(SYS_LED_CHANNEL)->onMqttStatusChanged(false);
+                m_connState = ConnectionState::MqttConnecting;
+                m_backoffMs = RECONNECT_BACKOFF_MIN_MS;
+                m_nextAttemptMs = now;
+            }
+            break;
+
+        case ConnectionState::MqttConnecting:
+            if (WiFi.status() != WL_CONNECTED)
+            {
+                GoOffline(ConnectionState::WiFiConnecting);
+            }
+            else if ((long)(now - m_nextAttemptMs) >= 0)
+            {
+                if (TryConnectMQTT())
+                {
+                    m_connState = ConnectionState::Connected;
+                    m_vecEffects.at(SYS_LED_CHANNEL)->onMqttStatusChanged(true);
+
+                    // Switched off, the system channel only drew to show the status, which is cleared off the strip
+                    if (!m_vecEffects.at(SYS_LED_CHANNEL)->getEnabled())
+                        m_vecEffects.at(SYS_LED_CHANNEL)->setEnabled(false);
+                    PublishCurrPlayEffect();
+                }
+                else
+                {
+                    m_nextAttemptMs = millis() + m_backoffMs;
+                    m_backoffMs = std::min<unsigned long>(m_backoffMs * 2, RECONNECT_BACKOFF_MAX_MS);
+                }
+            }
+            break;
+
+        case ConnectionState::Connected:
+            if (WiFi.status() != WL_CONNECTED)
+            {
+                Println("WIFI DOWN! Reconnecting");
+                GoOffline(ConnectionState::WiFiConnecting);
+            }
+            else if (!m_client.connected())
+            {
+                Println("MQTT Client is disconnected. Will try to reconnect in a moment.");
+                GoOffline(ConnectionState::MqttConnecting);
+            }
+            else
+            {
+                m_client.loop();
+                if (now - m_lastPowerReportMs >= POWER_REPORT_INTERVAL_MS)
+                    PublishPower();
+            }
+            break;
     }
+}
+
+// GoOffline
+//
+// The connection dropped back to the given state.  The restart deadline runs from when it was first lost.
+
+void CWorkingStation::GoOffline(ConnectionState state)
+{
+    if (m_connState == ConnectionState::Connected)
+        m_offlineSinceMs = millis();
 
-    ulRestartTime = ELAPSED_SECONDS + WAIT_BEFORE_RESTART_SEC;
-    while (!m_client.subscribe(subscribeTopic, MQTTQOS0))
+    m_connState = state;
+    m_backoffMs = RECONNECT_BACKOFF_MIN_MS;
+    m_nextAttemptMs = millis();
+
+    if (state == ConnectionState::WiFiConnecting)
+        m_vecEffects.at(SYS_LED_CHANNEL)->onWiFiStatusChanged(false);
+    else
+        m_vecEffects.at(SYS_LED_CHANNEL)->onMqttStatusChanged(false);
+}
+
+// TryConnectMQTT
+//
+// One attempt to connect to the broker and subscribe, bounded by MQTT_CONNECT_TIMEOUT_MS and MQTT_SOCKET_TIMEOUT_SEC
+
+bool CWorkingStation::TryConnectMQTT()
+{
+    if (!m_client.connect(stationID))
     {
-        if (ulRestartTime < ELAPSED_SECONDS)
-        {
-            Println("Failed to subscribe to MQTT Topic for 5 mins. Calling ESP.restart()");
-            SERIAL_END;
-            ESP.restart();
-        }
+        Print("failed, rc=");
+        Print(m_client.state());
+        Print(" try again in ");
+        Print(m_backoffMs);
+        Println(" ms");
+        return false;
+    }
 
+    if (!m_client.subscribe(subscribeTopic, MQTTQOS0))
+    {
         Println("Subscribe failed. Trying again...");
-        delay(500);
-    };
+        m_client.disconnect();
+        return false;
+    }
 
     Println("MQTT ALL OK");
     return true;
 }
 
+// ConnectToWifi
+//
+// Starts joining the network, PollConnection notices when it is up
+
 void CWorkingStation::ConnectToWifi()
 {
     WiFi.mode(WIFI_STA);
     delay(20);
 
-    WiFi.begin(m_ssid, m_psk);
-
-    Print("Connecting");
-    WIFI_WAIT_FOR_CONNECTION
-
-    Println("");
-    Print("Connected, IP address: ");
-    Println(WiFi.localIP());
+    WiFi.begin(m_config.m_ssid, m_config.m_psk);
 
     // The ESP8266 tries to reconnect automatically when the connection is lost
     WiFi.setAutoReconnect(true);
+
+    Println("Connecting");
+    m_connState = ConnectionState::WiFiConnecting;
+    m_offlineSinceMs = millis();
+    m_vecEffects.at(SYS_LED_CHANNEL)->onWiFiStatusChanged(false);
 }
 
 void CWorkingStation::PublishCurrPlayEffect()
@@ -208,6 +267,8 @@ void CWorkingStation::PublishCurrPlayEffect()
     String strEffects = "";
     String strBrightness = "";
     String strPower = "";
+    String strArena = "";
+    String strFrames = "";
     for (int i = 0; i < NUM_CHANNELS; i++)
     {
         String strChannelNum = String("(") + String(i) + String(") ");
@@ -216,11 +277,17 @@ void CWorkingStation::PublishCurrPlayEffect()
         strEffects += strChannelNum + pEffectsManager->getCurrEffectName() + "\n";
         strBrightness += strChannelNum + String(pEffectsManager->getBrightnes()) + "\n";
         strPower += strChannelNum + String(pEffectsManager->getEnabled()) + "\n";
+        strArena += strChannelNum + String(pEffectsManager->getArenaHighWater()) + "/" + String(pEffectsManager->getArenaSize()) +
+                    " failures " + String(pEffectsManager->getArenaFailures()) + "\n";
+        strFrames += strChannelNum + String(pEffectsManager->getSkippedFrames()) + " unchanged frames not sent, keep-alive " +
+                     String(pEffectsManager->getKeepAliveInterval()) + " ms\n";
     }
 
     bool pubStateResult = m_client.publish(reportCurrEffectTopic, strEffects.c_str(), false);
     pubStateResult &= m_client.publish(reportCurrBrightnessTopic, strBrightness.c_str(), false);
     pubStateResult &= m_client.publish(reportCurrPowerStatus, strPower.c_str(), false);
+    pubStateResult &= m_client.publish(reportArenaTopic, strArena.c_str(), false);
+    pubStateResult &= m_client.publish(reportFramesTopic, strFrames.c_str(), false);
 
     if (!pubStateResult)
     {
@@ -229,6 +296,50 @@ void CWorkingStation::PublishCurrPlayEffect()
     }
 }
 
+// PublishPower
+//
+// What each channel's strip is estimated to draw, and how far the power limit is dimming it if it is
+
+void CWorkingStation::PublishPower()
+{
+    m_lastPowerReportMs = millis();
+
+    String strPower = "";
+    for (int i = 0; i < NUM_CHANNELS; i++)
+    {
+        EffectsManager* pEffectsManager = m_vecEffects.at(i);
+        strPower += String("(") + String(i) + String(") ") + String(pEffectsManager->getMilliwatts()) + " mW";
+        if (pEffectsManager->getPowerScale() < 255)
+            strPower += ", limited to " + String(pEffectsManager->getPowerScale() * 100 / 255) + "%";
+        strPower += "\n";
+    }
+
+    m_client.publish(reportMilliwattsTopic, strPower.c_str(), false);
+}
+
+// PublishCatalog
+//
+// Every effect with its parameters and defaults, and the palettes and star types, see EffectsFactory::GetCatalog.
+// It is longer than PubSubClient's buffer, so it is streamed out rather than published in one go.
+
+void CWorkingStation::PublishCatalog()
+{
+    if (!m_client.connected())
+        return;
+
+    EffectsFactory factory;
+    String strCatalog = factory.GetCatalog();
+
+    bool pubStateResult = m_client.beginPublish(reportCatalogTopic, strCatalog.length(), false);
+    pubStateResult = pubStateResult && m_client.write((const uint8_t *)strCatalog.c_str(), strCatalog.length()) == strCatalog.length();
+    pubStateResult = pubStateResult && m_client.endPublish();
+
+    if (!pubStateResult)
+    {
+        Println("Could not publish the catalog.");
+    }
+}
+
 void CWorkingStation::ReportError(String err)
 {
     if (!m_client.connected())
@@ -240,6 +351,25 @@ void CWorkingStation::ReportError(String err)
     Println(pubStateResult);
 }
 
+// ParsePayloadNumber
+//
+// The number a numbered /set topic carries, see globals.h.  The payload is not null terminated, so it is copied
+// to the stack first; anything longer than a number can be, or not a number at all, is turned down.
+
+static bool ParsePayloadNumber(const uint8_t *payload, unsigned length, int base, long *pValue)
+{
+    char buffer[16];
+    if (length >= sizeof(buffer))
+        return false;
+
+    memcpy(buffer, payload, length);
+    buffer[length] = '\0';
+
+    char *pEnd;
+    *pValue = strtol(buffer, &pEnd, base);
+    return pEnd != buffer;
+}
+
 void CWorkingStation::MQTT_Callback(char *topic, uint8_t *payload, unsigned int length)
 {
     if (0 == length)
@@ -250,28 +380,55 @@ void CWorkingStation::MQTT_Callback(char *topic, uint8_t *payload, unsigned int
 
     if (0 == strcmp(topic, setEffectTopic))
     {
-        char *buff;
-        NullTerminateArray(payload, length, (void **)&buff);
+        // Parsed once, in place: with a char * input ArduinoJson points its strings into the payload
+        // buffer instead of copying them, and the buffer outlives this callback's use of the document.
 
-        String value(buff);
-        delete[] buff;
+        StaticJsonDocument<JSON_DOC_SIZE> doc;
+        DeserializationError error = deserializeJson(doc, (char *)payload, length);
+        if (error)
+        {
+            String strError = "deserializeJson() failed: " + String(error.f_str());
+            Println(strError);
 
-        Println("Message:");
-        Println(value);
+            for (int i = 0; i < NUM_CHANNELS; i++)
+                m_vecEffects.at(i)->setEffectError(strError);
 
-        // Notify each effects manager. The correct channel is inside the JSON payload.
-        // Channels will check if the payload is for them and if not they will ignore it.
-        for (int i = 0; i < NUM_CHANNELS; i++)
-            m_vecEffects.at(i)->changeEffect(value);
+            PublishCurrPlayEffect();
+            return;
+        }
+
+        // Only the channel the request names builds the effect, -1 (or no channel) means every channel
+
+        JsonObjectConst request = doc.as<JsonObjectConst>();
+        int iChannel = request["channel"] | -1;
+
+        if (!RouteToChannels(m_vecEffects, iChannel, [request](EffectsManager *pChannel) { pChannel->changeEffect(request); }))
+            ReportError(String("Unknown channel: ") + String(iChannel));
 
         PublishCurrPlayEffect();
     }
-    else if (0 == strcmp(topic, setPower))
+    else if (0 == strcmp(topic, setEffectBinTopic))
     {
-        char *buff = new char[length + 1];
-        NullTerminateArray(payload, length, (void **)&buff);
+        BinaryEffectParams command;
+        String strError;
+        if (!command.Parse(payload, length, strError))
+        {
+            Println(strError);
+            ReportError(strError);
+            return;
+        }
 
-        int value = strtol(buff, NULL, 10);
+        int iChannel = command.Channel();
+        if (!RouteToChannels(m_vecEffects, iChannel, [&command](EffectsManager *pChannel) { pChannel->changeEffect(command.EffectId(), command); }))
+            ReportError(String("Unknown channel: ") + String(iChannel));
+
+        PublishCurrPlayEffect();
+    }
+    else if (0 == strcmp(topic, setPower))
+    {
+        long value;
+        if (!ParsePayloadNumber(payload, length, 10, &value))
+            return;
 
         int iChannelNum = value / 10;
         bool bEnabled = value % 10 == 1;
@@ -281,44 +438,85 @@ void CWorkingStation::MQTT_Callback(char *topic, uint8_t *payload, unsigned int
 
         PublishCurrPlayEffect();
     }
-    else if (0 == strcmp(topic, setBrightnessTopic))
+    else if (0 == strcmp(topic, setDitherTopic))
     {
-        char *buff = new char[length + 1];
-        NullTerminateArray(payload, length, (void **)&buff);
+        long value;
+        if (!ParsePayloadNumber(payload, length, 10, &value))
+            return;
 
-        int value = strtol(buff, NULL, 10);
+        int iChannelNum = value / 10;
+        bool bDither = value % 10 == 1;
+
+        ForEachChannel(iChannelNum, [bDither](EffectsManager *pChannel) { pChannel->setDithering(bDither); });
+    }
+    else if (0 == strcmp(topic, setGammaTopic))
+    {
+        long value;
+        if (!ParsePayloadNumber(payload, length, 10, &value))
+            return;
+
+        int iChannelNum = value / 1000;
+        float gamma = (value % 1000) / 100.0f;
+
+        if (gamma > 0.0f)
+            ForEachChannel(iChannelNum, [gamma](EffectsManager *pChannel) { pChannel->setGamma(gamma); });
+    }
+    else if (0 == strcmp(topic, setCorrectionTopic))
+    {
+        long value;
+        if (!ParsePayloadNumber(payload, length, 16, &value))
+            return;
+
+        long iChannelNum = value >> 24;
+        CRGB correction((value >> 16) & 0xFF, (value >> 8) & 0xFF, value & 0xFF);
+
+        ForEachChannel(iChannelNum, [correction](EffectsManager *pChannel) { pChannel->setColorCorrection(correction); });
+    }
+    else if (0 == strcmp(topic, setFpsTopic))
+    {
+        long value;
+        if (!ParsePayloadNumber(payload, length, 10, &value))
+            return;
+
+        int iChannelNum = value / 1000;
+        int iChannelFps = value % 1000;
+
+        if (iChannelFps > 0)
+            ForEachChannel(iChannelNum, [iChannelFps](EffectsManager *pChannel) { pChannel->setTargetFPS(iChannelFps); });
+    }
+    else if (0 == strcmp(topic, setKeepAliveTopic))
+    {
+        long value;
+        if (!ParsePayloadNumber(payload, length, 10, &value))
+            return;
+
+        long iChannelNum = value / 100000;
+        long iChannelMs = value % 100000;
+
+        if (iChannelMs > 0)
+            ForEachChannel(iChannelNum, [iChannelMs](EffectsManager *pChannel) { pChannel->setKeepAliveInterval(iChannelMs); });
+
+        PublishCurrPlayEffect();
+    }
+    else if (0 == strcmp(topic, setCatalogTopic))
+    {
+        PublishCatalog();
+    }
+    else if (0 == strcmp(topic, setBrightnessTopic))
+    {
+        long value;
+        if (!ParsePayloadNumber(payload, length, 10, &value))
+            return;
 
         int iChannelNum = value / 1000;
         int iChannelValue = value % 1000;
 
         if (iChannelValue >= 0 && iChannelValue <= 255)
-        {
-            if (iChannelNum == 0)
-                for (int i = 0; i < NUM_CHANNELS; i++)
-                    m_vecEffects.at(i)->setBrightnes(iChannelValue);
-            else if (iChannelNum > 0 && iChannelNum <= NUM_CHANNELS)
-                m_vecEffects.at(iChannelNum - 1)->setBrightnes(iChannelValue);
-        }
+            ForEachChannel(iChannelNum, [iChannelValue](EffectsManager *pChannel) { pChannel->setBrightnes(iChannelValue); });
 
         Println("Message:");
         Println(value);
 
-        delete[] buff;
         PublishCurrPlayEffect();
     }
 }
-
-void CWorkingStation::NullTerminateArray(void *src, uint8_t len, void **dest)
-{
-    if (((char *)src)[len - 1] != '\0')
-    {
-        *dest = new char[len + 1];
-        memset(*dest, 0, len + 1);
-        memcpy(*dest, src, len);
-    }
-    else
-    {
-        *dest = new char[len];
-        memcpy(*dest, src, len);
-    }
-}
\ No newline at end of file
@@ -31,6 +31,198 @@
 
 #include "globals.h"
 #include "ledmatrixgfx.h"                   // For LED drawing and color code
+#include "colordata.h"
+
+// Palettes
+//
+// Everything here stays in flash in compact form, see FlashPalette for how they are expanded for the effects using them
+
+const TProgmemRGBPalette16 BlueColors_p FL_PROGMEM =
+{
+    CRGB::DarkBlue,
+    CRGB::MediumBlue,
+    CRGB::Blue,
+    CRGB::MediumBlue,
+    CRGB::DarkBlue,
+    CRGB::MediumBlue,
+    CRGB::Blue,
+    CRGB::MediumBlue,
+    CRGB::DarkBlue,
+    CRGB::MediumBlue,
+    CRGB::Blue,
+    CRGB::MediumBlue,
+    CRGB::DarkBlue,
+    CRGB::MediumBlue,
+    CRGB::Blue,
+    CRGB::MediumBlue
+};
+
+const TProgmemRGBPalette16 RedColors_p FL_PROGMEM =
+{
+    CRGB::Red,
+    CRGB::DarkRed,
+    CRGB::DarkRed,
+    CRGB::DarkRed,
+
+    CRGB::Red,
+    CRGB::DarkRed,
+    CRGB::DarkRed,
+    CRGB::DarkRed,
+
+    CRGB::Red,
+    CRGB::DarkRed,
+    CRGB::DarkRed,
+    CRGB::DarkRed,
+
+    CRGB::Red,
+    CRGB::DarkRed,
+    CRGB::DarkRed,
+    CRGB::OrangeRed
+};
+
+const TProgmemRGBPalette16 GreenColors_p FL_PROGMEM =
+{
+    CRGB::Green,
+    CRGB::DarkGreen,
+    CRGB::DarkGreen,
+    CRGB::DarkGreen,
+
+    CRGB::Green,
+    CRGB::DarkGreen,
+    CRGB::DarkGreen,
+    CRGB::DarkGreen,
+
+    CRGB::Green,
+    CRGB::DarkGreen,
+    CRGB::DarkGreen,
+    CRGB::DarkGreen,
+
+    CRGB::Green,
+    CRGB::DarkGreen,
+    CRGB::DarkGreen,
+    CRGB::LimeGreen
+};
+
+const TProgmemRGBPalette16 PurpleColors_p FL_PROGMEM =
+{
+    CRGB::Purple,
+    CRGB::Maroon,
+    CRGB::Violet,
+    CRGB::DarkViolet,
+
+    CRGB::Purple,
+    CRGB::Maroon,
+    CRGB::Violet,
+    CRGB::DarkViolet,
+
+    CRGB::Purple,
+    CRGB::Maroon,
+    CRGB::Violet,
+    CRGB::DarkViolet,
+
+    CRGB::Pink,
+    CRGB::Maroon,
+    CRGB::Violet,
+    CRGB::DarkViolet
+};
+
+const TProgmemRGBPalette16 RGBColors_p FL_PROGMEM =
+{
+    CRGB::Red,
+    CRGB::Green,
+    CRGB::Blue,
+    CRGB::Red,
+    CRGB::Green,
+    CRGB::Blue,
+    CRGB::Red,
+    CRGB::Green,
+    CRGB::Blue,
+    CRGB::Red,
+    CRGB::Green,
+    CRGB::Blue,
+    CRGB::Red,
+    CRGB::Green,
+    CRGB::Blue,
+    CRGB::Blue
+};
+
+const TProgmemRGBPalette16 MagentaColors_p FL_PROGMEM =
+{
+    CRGB::Pink,
+    CRGB::DeepPink,
+    CRGB::HotPink,
+    CRGB::LightPink,
+    CRGB::LightCoral,
+    CRGB::Purple,
+    CRGB::MediumPurple,
+    CRGB::Magenta,
+    CRGB::DarkMagenta,
+    CRGB::DarkSalmon,
+    CRGB::MediumVioletRed,
+    CRGB::Pink,
+    CRGB::DeepPink,
+    CRGB::HotPink,
+    CRGB::LightPink,
+    CRGB::Magenta
+};
+
+const TProgmemRGBPalette16 SpectrumColors_p FL_PROGMEM =
+{
+    0xFD0E35, // Red
+    0xFF8833, // Orange
+    0xFFEB00, // Middle Yellow
+    0xAFE313, // Inchworm
+    0x3AA655, // Green
+    0x8DD9CC, // Middle Blue Green
+    0x0066FF, // Blue III
+    0xDB91EF, // Lilac
+    0xFD0E35, // Red
+    0xFF8833, // Orange
+    0xFFEB00, // Middle Yellow
+    0xAFE313, // Inchworm
+    0x3AA655, // Green
+    0x8DD9CC, // Middle Blue Green
+    0x0066FF, // Blue III
+    0xDB91EF  // Lilac
+};
+
+const TProgmemRGBPalette16 BGColors_p FL_PROGMEM =
+{
+    CRGB::White,
+    CRGB::White,
+    CRGB::White,
+    CRGB::White,
+    CRGB::White,
+    CRGB::White,
+    CRGB::Green,
+    CRGB::Green,
+    CRGB::Green,
+    CRGB::Green,
+    CRGB::Green,
+    CRGB::Red,
+    CRGB::Red,
+    CRGB::Red,
+    CRGB::Red,
+    CRGB::Red
+};
+
+const TProgmemRGBPalette16 BlueStripes_p FL_PROGMEM =
+{
+    CRGB::White, CRGB::Blue, CRGB::Blue, CRGB::Blue, CRGB::Blue, CRGB::White, CRGB::Black, CRGB::Black,
+    CRGB::White, CRGB::Blue, CRGB::Blue, CRGB::Blue, CRGB::Blue, CRGB::White, CRGB::Black, CRGB::Black
+};
+
+const TProgmemRGBPalette16 MagentaStripes_p FL_PROGMEM =
+{
+    CRGB::White, CRGB::Magenta, CRGB::Magenta, CRGB::Magenta, CRGB::Magenta, CRGB::White, CRGB::Black, CRGB::Black,
+    CRGB::White, CRGB::Magenta, CRGB::Magenta, CRGB::Magenta, CRGB::Magenta, CRGB::White, CRGB::Black, CRGB::Black
+};
+
+DEFINE_GRADIENT_PALETTE( blueSweep_gp )
+{
+      0,     0,   0, 255,   // blue
+    255,     0, 128,   0    // green
+};
 
 DEFINE_GRADIENT_PALETTE( vu_gpGreen ) 
 {
@@ -40,7 +232,56 @@ DEFINE_GRADIENT_PALETTE( vu_gpGreen )
     192,   255,   0,   0,   // red
     255,   255,   0,   0    // red
 };
-CRGBPalette256 vuPaletteGreen = vu_gpGreen;
+
+const FlashPalette RainbowPalette(RainbowColors_p);
+const FlashPalette HeatPalette(HeatColors_p);
+const FlashPalette RGBPalette(RGBColors_p);
+const FlashPalette BluePalette(BlueColors_p);
+const FlashPalette RedPalette(RedColors_p);
+const FlashPalette GreenPalette(GreenColors_p);
+const FlashPalette PurplePalette(PurpleColors_p);
+const FlashPalette MagentaPalette(MagentaColors_p);
+const FlashPalette SpectrumPalette(SpectrumColors_p);
+const FlashPalette BGPalette(BGColors_p);
+const FlashPalette BlueSweepPalette(blueSweep_gp);
+const FlashPalette BlueStripesPalette(BlueStripes_p);
+const FlashPalette MagentaStripesPalette(MagentaStripes_p);
+const FlashPalette VUGreenPalette(vu_gpGreen);
+
+#define PALETTE_ENTRY(name, palette) { name, NameHash(name), &palette }
+
+static constexpr PaletteEntry s_allPalettes[] =
+{
+    PALETTE_ENTRY("rainbowPalette", RainbowPalette),
+    PALETTE_ENTRY("Heat",           HeatPalette),
+    PALETTE_ENTRY("RGB",            RGBPalette),
+    PALETTE_ENTRY("Blue",           BluePalette),
+    PALETTE_ENTRY("Red",            RedPalette),
+    PALETTE_ENTRY("Green",          GreenPalette),
+    PALETTE_ENTRY("Purple",         PurplePalette),
+    PALETTE_ENTRY("Magenta",        MagentaPalette),
+    PALETTE_ENTRY("spectrum",       SpectrumPalette),
+    PALETTE_ENTRY("BG",             BGPalette),
+    PALETTE_ENTRY("blueSweep",      BlueSweepPalette),
+    PALETTE_ENTRY("BlueStripes",    BlueStripesPalette),
+    PALETTE_ENTRY("MagentaStripes", MagentaStripesPalette),
+    PALETTE_ENTRY("vuGreen",        VUGreenPalette)
+};
+
+static_assert(HasUniqueHashes(s_allPalettes), "Two palette names hash the same");
+
+static constexpr HashIndex<2 * ARRAYSIZE(s_allPalettes)> s_paletteIndex(s_allPalettes);
+
+const FlashPalette *FindPalette(uint32_t hash)
+{
+    const PaletteEntry *entry = s_paletteIndex.Find(s_allPalettes, hash);
+    return entry ? entry->palette : NULL;
+}
+
+const PaletteEntry *GetPaletteEntry(size_t i)
+{
+    return i < ARRAYSIZE(s_allPalettes) ? &s_allPalettes[i] : NULL;
+}
 
 // DEFINE_GRADIENT_PALETTE( vu_gpBlue ) 
 // {
@@ -62,11 +303,11 @@ CRGBPalette256 vuPaletteGreen = vu_gpGreen;
 //     255, 0, 0, 64}; // dark blue
 // CRGBPalette256 bluesky_pal = bluesky_gp;
 
-// // For LEDMatrixGFX::from16Bit color conversions
+// // For LEDMatrixGFXBase::from16Bit color conversions
 // //
 // // These tables can't go in the .H file so we have this .CPP file for them instead
 
-const byte LEDMatrixGFX::gamma5[] =
+const byte LEDMatrixGFXBase::gamma5[] =
 {
     0x00, 0x01, 0x02, 0x03, 0x05, 0x07, 0x09, 0x0b,
     0x0e, 0x11, 0x14, 0x18, 0x1d, 0x22, 0x28, 0x2e,
@@ -74,7 +315,7 @@ const byte LEDMatrixGFX::gamma5[] =
     0x89, 0x97, 0xa6, 0xb6, 0xc7, 0xd9, 0xeb, 0xff
 };
 
-const byte LEDMatrixGFX::gamma6[] =
+const byte LEDMatrixGFXBase::gamma6[] =
 {
     0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x08,
     0x09, 0x0a, 0x0b, 0x0d, 0x0e, 0x10, 0x12, 0x13,
@@ -38,6 +38,8 @@
 #include "effects/stareffect.h" // star effects
 
 #include "effectsFactory.h"
+#include "binaryCommand.h"
+#include "colordata.h"
 #include <ArduinoJson.h>
 #include <string>
 
@@ -47,189 +49,6 @@
 
 // extern std::shared_ptr<LEDMatrixGFX> m_pLedStrip;
 
-// Palettes
-//
-// Palettes that are referenced by effects need to be instantiated first
-
-CRGBPalette256 BlueColors_p =
-    {
-        CRGB::DarkBlue,
-        CRGB::MediumBlue,
-        CRGB::Blue,
-        CRGB::MediumBlue,
-        CRGB::DarkBlue,
-        CRGB::MediumBlue,
-        CRGB::Blue,
-        CRGB::MediumBlue,
-        CRGB::DarkBlue,
-        CRGB::MediumBlue,
-        CRGB::Blue,
-        CRGB::MediumBlue,
-        CRGB::DarkBlue,
-        CRGB::MediumBlue,
-        CRGB::Blue,
-        CRGB::MediumBlue};
-
-CRGBPalette256 RedColors_p =
-    {
-        CRGB::Red,
-        CRGB::DarkRed,
-        CRGB::DarkRed,
-        CRGB::DarkRed,
-
-        CRGB::Red,
-        CRGB::DarkRed,
-        CRGB::DarkRed,
-        CRGB::DarkRed,
-
-        CRGB::Red,
-        CRGB::DarkRed,
-        CRGB::DarkRed,
-        CRGB::DarkRed,
-
-        CRGB::Red,
-        CRGB::DarkRed,
-        CRGB::DarkRed,
-        CRGB::OrangeRed,
-};
-
-CRGBPalette256 GreenColors_p =
-    {
-        CRGB::Green,
-        CRGB::DarkGreen,
-        CRGB::DarkGreen,
-        CRGB::DarkGreen,
-
-        CRGB::Green,
-        CRGB::DarkGreen,
-        CRGB::DarkGreen,
-        CRGB::DarkGreen,
-
-        CRGB::Green,
-        CRGB::DarkGreen,
-        CRGB::DarkGreen,
-        CRGB::DarkGreen,
-
-        CRGB::Green,
-        CRGB::DarkGreen,
-        CRGB::DarkGreen,
-        CRGB::LimeGreen,
-};
-
-CRGBPalette256 PurpleColors_p =
-    {
-        CRGB::Purple,
-        CRGB::Maroon,
-        CRGB::Violet,
-        CRGB::DarkViolet,
-
-        CRGB::Purple,
-        CRGB::Maroon,
-        CRGB::Violet,
-        CRGB::DarkViolet,
-
-        CRGB::Purple,
-        CRGB::Maroon,
-        CRGB::Violet,
-        CRGB::DarkViolet,
-
-        CRGB::Pink,
-        CRGB::Maroon,
-        CRGB::Violet,
-        CRGB::DarkViolet,
-};
-
-CRGBPalette256 RGBColors_p =
-    {
-        CRGB::Red,
-        CRGB::Green,
-        CRGB::Blue,
-        CRGB::Red,
-        CRGB::Green,
-        CRGB::Blue,
-        CRGB::Red,
-        CRGB::Green,
-        CRGB::Blue,
-        CRGB::Red,
-        CRGB::Green,
-        CRGB::Blue,
-        CRGB::Red,
-        CRGB::Green,
-        CRGB::Blue,
-        CRGB::Blue};
-
-CRGBPalette256 MagentaColors_p =
-    {
-        CRGB::Pink,
-        CRGB::DeepPink,
-        CRGB::HotPink,
-        CRGB::LightPink,
-        CRGB::LightCoral,
-        CRGB::Purple,
-        CRGB::MediumPurple,
-        CRGB::Magenta,
-        CRGB::DarkMagenta,
-        CRGB::DarkSalmon,
-        CRGB::MediumVioletRed,
-        CRGB::Pink,
-        CRGB::DeepPink,
-        CRGB::HotPink,
-        CRGB::LightPink,
-        CRGB::Magenta};
-
-CRGBPalette256 spectrumBasicColors =
-    {
-        CRGB(0xFD0E35), // Red
-        CRGB(0xFF8833), // Orange
-        CRGB(0xFFEB00), // Middle Yellow
-        CRGB(0xAFE313), // Inchworm
-        CRGB(0x3AA655), // Green
-        CRGB(0x8DD9CC), // Middle Blue Green
-        CRGB(0x0066FF), // Blue III
-        CRGB(0xDB91EF), // Lilac
-        CRGB(0xFD0E35), // Red
-        CRGB(0xFF8833), // Orange
-        CRGB(0xFFEB00), // Middle Yellow
-        CRGB(0xAFE313), // Inchworm
-        CRGB(0x3AA655), // Green
-        CRGB(0x8DD9CC), // Middle Blue Green
-        CRGB(0x0066FF), // Blue III
-        CRGB(0xDB91EF)  // Lilac
-};
-
-CRGBPalette256 BGColors_p =
-    {
-        CRGB::White,
-        CRGB::White,
-        CRGB::White,
-        CRGB::White,
-        CRGB::White,
-        CRGB::White,
-        CRGB::Green,
-        CRGB::Green,
-        CRGB::Green,
-        CRGB::Green,
-        CRGB::Green,
-        CRGB::Red,
-        CRGB::Red,
-        CRGB::Red,
-        CRGB::Red,
-        CRGB::Red,
-};
-
-// AllEffects
-//
-// The master effects table
-
-CRGBPalette256 rainbowPalette(RainbowColors_p);
-CRGBPalette256 blueSweep(CRGB::Blue, CRGB::Green);
-
-CRGBPalette256 BlueStripes(CRGB::White, CRGB::Blue, CRGB::Blue, CRGB::Blue, CRGB::Blue, CRGB::White, CRGB::Black, CRGB::Black,
-                           CRGB::White, CRGB::Blue, CRGB::Blue, CRGB::Blue, CRGB::Blue, CRGB::White, CRGB::Black, CRGB::Black);
-
-CRGBPalette256 MagentaStripes(CRGB::White, CRGB::Magenta, CRGB::Magenta, CRGB::Magenta, CRGB::Magenta, CRGB::White, CRGB::Black, CRGB::Black,
-                              CRGB::White, CRGB::Magenta, CRGB::Magenta, CRGB::Magenta, CRGB::Magenta, CRGB::White, CRGB::Black, CRGB::Black);
-
 #define STARRYNIGHT_PROBABILITY 1.0
 #define STARRYNIGHT_MUSICFACTOR 1.0
 
@@ -318,377 +137,579 @@ LEDStripEffect * AllEffects[] =
 };
 */
 
-bool EffectsFactory::CreateEffect(String jsonParams, int8_t *piChannel, LEDStripEffect **poutEffect)
+// ExpandPalette - The palette built in the arena, NULL with strError filled in if it does not fit
+
+static PaletteHandle ExpandPalette(EffectArena &arena, const FlashPalette &palette, String &strError)
 {
-    const int capacity = JSON_OBJECT_SIZE(15);
+    PaletteHandle expanded = palette.Expand(arena);
+    if (expanded == NULL)
+        strError = "Palette does not fit in the effect arena.";
+    return expanded;
+}
 
-    Print("JSON capacity (in bytes) = ");
-    Println(capacity);
+// GetPalette
+//
+// Expands the named palette into the arena the effect is about to be built in, NULL if there is no such
+// palette or it does not fit
 
-    StaticJsonDocument<1000> doc;
+static PaletteHandle GetPalette(EffectArena &arena, uint32_t nameHash, String &strError)
+{
+    const FlashPalette *palette = FindPalette(nameHash);
+    if (palette == NULL)
+    {
+        strError = "Unknown palette name";
+        return NULL;
+    }
+    return ExpandPalette(arena, *palette, strError);
+}
 
-    // Deserialize the JSON document
-    DeserializationError error = deserializeJson(doc, jsonParams);
+// Star types
+//
+// One row per kind of star, every one of them run by the same StarryNightEffect (or BlurStarEffect).  Stage
+// lengths are in milliseconds: preignition, ignition, hold and fade.
 
-    bool result = true;
+#define STAR_TYPE(name, preignition, ignition, hold, fade, color, size) \
+    { name, NameHash(name), name " StarryNightEffect", preignition, ignition, hold, fade, StarColor::color, StarSize::size }
 
-    // Test if parsing succeeds.
-    // TODO We can publish the error or something
-    if (error)
-    {
-        m_strLastError = "deserializeJson() failed: " + String(error.f_str());
-        Println(m_strLastError);
+static constexpr StarProfile s_starTypes[] =
+{
+    STAR_TYPE("Star",                      0,  500, 1000, 1500, First,    Effect),
+    STAR_TYPE("BubblyStar",                0,   50,  250,  500, First,    Effect),
+    STAR_TYPE("FlashStar",                 0,  100,  100,   50, First,    Effect),
+    STAR_TYPE("ColorCycleStar",         2000,    0, 2000,  500, First,    OnePixel),
+    STAR_TYPE("MultiColorStar",         2000,    0, 2000,  500, First,    OnePixel),
+    STAR_TYPE("ChristmasLightStar",      200,    0, 6000, 1250, Random,   Effect),
+    STAR_TYPE("HotWhiteStar",              0,  200,    0, 2000, First,    Effect),
+    STAR_TYPE("RandomPaletteColorStar", 2000,    0, 2000,  500, First,    OnePixel),
+    STAR_TYPE("LongLifeSparkleStar",     250, 5000,    0,    0, First,    Effect),
+    STAR_TYPE("QuietStar",              1000,    0,    0, 2000, Random16, Effect),
+    STAR_TYPE("MusicPulseStar",            0,    0, 1000, 2000, First,    Effect)
+};
 
-        result = false;
-    }
-    else if (!doc.containsKey("name"))
-    {
-        Println("ERROR: JSON no 'name' found.");
-        m_strLastError = "Effect name is missing.";
+static_assert(HasUniqueHashes(s_starTypes), "Two star type names hash the same");
+static constexpr HashIndex<2 * ARRAYSIZE(s_starTypes)> s_starTypeIndex(s_starTypes);
 
-        result = false;
-    }
+// Star presets
+//
+// The "buildIn" star effects, complete with their own palettes and settings
 
-    if (!result)
-    {
-        doc.clear();
-        return false;
-    }
+struct StarPresetEntry
+{
+    const char         *name;
+    uint32_t            hash;
+    const char         *friendlyName;
+    const StarProfile  *starType;
+    const FlashPalette *palette;
+    float               probability;
+    float               starSize;
+    TBlendType          blendType;
+    float               maxSpeed;
+    float               musicFactor;
+};
 
-    *piChannel = doc["channel"] | -1;
+#define STAR_PRESET(name, friendlyName, starType, palette, probability, starSize, blendType, maxSpeed, musicFactor) \
+    { name, NameHash(name), friendlyName, s_starTypeIndex.Find(s_starTypes, NameHash(starType)), &palette, probability, starSize, blendType, maxSpeed, musicFactor }
 
-    String effectName = doc["name"];
-    if (effectName == "TwinkleStarEffect")
-    {
-        Println("JSON: name = TwinkleStarEffect");
-        *poutEffect = new TwinkleStarEffect();
-    }
-    else if (effectName == "StarryNightEffect")
-    {
-        Println("JSON: name = StarryNightEffect");
-        result = this->CreateStarryNightEffect(&doc, poutEffect);
-    }
-    else if (effectName == "PaletterEffect")
-    {
-        Println("JSON: name = PaletterEffect");
-        result = this->CreatePaletterEffect(&doc, poutEffect);
-    }
-    else if (effectName == "RainbowTwinkleEffect")
-    {
-        Println("JSON: name = RainbowTwinkleEffect");
-        float speed = doc["speedDivisor"] | 12.0f;
-        int deltaHue = doc["deltaHue"] | 14;
+static constexpr StarPresetEntry s_starPresets[] =
+{
+    STAR_PRESET("Rainbow Twinkle Stars",         "Rainbow Twinkle Stars",         "QuietStar",  RainbowPalette, STARRYNIGHT_PROBABILITY, 1,  LINEARBLEND, 2.0, STARRYNIGHT_MUSICFACTOR),
+    STAR_PRESET("Green Twinkle",                 "Magenta Twinkle Stars",         "QuietStar",  GreenPalette,   STARRYNIGHT_PROBABILITY, 1,  LINEARBLEND, 2.0, STARRYNIGHT_MUSICFACTOR),
+    STAR_PRESET("Blue Sparkle",                  "Blue Sparkle Stars",            "Star",       BluePalette,    STARRYNIGHT_PROBABILITY, 1,  LINEARBLEND, 2.0, STARRYNIGHT_MUSICFACTOR),
+    STAR_PRESET("Red Twinkle",                   "Red Twinkle Stars",             "QuietStar",  MagentaPalette, 1.0,                     1,  LINEARBLEND, 2.0, 1.0),
+    STAR_PRESET("Lava Stars",                    "Lava Stars",                    "Star",       MagentaPalette, STARRYNIGHT_PROBABILITY, 1,  LINEARBLEND, 2.0, STARRYNIGHT_MUSICFACTOR),
+    STAR_PRESET("Blooming Little Rainbow Stars", "Little Blooming Rainbow Stars", "BubblyStar", MagentaPalette, STARRYNIGHT_PROBABILITY, 4,  LINEARBLEND, 2.0, STARRYNIGHT_MUSICFACTOR),
+    STAR_PRESET("Blooming Rainbow Stars",        "Big Blooming Rainbow Stars",    "BubblyStar", MagentaPalette, 2,                       12, LINEARBLEND, 1.0, 1.0),
+    STAR_PRESET("Neon Bars",                     "Neon Bars",                     "BubblyStar", MagentaPalette, 0.5,                     64, NOBLEND,     0,   1.0),
+    STAR_PRESET("Little Blooming Rainbow Stars", "Little Blooming Rainbow Stars", "BubblyStar", BluePalette,    STARRYNIGHT_PROBABILITY, 4,  LINEARBLEND, 2.0, STARRYNIGHT_MUSICFACTOR),
+    STAR_PRESET("Green Twinkle Stars",           "Green Twinkle Stars",           "QuietStar",  GreenPalette,   STARRYNIGHT_PROBABILITY, 1,  LINEARBLEND, 2.0, STARRYNIGHT_MUSICFACTOR)
+};
 
-        *poutEffect = new RainbowTwinkleEffect(speed, deltaHue);
-    }
-    else if (effectName == "RainbowFillEffect")
+static_assert(HasUniqueHashes(s_starPresets), "Two star preset names hash the same");
+static constexpr HashIndex<2 * ARRAYSIZE(s_starPresets)> s_starPresetIndex(s_starPresets);
+
+static constexpr bool PresetStarTypesExist()
+{
+    for (const StarPresetEntry &preset : s_starPresets)
+        if (preset.starType == nullptr)
+            return false;
+    return true;
+}
+
+static_assert(PresetStarTypesExist(), "A star preset names a star type that is not in s_starTypes");
+
+// StarBufferBytes
+//
+// The most arena any star type takes at the default probability, or any preset at its own.  A larger
+// probability asked for over MQTT needs more stars than this makes room for and is turned down by Init.
+
+static constexpr size_t StarBufferBytes(float defaultProbability)
+{
+    size_t cb = 0;
+    for (const StarProfile &starType : s_starTypes)
+        cb = std::max<size_t>(cb, StarryNightEffect::BufferBytes(starType, defaultProbability));
+    for (const StarPresetEntry &preset : s_starPresets)
+        cb = std::max<size_t>(cb, StarryNightEffect::BufferBytes(*preset.starType, preset.probability));
+    return cb;
+}
+
+// Effect constructor thunks
+//
+// One parameter table and one thunk per effect.  Adding an effect means adding these and a line in s_effects.
+
+static LEDStripEffect *CreateTwinkleStar(EffectArena &arena, const EffectArgs &, String &)
+{
+    return new (arena) TwinkleStarEffect();
+}
+
+static constexpr EffectParam s_starryNightParams[] =
+{
+    PARAM_NAME ("buildIn",     nullptr),
+    PARAM_NAME ("starEffect",  "StarryNightEffect"),
+    PARAM_NAME ("starType",    "BubblyStar"),
+    PARAM_NAME ("palette",     nullptr),
+    PARAM_FLOAT("probability", 1.0),
+    PARAM_FLOAT("starSize",    1.0),
+    PARAM_FLOAT("maxSpeed",    100.0),
+    PARAM_FLOAT("blurFactor",  0.0)
+};
+
+static LEDStripEffect *CreateStarryNightEffect(EffectArena &arena, const EffectArgs &args, String &strError)
+{
+    const StarPresetEntry *preset = s_starPresetIndex.Find(s_starPresets, args.Name("buildIn"_h));
+    if (preset)
     {
-        Println("JSON: name = RainbowFillEffect");
-        float speed = doc["speedDivisor"] | 12.0f;
-        int deltaHue = doc["deltaHue"] | 14;
+        PaletteHandle palette = ExpandPalette(arena, *preset->palette, strError);
+        if (!palette)
+            return NULL;
 
-        *poutEffect = new RainbowFillEffect(speed, deltaHue);
+        return new (arena) StarryNightEffect(preset->friendlyName, *preset->starType, palette, preset->probability, preset->starSize,
+                                             preset->blendType, preset->maxSpeed, 0.0, preset->musicFactor);
     }
-    else if (effectName == "Marquee")
+
+    const StarProfile *starType = s_starTypeIndex.Find(s_starTypes, args.Name("starType"_h));
+    if (!starType)
     {
-        Println("JSON: name = Marquee");
-        bool mirror = doc["mirror"] | false;
-        *poutEffect = new Marquee(mirror);
+        strError = "Star type not found";
+        return NULL;
     }
-    else if (effectName == "BulgarianFlag")
+
+    PaletteHandle palette = GetPalette(arena, args.Name("palette"_h), strError);
+    if (!palette)
+        return NULL;
+
+    float probability = args.Float("probability"_h);
+    float starSize = args.Float("starSize"_h);
+    double maxSpeed = args.Float("maxSpeed"_h);
+    double blurFactor = args.Float("blurFactor"_h);
+
+    switch (args.Name("starEffect"_h))
     {
-        Println("JSON: name = BulgarianFlag");
-        bool reverse = doc["reverse"] | false;
-        *poutEffect = new BulgarianFlag(reverse);
+        case "StarryNightEffect"_h:
+            return new (arena) StarryNightEffect(starType->effectName, *starType, palette, probability, starSize, LINEARBLEND, maxSpeed, blurFactor);
+        case "BlurStarEffect"_h:
+            return new (arena) BlurStarEffect(*starType, palette, probability, starSize, LINEARBLEND, maxSpeed);
     }
-    else if (effectName == "MeteorEffect")
-    {
-        Println("JSON: name = MeteorEffect");
 
-        int meteors = doc["meteors"] | 4;
-        unsigned int size = doc["size"] | 4;
-        unsigned int decay = doc["decay"] | 3;
-        double minSpeed = doc["minSpeed"] | 0.2;
-        double maxSpeed = doc["maxSpeed"] | 0.2;
+    strError = "Unknown starEffectName";
+    return NULL;
+}
 
-        *poutEffect = new MeteorEffect(meteors, size, decay, minSpeed, maxSpeed);
-    }
-    else if (effectName == "FireEffect")
-    {
-        Println("JSON: name = FireEffect");
+static constexpr const char *s_starEffects[] =
+{
+    "StarryNightEffect",
+    "BlurStarEffect"
+};
 
-        int cellsPerLED = doc["cellsPerLED"] | 1;
-        int cooling = doc["cooling"] | 20;
-        int sparking = doc["sparking"] | 100;
-        int sparks = doc["sparks"] | 3;
-        int sparkHeight = doc["sparkHeigh"] | 4;
-        bool reversed = doc["reversed"] | false;
-        bool mirrored = doc["mirrored"] | false;
+static constexpr EffectParam s_paletteParams[] =
+{
+    PARAM_NAME("buildIn", nullptr),
+    PARAM_NAME("palette", "RGB")
+};
+
+// The "buildIn" palette effects, as named in the switch below
+static constexpr const char *s_paletteBuildIns[] =
+{
+    "Rainbow2",
+    "Rainbow",
+    "RanbowSimple"
+};
 
-        *poutEffect = new FireEffect(NUM_LEDS, cellsPerLED, cooling, sparking, sparks, sparkHeight, reversed, mirrored);
+static LEDStripEffect *CreatePaletteEffect(EffectArena &arena, const EffectArgs &args, String &strError)
+{
+    PaletteHandle palette;
+    switch (args.Name("buildIn"_h))
+    {
+        case 0:
+            break;
+        case "Rainbow2"_h:
+            palette = ExpandPalette(arena, RainbowPalette, strError);
+            return palette ? new (arena) PaletteEffect(palette) : NULL; // Rainbow palette
+        case "Rainbow"_h:
+            palette = ExpandPalette(arena, MagentaPalette, strError);
+            return palette ? new (arena) PaletteEffect(palette) : NULL; // Rainbow palette
+        case "RanbowSimple"_h:
+            palette = ExpandPalette(arena, RainbowPalette, strError);
+            return palette ? new (arena) PaletteEffect(palette, 256 / 16, .2, 0) : NULL; // Simple rainbow pallette
+        default:
+            strError = "PleatterEffect buildIn effect was not found";
+            return NULL;
     }
-    else if (effectName == "PaletteFlameEffect")
-    {
-        Println("JSON: name = PaletteFlameEffect");
 
-        CRGBPalette256 *palette;
-        String paletteName = doc["palette"] | String("RGB");
-        this->GetPaletterFromString(paletteName, &palette);
+    palette = GetPalette(arena, args.Name("palette"_h), strError);
+    if (!palette)
+        return NULL;
 
-        int cellsPerLED = doc["cellsPerLED"] | 1;
-        int cooling = doc["cooling"] | 1.8;
-        int sparking = doc["sparking"] | 100;
-        int sparkHeight = doc["sparkHeigh"] | 3;
-        bool reversed = doc["reversed"] | false;
-        bool mirrored = doc["mirrored"] | false;
+    return new (arena) PaletteEffect(palette);
+}
 
-        *poutEffect = new PaletteFlameEffect("Custom PaletteFlameEffect", *palette, NUM_LEDS, cellsPerLED, cooling, sparking, sparkHeight, reversed, mirrored);
-    }
-    else if (effectName == "ClassicFireEffect")
-    {
-        Println("JSON name = ClassicFireEffect");
+static constexpr EffectParam s_rainbowParams[] =
+{
+    PARAM_FLOAT("speedDivisor", 12.0),
+    PARAM_INT  ("deltaHue",     14)
+};
 
-        bool mirrored = doc["mirrored"] | false;
-        bool reversed = doc["reversed"] | false;
-        int cooling = doc["cooling"] | 5;
+static LEDStripEffect *CreateRainbowTwinkle(EffectArena &arena, const EffectArgs &args, String &)
+{
+    return new (arena) RainbowTwinkleEffect(args.Float("speedDivisor"_h), args.Int("deltaHue"_h));
+}
 
-        *poutEffect = new ClassicFireEffect(mirrored, reversed, cooling);
-    }
-    else if (effectName == "SmoothFireEffect")
-    {
-        Println("JSON: name = SmoothFireEffect");
-
-        bool reversed = doc["reversed"] | false;
-        float cooling = doc["cooling"] | 1.2f;
-        int sparks = doc["sparks"] | 16;
-        int driftPasses = doc["driftPasses"] | 1;
-        float drift = doc["drift"] | 48;
-        int sparkHeight = doc["sparkHeight"] | 12;
-        bool turbo = doc["turbo"] | false;
-        bool mirrored = doc["mirrored"] | false;
-
-        *poutEffect = new SmoothFireEffect(reversed, cooling, sparks, driftPasses, drift, sparkHeight, turbo, mirrored);
-    }
-    else if (effectName == "BaseFireEffect")
-    {
-        Println("JSON: name = BaseFireEffect");
+static LEDStripEffect *CreateRainbowFill(EffectArena &arena, const EffectArgs &args, String &)
+{
+    return new (arena) RainbowFillEffect(args.Float("speedDivisor"_h), args.Int("deltaHue"_h));
+}
 
-        int cellsPerLED = doc["cellsPerLED"] | 1;
-        int cooling = doc["cooling"] | 20;
-        int sparking = doc["sparking"] | 100;
-        int sparks = doc["sparks"] | 3;
-        int sparkHeight = doc["sparkHeight"] | 4;
-        bool reversed = doc["reversed"] | false;
-        bool mirrored = doc["mirrored"] | false;
+static constexpr EffectParam s_marqueeParams[] =
+{
+    PARAM_BOOL("mirror", false)
+};
 
-        *poutEffect = new BaseFireEffect(NUM_LEDS, cellsPerLED, cooling, sparking, sparks, sparkHeight, reversed, mirrored);
-    }
-    else if (effectName == "DoublePaletteEffect")
-    {
-        Println("JSON: name = DoublePaletteEffect");
-        *poutEffect = new DoublePaletteEffect();
-    }
-    else if (effectName == "BouncingBallEffect")
-    {
-        Println("JSON: name = BouncingBallEffect");
+static LEDStripEffect *CreateMarquee(EffectArena &arena, const EffectArgs &args, String &)
+{
+    return new (arena) Marquee(args.Bool("mirror"_h));
+}
 
-        size_t ballCount = doc["ballCount"] | 3;
-        bool mirrored = doc["mirrored"] | false;
-        int ballSize = doc["ballSize"] | 5;
+static constexpr EffectParam s_flagParams[] =
+{
+    PARAM_BOOL("reverse", false)
+};
 
-        *poutEffect = new BouncingBallEffect(ballCount, mirrored, true, ballSize);
-    }
-    else if (effectName == "SolidFill")
-    {
-        Println("JSON: name = SolidFill");
+static LEDStripEffect *CreateBulgarianFlag(EffectArena &arena, const EffectArgs &args, String &)
+{
+    return new (arena) BulgarianFlag(args.Bool("reverse"_h));
+}
 
-        uint8_t ir = doc["red"] | 255;
-        uint8_t ig = doc["green"] | 255;
-        uint8_t ib = doc["blue"] | 255;
+static constexpr EffectParam s_meteorParams[] =
+{
+    PARAM_INT  ("meteors",  4),
+    PARAM_INT  ("size",     4),
+    PARAM_INT  ("decay",    3),
+    PARAM_FLOAT("minSpeed", 0.2),
+    PARAM_FLOAT("maxSpeed", 0.2)
+};
 
-        *poutEffect = new SolidFillEffect(ir, ig, ib);
-    }
-    else
-    {
-        m_strLastError = "Effect " + effectName + " does not exists.";
-        Println(m_strLastError);
+static LEDStripEffect *CreateMeteor(EffectArena &arena, const EffectArgs &args, String &)
+{
+    return new (arena) MeteorEffect(args.Int("meteors"_h), args.Int("size"_h), args.Int("decay"_h), args.Float("minSpeed"_h), args.Float("maxSpeed"_h));
+}
 
-        result = false;
-    }
+static constexpr EffectParam s_fireParams[] =
+{
+    PARAM_INT ("cellsPerLED", 1),
+    PARAM_INT ("cooling",     20),
+    PARAM_INT ("sparking",    100),
+    PARAM_INT ("sparks",      3),
+    PARAM_INT ("sparkHeigh",  4),
+    PARAM_BOOL("reversed",    false),
+    PARAM_BOOL("mirrored",    false)
+};
 
-    doc.clear();
-    return result;
+static LEDStripEffect *CreateFire(EffectArena &arena, const EffectArgs &args, String &)
+{
+    return new (arena) FireEffect(NUM_LEDS, args.Int("cellsPerLED"_h), args.Int("cooling"_h), args.Int("sparking"_h), args.Int("sparks"_h),
+                          args.Int("sparkHeigh"_h), args.Bool("reversed"_h), args.Bool("mirrored"_h));
 }
 
-bool EffectsFactory::CreatePaletterEffect(StaticJsonDocument<JSON_DOC_SIZE> *doc, LEDStripEffect **poutEffect)
+static constexpr EffectParam s_paletteFlameParams[] =
 {
-    if (doc->containsKey("buildIn"))
-    {
-        String buildIn = doc->getMember("buildIn");
-
-        if (buildIn == "Rainbow2")
-            *poutEffect = new PaletteEffect(RainbowColors_p); // Rainbow palette
-        else if (buildIn == "Rainbow")
-            *poutEffect = new PaletteEffect(MagentaColors_p); // Rainbow palette
-        else if (buildIn == "RanbowSimple")
-            *poutEffect = new PaletteEffect(rainbowPalette, 256 / 16, .2, 0); // Simple rainbow pallette
-        else
-        {
-            m_strLastError = "PleatterEffect buildIn effect was not found";
-            return false;
-        }
+    PARAM_NAME("palette",     "RGB"),
+    PARAM_INT ("cellsPerLED", 1),
+    PARAM_INT ("cooling",     1),
+    PARAM_INT ("sparking",    100),
+    PARAM_INT ("sparkHeigh",  3),
+    PARAM_BOOL("reversed",    false),
+    PARAM_BOOL("mirrored",    false)
+};
 
-        return true;
-    }
+static LEDStripEffect *CreatePaletteFlame(EffectArena &arena, const EffectArgs &args, String &strError)
+{
+    PaletteHandle palette = GetPalette(arena, args.Name("palette"_h), strError);
+    if (!palette)
+        return NULL;
+
+    return new (arena) PaletteFlameEffect("Custom PaletteFlameEffect", palette, NUM_LEDS, args.Int("cellsPerLED"_h), args.Int("cooling"_h),
+                                  args.Int("sparking"_h), args.Int("sparkHeigh"_h), args.Bool("reversed"_h), args.Bool("mirrored"_h));
+}
 
-    String paletteName = doc->getMember("palette") | "RGB";
-    CRGBPalette256 *palette;
-    this->GetPaletterFromString(paletteName, &palette);
+static constexpr EffectParam s_classicFireParams[] =
+{
+    PARAM_BOOL("mirrored", false),
+    PARAM_BOOL("reversed", false),
+    PARAM_INT ("cooling",  5)
+};
+
+static LEDStripEffect *CreateClassicFire(EffectArena &arena, const EffectArgs &args, String &)
+{
+    return new (arena) ClassicFireEffect(args.Bool("mirrored"_h), args.Bool("reversed"_h), args.Int("cooling"_h));
+}
+
+static constexpr EffectParam s_smoothFireParams[] =
+{
+    PARAM_BOOL ("reversed",    false),
+    PARAM_FLOAT("cooling",     1.2),
+    PARAM_INT  ("sparks",      16),
+    PARAM_INT  ("driftPasses", 1),
+    PARAM_FLOAT("drift",       48),
+    PARAM_INT  ("sparkHeight", 12),
+    PARAM_BOOL ("turbo",       false),
+    PARAM_BOOL ("mirrored",    false)
+};
 
-    *poutEffect = new PaletteEffect(*palette);
+static LEDStripEffect *CreateSmoothFire(EffectArena &arena, const EffectArgs &args, String &)
+{
+    return new (arena) SmoothFireEffect(args.Bool("reversed"_h), args.Float("cooling"_h), args.Int("sparks"_h), args.Int("driftPasses"_h),
+                                args.Float("drift"_h), args.Int("sparkHeight"_h), args.Bool("turbo"_h), args.Bool("mirrored"_h));
+}
+
+static constexpr EffectParam s_baseFireParams[] =
+{
+    PARAM_INT ("cellsPerLED", 1),
+    PARAM_INT ("cooling",     20),
+    PARAM_INT ("sparking",    100),
+    PARAM_INT ("sparks",      3),
+    PARAM_INT ("sparkHeight", 4),
+    PARAM_BOOL("reversed",    false),
+    PARAM_BOOL("mirrored",    false)
+};
+
+static LEDStripEffect *CreateBaseFire(EffectArena &arena, const EffectArgs &args, String &)
+{
+    return new (arena) BaseFireEffect(NUM_LEDS, args.Int("cellsPerLED"_h), args.Int("cooling"_h), args.Int("sparking"_h), args.Int("sparks"_h),
+                              args.Int("sparkHeight"_h), args.Bool("reversed"_h), args.Bool("mirrored"_h));
+}
+
+static LEDStripEffect *CreateDoublePalette(EffectArena &arena, const EffectArgs &, String &strError)
+{
+    PaletteHandle palette = ExpandPalette(arena, RainbowPalette, strError);
+    if (!palette)
+        return NULL;
+
+    return new (arena) DoublePaletteEffect(palette);
+}
+
+static constexpr EffectParam s_bouncingBallParams[] =
+{
+    PARAM_INT ("ballCount", 3),
+    PARAM_BOOL("mirrored",  false),
+    PARAM_INT ("ballSize",  5)
+};
+
+static LEDStripEffect *CreateBouncingBall(EffectArena &arena, const EffectArgs &args, String &)
+{
+    return new (arena) BouncingBallEffect(args.Int("ballCount"_h), args.Bool("mirrored"_h), true, args.Int("ballSize"_h));
+}
+
+static constexpr EffectParam s_solidFillParams[] =
+{
+    PARAM_INT("red",   255),
+    PARAM_INT("green", 255),
+    PARAM_INT("blue",  255)
+};
+
+static LEDStripEffect *CreateSolidFill(EffectArena &arena, const EffectArgs &args, String &)
+{
+    return new (arena) SolidFillEffect(args.Int("red"_h), args.Int("green"_h), args.Int("blue"_h));
+}
+
+// s_effects
+//
+// The effect registry, keyed by the name used in requests.  The last column is how much of the effect arena
+// the effect takes with its default parameters, palette included, the arenas are sized from the largest of them.
+
+#define EFFECT_ENTRY(name, thunk, params, bytes)  { name, NameHash(name), &thunk, params, ARRAYSIZE(params), bytes }
+#define EFFECT_ENTRY_NOPARAMS(name, thunk, bytes) { name, NameHash(name), &thunk, nullptr, 0, bytes }
+#define EFFECT_BYTES(type, buffers)               (ArenaBytes(sizeof(type)) + (buffers))
+
+static constexpr size_t HDRBytes = ArenaBytes(sizeof(HDRAccumulator));
+
+static constexpr EffectEntry s_effects[] =
+{
+    EFFECT_ENTRY_NOPARAMS("TwinkleStarEffect",  CreateTwinkleStar,                               EFFECT_BYTES(TwinkleStarEffect, 0)),
+    EFFECT_ENTRY("StarryNightEffect",           CreateStarryNightEffect, s_starryNightParams,    EFFECT_BYTES(BlurStarEffect, PaletteBytes + StarBufferBytes(1.0f))),
+    EFFECT_ENTRY("PaletterEffect",              CreatePaletteEffect,     s_paletteParams,        EFFECT_BYTES(PaletteEffect, PaletteBytes)),
+    EFFECT_ENTRY("RainbowTwinkleEffect",        CreateRainbowTwinkle,    s_rainbowParams,        EFFECT_BYTES(RainbowTwinkleEffect, 0)),
+    EFFECT_ENTRY("RainbowFillEffect",           CreateRainbowFill,       s_rainbowParams,        EFFECT_BYTES(RainbowFillEffect, 0)),
+    EFFECT_ENTRY("Marquee",                     CreateMarquee,           s_marqueeParams,        EFFECT_BYTES(Marquee, 0)),
+    EFFECT_ENTRY("BulgarianFlag",               CreateBulgarianFlag,     s_flagParams,           EFFECT_BYTES(BulgarianFlag, 0)),
+    EFFECT_ENTRY("MeteorEffect",                CreateMeteor,            s_meteorParams,         EFFECT_BYTES(MeteorEffect, MeteorChannel::BufferBytes(4))),
+    EFFECT_ENTRY("FireEffect",                  CreateFire,              s_fireParams,           EFFECT_BYTES(FireEffect, FireEffect::BufferBytes(NUM_LEDS, 1))),
+    EFFECT_ENTRY("PaletteFlameEffect",          CreatePaletteFlame,      s_paletteFlameParams,   EFFECT_BYTES(PaletteFlameEffect, PaletteBytes + FireEffect::BufferBytes(NUM_LEDS, 1))),
+    EFFECT_ENTRY("ClassicFireEffect",           CreateClassicFire,       s_classicFireParams,    EFFECT_BYTES(ClassicFireEffect, ClassicFireEffect::BufferBytes(NUM_LEDS))),
+    EFFECT_ENTRY("SmoothFireEffect",            CreateSmoothFire,        s_smoothFireParams,     EFFECT_BYTES(SmoothFireEffect, SmoothFireEffect::BufferBytes(NUM_LEDS))),
+    EFFECT_ENTRY("BaseFireEffect",              CreateBaseFire,          s_baseFireParams,       EFFECT_BYTES(BaseFireEffect, BaseFireEffect::BufferBytes(NUM_LEDS, 1))),
+    EFFECT_ENTRY_NOPARAMS("DoublePaletteEffect", CreateDoublePalette,                            EFFECT_BYTES(DoublePaletteEffect, PaletteBytes + HDRBytes)),
+    EFFECT_ENTRY("BouncingBallEffect",          CreateBouncingBall,      s_bouncingBallParams,   EFFECT_BYTES(BouncingBallEffect, BouncingBallEffect::BufferBytes(3))),
+    EFFECT_ENTRY("SolidFill",                   CreateSolidFill,         s_solidFillParams,      EFFECT_BYTES(SolidFillEffect, 0))
+};
+
+static_assert(HasUniqueHashes(s_effects), "Two effect names hash the same");
+
+// Binary commands only carry 16 bits of each parameter name, those still have to be unique within an effect
+
+static constexpr bool HasUniqueParamTags()
+{
+    for (const EffectEntry &entry : s_effects)
+        for (size_t i = 0; i < entry.cParams; i++)
+            for (size_t j = i + 1; j < entry.cParams; j++)
+                if (BinaryParamTag(entry.params[i].hash) == BinaryParamTag(entry.params[j].hash))
+                    return false;
     return true;
 }
 
-bool EffectsFactory::CreateStarryNightEffect(StaticJsonDocument<JSON_DOC_SIZE> *doc, LEDStripEffect **poutEffect)
+static_assert(HasUniqueParamTags(), "Two parameters of one effect share a binary tag");
+static constexpr HashIndex<2 * ARRAYSIZE(s_effects)> s_effectIndex(s_effects);
+
+const EffectEntry *EffectsFactory::FindEffect(uint32_t nameHash)
 {
-    if (doc->containsKey("buildIn"))
-    {
-        Println("Trying to create buildIn effect");
-
-        String buildIn = doc->getMember("buildIn");
-
-        if (buildIn == "Rainbow Twinkle Stars")
-            *poutEffect = new StarryNightEffect<QuietStar>("Rainbow Twinkle Stars", RainbowColors_p, STARRYNIGHT_PROBABILITY, 1, LINEARBLEND, 2.0, 0.0, STARRYNIGHT_MUSICFACTOR); // Rainbow Twinkle
-        else if (buildIn == "Green Twinkle")
-            *poutEffect = new StarryNightEffect<QuietStar>("Magenta Twinkle Stars", GreenColors_p, STARRYNIGHT_PROBABILITY, 1, LINEARBLEND, 2.0, 0.0, STARRYNIGHT_MUSICFACTOR); // Green Twinkle
-        else if (buildIn == "Blue Sparkle")
-            *poutEffect = new StarryNightEffect<Star>("Blue Sparkle Stars", BlueColors_p, STARRYNIGHT_PROBABILITY, 1, LINEARBLEND, 2.0, 0.0, STARRYNIGHT_MUSICFACTOR); // Blue Sparkle
-        else if (buildIn == "Red Twinkle")
-            *poutEffect = new StarryNightEffect<QuietStar>("Red Twinkle Stars", MagentaColors_p, 1.0, 1, LINEARBLEND, 2.0); // Red Twinkle
-        else if (buildIn == "Lava Stars")
-            *poutEffect = new StarryNightEffect<Star>("Lava Stars", MagentaColors_p, STARRYNIGHT_PROBABILITY, 1, LINEARBLEND, 2.0, 0.0, STARRYNIGHT_MUSICFACTOR); // Lava Stars
-        else if (buildIn == "Blooming Little Rainbow Stars")
-            *poutEffect = new StarryNightEffect<BubblyStar>("Little Blooming Rainbow Stars", MagentaColors_p, STARRYNIGHT_PROBABILITY, 4, LINEARBLEND, 2.0, 0.0, STARRYNIGHT_MUSICFACTOR); // Blooming Little Rainbow Stars
-        else if (buildIn == "Blooming Rainbow Stars")
-            *poutEffect = new StarryNightEffect<BubblyStar>("Big Blooming Rainbow Stars", MagentaColors_p, 2, 12, LINEARBLEND, 1.0); // Blooming Rainbow Stars
-        else if (buildIn == "Neon Bars")
-            *poutEffect = new StarryNightEffect<BubblyStar>("Neon Bars", MagentaColors_p, 0.5, 64, NOBLEND, 0); // Neon Bars
-        else if (buildIn == "Lava Stars")
-            new StarryNightEffect<HotWhiteStar>("Lava Stars", HeatColors_p, STARRYNIGHT_PROBABILITY, 1, LINEARBLEND, 2.0, 0.0, STARRYNIGHT_MUSICFACTOR); // Lava Stars
-        else if (buildIn == "Little Blooming Rainbow Stars")
-            *poutEffect = new StarryNightEffect<BubblyStar>("Little Blooming Rainbow Stars", BlueColors_p, STARRYNIGHT_PROBABILITY, 4, LINEARBLEND, 2.0, 0.0, STARRYNIGHT_MUSICFACTOR); // Blooming Little Rainbow Stars
-        else if (buildIn == "Green Twinkle Stars")
-            *poutEffect = new StarryNightEffect<QuietStar>("Green Twinkle Stars", GreenColors_p, STARRYNIGHT_PROBABILITY, 1, LINEARBLEND, 2.0, 0.0, STARRYNIGHT_MUSICFACTOR); // Green Twinkle
-
-        if (*poutEffect != NULL)
-            return true;
+    return s_effectIndex.Find(s_effects, nameHash);
+}
+
+const EffectEntry *EffectsFactory::GetEffectEntry(size_t i)
+{
+    return i < ARRAYSIZE(s_effects) ? &s_effects[i] : NULL;
+}
+
+const char *EffectsFactory::GetParamChoice(const EffectEntry &entry, const EffectParam &param, size_t i)
+{
+    if (param.type != ParamType::Name)
+        return NULL;
+
+    switch (param.hash)
+    {
+        case "palette"_h:
+            return GetPaletteEntry(i) ? GetPaletteEntry(i)->name : NULL;
+        case "starType"_h:
+            return i < ARRAYSIZE(s_starTypes) ? s_starTypes[i].name : NULL;
+        case "starEffect"_h:
+            return i < ARRAYSIZE(s_starEffects) ? s_starEffects[i] : NULL;
+        case "buildIn"_h:
+            if (entry.hash == "StarryNightEffect"_h)
+                return i < ARRAYSIZE(s_starPresets) ? s_starPresets[i].name : NULL;
+            if (entry.hash == "PaletterEffect"_h)
+                return i < ARRAYSIZE(s_paletteBuildIns) ? s_paletteBuildIns[i] : NULL;
+            return NULL;
     }
+    return NULL;
+}
 
-    Println("Defaulting to creating a star from constructor");
+static constexpr size_t LargestEffectBytes()
+{
+    size_t cbLargest = 0;
+    for (const EffectEntry &entry : s_effects)
+        if (entry.cbArena > cbLargest)
+            cbLargest = entry.cbArena;
+    return cbLargest;
+}
 
-    String starEffectName = doc->getMember("starEffect") | String("StarryNightEffect");
-    String starTypeName = doc->getMember("starType") | String("BubblyStar");
+size_t EffectsFactory::ArenaSize()
+{
+    return LargestEffectBytes() + EFFECT_ARENA_SLACK;
+}
 
-    String paletteName = doc->getMember("palette");
-    CRGBPalette256 *paletter;
-    if (!this->GetPaletterFromString(paletteName, &paletter))
+bool EffectsFactory::CreateEffect(JsonObjectConst request, EffectArena &arena, LEDStripEffect **poutEffect)
+{
+    const char *effectName = request["name"].as<const char *>();
+    if (effectName == NULL)
+    {
+        Println("ERROR: JSON no 'name' found.");
+        m_strLastError = "Effect name is missing.";
         return false;
+    }
 
-    float probability = doc->getMember("probability") | 1.0;
-    float starSize = doc->getMember("starSize") | 1.0;
-    double maxSpeed = doc->getMember("maxSpeed") | 100.0;
-    double blurFactor = doc->getMember("blurFactor") | 0.0;
+    Print("JSON: name = ");
+    Println(effectName);
 
-    if (starEffectName == "StarryNightEffect")
+    const uint32_t nameHash = NameHash(effectName);
+    if (!FindEffect(nameHash))
     {
-        if (starTypeName == "BubblyStar")
-            *poutEffect = new StarryNightEffect<BubblyStar>("BubblyStar StarryNightEffect", *paletter, probability, starSize, LINEARBLEND, maxSpeed, blurFactor);
-        else if (starTypeName == "FlashStar")
-            *poutEffect = new StarryNightEffect<FlashStar>("FlashStar StarryNightEffect", *paletter, probability, starSize, LINEARBLEND, maxSpeed, blurFactor);
-        else if (starTypeName == "ColorCycleStar")
-            *poutEffect = new StarryNightEffect<ColorCycleStar>("ColorCycleStar StarryNightEffect", *paletter, probability, starSize, LINEARBLEND, maxSpeed, blurFactor);
-        else if (starTypeName == "MultiColorStar")
-            *poutEffect = new StarryNightEffect<MultiColorStar>("MultiColorStar StarryNightEffect", *paletter, probability, starSize, LINEARBLEND, maxSpeed, blurFactor);
-        else if (starTypeName == "ChristmasLightStar")
-            *poutEffect = new StarryNightEffect<ChristmasLightStar>("ChristmasLightStar StarryNightEffect", *paletter, probability, starSize, LINEARBLEND, maxSpeed, blurFactor);
-        else if (starTypeName == "HotWhiteStar")
-            *poutEffect = new StarryNightEffect<HotWhiteStar>("HotWhiteStar StarryNightEffect", *paletter, probability, starSize, LINEARBLEND, maxSpeed, blurFactor);
-        else if (starTypeName == "RandomPaletteColorStar")
-            *poutEffect = new StarryNightEffect<MultiColorStar>("RandomPaletteColorStar StarryNightEffect", *paletter, probability, starSize, LINEARBLEND, maxSpeed, blurFactor);
-        else if (starTypeName == "LongLifeSparkleStar")
-            *poutEffect = new StarryNightEffect<LongLifeSparkleStar>("LongLifeSparkleStar StarryNightEffect", *paletter, probability, starSize, LINEARBLEND, maxSpeed, blurFactor);
-        else if (starTypeName == "QuietStar")
-            *poutEffect = new StarryNightEffect<QuietStar>("QuietStar StarryNightEffect", *paletter, probability, starSize, LINEARBLEND, maxSpeed, blurFactor);
-        else
-        {
-            m_strLastError = "Star type not found";
-            return false;
-        }
+        m_strLastError = "Effect " + String(effectName) + " does not exists.";
+        Println(m_strLastError);
+        return false;
     }
-    else if (starEffectName == "BlurStarEffect")
+
+    JsonEffectParams params(request);
+    return CreateEffect(nameHash, params, arena, poutEffect);
+}
+
+bool EffectsFactory::CreateEffect(uint32_t nameHash, const IEffectParams &params, EffectArena &arena, LEDStripEffect **poutEffect)
+{
+    const EffectEntry *entry = FindEffect(nameHash);
+    if (entry == NULL)
     {
-        if (starTypeName == "BubblyStar")
-            *poutEffect = new BlurStarEffect<BubblyStar>(*paletter, probability, starSize, LINEARBLEND, maxSpeed);
-        else if (starTypeName == "FlashStar")
-            *poutEffect = new BlurStarEffect<FlashStar>(*paletter, probability, starSize, LINEARBLEND, maxSpeed);
-        else if (starTypeName == "ColorCycleStar")
-            *poutEffect = new BlurStarEffect<ColorCycleStar>(*paletter, probability, starSize, LINEARBLEND, maxSpeed);
-        else if (starTypeName == "MultiColorStar")
-            *poutEffect = new BlurStarEffect<MultiColorStar>(*paletter, probability, starSize, LINEARBLEND, maxSpeed);
-        else if (starTypeName == "ChristmasLightStar")
-            *poutEffect = new BlurStarEffect<ChristmasLightStar>(*paletter, probability, starSize, LINEARBLEND, maxSpeed);
-        else if (starTypeName == "HotWhiteStar")
-            *poutEffect = new BlurStarEffect<HotWhiteStar>(*paletter, probability, starSize, LINEARBLEND, maxSpeed);
-        else if (starTypeName == "RandomPaletteColorStar")
-            *poutEffect = new BlurStarEffect<MultiColorStar>(*paletter, probability, starSize, LINEARBLEND, maxSpeed);
-        else if (starTypeName == "LongLifeSparkleStar")
-            *poutEffect = new BlurStarEffect<LongLifeSparkleStar>(*paletter, probability, starSize, LINEARBLEND, maxSpeed);
-        else if (starTypeName == "QuietStar")
-            *poutEffect = new BlurStarEffect<QuietStar>(*paletter, probability, starSize, LINEARBLEND, maxSpeed);
-        else
-        {
-            m_strLastError = "Star type not found";
-            return false;
-        }
+        m_strLastError = "Effect does not exists.";
+        return false;
     }
-    else
+
+    const uint32_t cFailures = arena.Failures();
+    EffectArgs args(params, entry->params, entry->cParams);
+    *poutEffect = entry->create(arena, args, m_strLastError);
+    if (*poutEffect == NULL)
     {
-        m_strLastError = String("Unknow starEffectName: ") + starEffectName;
+        if (arena.Failures() != cFailures)
+            m_strLastError = "Effect does not fit in the effect arena.";
         return false;
     }
 
+    (*poutEffect)->SetArena(&arena);
     return true;
 }
 
-bool EffectsFactory::GetPaletterFromString(String name, CRGBPalette256 **pout)
-{
-    if (name == "RGB")
-        *pout = &RGBColors_p;
-    else if (name == "Blue")
-        *pout = &BlueColors_p;
-    else if (name == "Red")
-        *pout = &RedColors_p;
-    else if (name == "Green")
-        *pout = &GreenColors_p;
-    else if (name == "Magenta")
-        *pout = &MagentaColors_p;
-    else if (name == "spectrum")
-        *pout = &spectrumBasicColors;
-    else if (name == "BG")
-        *pout = &BGColors_p;
-    else if (name == "blueSweep")
-        *pout = &blueSweep;
-    else if (name == "BlueStripes")
-        *pout = &BlueStripes;
-    else if (name == "MagentaStripes")
-        *pout = &MagentaStripes;
-    else if (name == "rainbowPalette")
-        *pout = &rainbowPalette;
-    else
+String EffectsFactory::GetCatalog() const
+{
+    String catalog;
+    for (const EffectEntry &entry : s_effects)
     {
-        m_strLastError = String("Unknow paletter name: ") + name;
-        return false;
+        catalog += entry.name;
+        catalog += "(";
+        for (size_t i = 0; i < entry.cParams; i++)
+        {
+            const EffectParam &param = entry.params[i];
+            if (i > 0)
+                catalog += ", ";
+            catalog += param.name;
+            catalog += "=";
+            if (param.type == ParamType::Name)
+                catalog += param.defName ? param.defName : "";
+            else if (param.type == ParamType::Float)
+                catalog += String(param.defValue);
+            else
+                catalog += String((int)param.defValue);
+        }
+        catalog += ")\n";
     }
 
-    return true;
-}
\ No newline at end of file
+    catalog += "palettes:";
+    for (size_t i = 0; GetPaletteEntry(i) != NULL; i++)
+    {
+        catalog += " ";
+        catalog += GetPaletteEntry(i)->name;
+    }
+    catalog += "\nstars:";
+    for (const StarProfile &entry : s_starTypes)
+    {
+        catalog += " ";
+        catalog += entry.name;
+    }
+    catalog += "\n";
+
+    return catalog;
+}
@@ -6,9 +6,12 @@ volatile float gVURatio = 1.0; // Current VU as a ratio to its recent min and ma
 // std::shared_ptr<LEDMatrixGFX> m_pLedStrip; // Each LED strip gets its own channel
 
 EffectsManager::EffectsManager(uint8_t bChannelNum)
-    : _statusEffect(NULL), _currEffect(NULL), _factory(), _errReporter(NULL), _brightnes(255), _lastErrTime(0), _bChannelNum(bChannelNum), _bEnabled(false)
+    : _statusEffect(NULL), _currEffect(NULL), _prevEffect(NULL), _factory(), _errReporter(NULL), _lastErrTime(0), _bChannelNum(bChannelNum), _bEnabled(false),
+      _lastFrameHash(0), _lastShowTime(0), _keepAliveMs(FRAME_KEEPALIVE_MS), _skippedFrames(0),
+      _targetFPS(DEFAULT_TARGET_FPS), _nextFrameTick(0),
+      _fadeStartTime(0), _bFading(false), _fadeFromBrightness(255), _iFront(0)
 {
-    // m_pLedStrip = std::make_unique<LEDMatrixGFX>(MATRIX_WIDTH, MATRIX_HEIGHT);
+    // m_pLedStrip = std::make_shared<LEDMatrixGFX>();
 
     // effect = new BulgarianFlag();
     // effect = new Marquee(false);
@@ -32,13 +35,19 @@ EffectsManager::~EffectsManager()
     if (_statusEffect != NULL)
         delete _statusEffect;
 
-    if (_currEffect != NULL)
-        delete _currEffect;
+    destroyEffect(_currEffect, _iFront);
+    destroyEffect(_prevEffect, _iFront ^ 1);
 }
 
 void EffectsManager::init(IErrorReporter *errReporter)
 {
-    m_pLedStrip = std::make_unique<LEDMatrixGFX>(MATRIX_WIDTH, MATRIX_HEIGHT);
+    m_pLedStrip = std::make_shared<LEDMatrixGFX>();
+    m_pFrames[0] = std::make_shared<LEDMatrixGFX>();
+    m_pFrames[1] = std::make_shared<LEDMatrixGFX>();
+
+    // Allocated once, up front, so that changing effects never goes to the heap
+    _pArenas[0] = std::make_unique<EffectArena>(EffectsFactory::ArenaSize());
+    _pArenas[1] = std::make_unique<EffectArena>(EffectsFactory::ArenaSize());
 
     if (_bChannelNum == 0)
     {
@@ -53,9 +62,24 @@ void EffectsManager::init(IErrorReporter *errReporter)
 
     FastLED[_bChannelNum].setLeds(m_pLedStrip->GetLEDBuffer(), m_pLedStrip->GetLEDCount());
 
+    // Brightness and color correction are done by our own output stage, FastLED sends the frame as is
+    FastLED[_bChannelNum].setCorrection(UncorrectedColor);
+    FastLED[_bChannelNum].setDither(DISABLE_DITHER);
+
+    _output.SetPowerLimit(CHANNEL_POWER_LIMIT_MW);
+
     _errReporter = errReporter;
     _statusEffect = new StatusEffect();
-    _statusEffect->Init(m_pLedStrip);
+    bindFrontBuffer();
+}
+
+// bindFrontBuffer
+//
+// The status effect always draws into whichever buffer is currently in front
+
+void EffectsManager::bindFrontBuffer()
+{
+    _statusEffect->Init(m_pFrames[_iFront]);
 }
 
 
@@ -66,43 +90,67 @@ void EffectsManager::setEnabled(bool bEnabled)
     {
         FastLED[_bChannelNum].clearLedData();
         FastLED[_bChannelNum].showLeds();
+        _lastShowTime = millis();
+        _lastFrameHash = m_pLedStrip->GetFrameHash(255);
+    }
+    else
+    {
+        // The schedule went stale while the channel was off, so its first frame is due straight away
+        _nextFrameTick = g_AppTime.FrameStartTicks();
     }
 }
 
 
-void EffectsManager::changeEffect(String jsonParams)
+// changeEffect
+//
+// Builds the effect described by an already parsed setEffect request, either JSON or binary.  The caller
+// has already routed the request to this channel.  The new effect is built in the back arena, which means
+// that an outgoing effect still fading out from the last change is dropped first.
+
+void EffectsManager::changeEffect(JsonObjectConst request)
 {
-    int8_t iChannel = -1;
     LEDStripEffect* newEffect = NULL;
-    bool result = _factory.CreateEffect(jsonParams, &iChannel, &newEffect);
+    destroyEffect(_prevEffect, _iFront ^ 1);
+    bool bCreated = _factory.CreateEffect(request, *_pArenas[_iFront ^ 1], &newEffect);
+    startEffect(bCreated, newEffect);
+}
 
-    bool bIgnore = iChannel >= 0 && iChannel != _bChannelNum;
+void EffectsManager::changeEffect(uint32_t effectId, const IEffectParams &params)
+{
+    LEDStripEffect* newEffect = NULL;
+    destroyEffect(_prevEffect, _iFront ^ 1);
+    bool bCreated = _factory.CreateEffect(effectId, params, *_pArenas[_iFront ^ 1], &newEffect);
+    startEffect(bCreated, newEffect);
+}
 
-    if ((!result || !bIgnore) && _currEffect != NULL)
+void EffectsManager::startEffect(bool bCreated, LEDStripEffect* newEffect)
+{
+    if (!bCreated)
     {
-        delete _currEffect;
-        _currEffect = NULL;
+        destroyEffect(newEffect, _iFront ^ 1); // Should not be allocated if we failed, but just in case.
+        setEffectError(_factory.getLastError());
+        return;
     }
 
-    if (!result)
-    {
-        if (newEffect != NULL) // Should not be allocated if we failed, but just in case.
-            delete newEffect;
+    // The current effect becomes the outgoing one and keeps drawing into what is now the back buffer
+    // while the new effect starts in a clean front buffer, which is also the arena it was built in.
 
-        Println("Error: Effect creation failed!");
-
-        _statusEffect->setError(StatusEffect::ERROR::GENERAL);
-        _lastErrTime = millis();
-        _errReporter->ReportError(_factory.getLastError());
+    _prevEffect = _currEffect;
+    _iFront ^= 1;
+    m_pFrames[_iFront]->clearPixels();
+    bindFrontBuffer();
 
+    _currEffect = newEffect;
+    if (!_currEffect->Init(m_pFrames[_iFront]))
+    {
+        setEffectError("Effect does not fit in the effect arena.");
         return;
     }
 
-    if (bIgnore)
-        return;
+    _fadeStartTime = millis();
+    _bFading = true;
+    _fadeFromBrightness = _output.GetEffectBrightness();
 
-    _currEffect = newEffect;
-    _currEffect->Init(m_pLedStrip);
     _errReporter->ReportError(String(""));
     _statusEffect->setError(StatusEffect::ERROR::NONE);
 
@@ -110,31 +158,171 @@ void EffectsManager::changeEffect(String jsonParams)
     Println(_currEffect->FriendlyName());
 }
 
+// destroyEffect
+//
+// Effects live in the arena that goes with the buffer they draw into, so tearing one down is running its
+// destructor and handing that whole arena back
+
+void EffectsManager::destroyEffect(LEDStripEffect*& pEffect, uint8_t iSlot)
+{
+    if (pEffect == NULL)
+        return;
+
+    pEffect->~LEDStripEffect();
+    pEffect = NULL;
+    _pArenas[iSlot]->Reset();
+}
+
+size_t EffectsManager::getArenaHighWater()
+{
+    if (!_pArenas[0])
+        return 0;
+    return std::max(_pArenas[0]->HighWater(), _pArenas[1]->HighWater());
+}
+
+uint32_t EffectsManager::getArenaFailures()
+{
+    if (!_pArenas[0])
+        return 0;
+    return _pArenas[0]->Failures() + _pArenas[1]->Failures();
+}
+
+// setEffectError
+//
+// A setEffect request for this channel could not be carried out, so the channel goes dark and shows the error
+
+void EffectsManager::setEffectError(const String &strError)
+{
+    destroyEffect(_currEffect, _iFront);
+    destroyEffect(_prevEffect, _iFront ^ 1);
+    _bFading = false;
+
+    Println("Error: Effect creation failed!");
+
+    _statusEffect->setError(StatusEffect::ERROR::GENERAL);
+    _lastErrTime = millis();
+    _errReporter->ReportError(strError);
+}
+
 
 
 void EffectsManager::setBrightnes(uint8_t value)
 {
-    _brightnes = value;
+    _output.SetBrightness(value);
 }
 
 
 
+// setTargetFPS
+//
+// How many frames a second the channel draws, effects that prefer fewer get fewer
+
+void EffectsManager::setTargetFPS(uint16_t fps)
+{
+    _targetFPS = std::max<uint16_t>(1, std::min<uint16_t>(fps, MAX_TARGET_FPS));
+}
+
+// frameIntervalTicks
+//
+// Ticks from one frame of the channel to the next, at the channel's rate or the effect's if it wants fewer
+
+uint32_t EffectsManager::frameIntervalTicks()
+{
+    uint16_t fps = _targetFPS;
+    if (_currEffect != NULL && _currEffect->PreferredFPS() != 0 && _currEffect->PreferredFPS() < fps)
+        fps = _currEffect->PreferredFPS();
+    return MICROS_PER_SECOND / fps;
+}
+
 void EffectsManager::loop()
 {
+    // Schedule the next frame one interval after this one was due.  A channel that has fallen more than a frame
+    // behind starts over from now rather than drawing a burst of frames to catch up.
+
+    const uint32_t frameTick = g_AppTime.FrameStartTicks();
+    _nextFrameTick += frameIntervalTicks();
+    if (isFrameDue(frameTick))
+        _nextFrameTick = frameTick + frameIntervalTicks();
+
+    if (_currEffect != NULL)
+        _currEffect->DrawFrame();
+    else
+        _statusEffect->DrawFrame();
+
+    // Errors are shown over the running effect rather than in place of it
+
     if (SYS_LED_CHANNEL == _bChannelNum && StatusEffect::ERROR::NONE != _statusEffect->getError())
     {
-        _statusEffect->Draw();
+        if (_currEffect != NULL)
+            _statusEffect->DrawOverlay();
 
         // Reset the error log
-        if (_lastErrTime + ERROR_SHOW_TIME < millis())
+        if (_statusEffect->getError() == StatusEffect::ERROR::GENERAL && _lastErrTime + ERROR_SHOW_TIME < millis())
             _statusEffect->setError(StatusEffect::ERROR::NONE);
     }
-    else if (_currEffect != NULL)
-        _currEffect->Draw();
-    else
-        _statusEffect->Draw();
 
-    FastLED[_bChannelNum].showLeds(_brightnes);
+    composeFrame();
+
+    // Skip the (interrupts off) transmission when the frame is the same as the last one sent,
+    // but still refresh the strip every so often in case it missed or glitched a frame.
+
+    uint32_t frameHash = m_pLedStrip->GetFrameHash(_output.GetBrightness());
+    unsigned long now = millis();
+    if (frameHash == _lastFrameHash && now - _lastShowTime < _keepAliveMs)
+    {
+        _skippedFrames++;
+        return;
+    }
+
+    _lastFrameHash = frameHash;
+    _lastShowTime = now;
+    FastLED[_bChannelNum].showLeds(255);
+}
+
+// composeFrame
+//
+// Produces the frame to send from the front buffer, blending in the outgoing effect's back buffer
+// while a cross-fade is running, and maps it through the output stage.
+
+void EffectsManager::composeFrame()
+{
+    const LEDMatrixGFX &front = *m_pFrames[_iFront];
+    LEDMatrixGFX &out = *m_pLedStrip;
+
+    unsigned long elapsed = millis() - _fadeStartTime;
+    if (_bFading && elapsed >= (unsigned long)EFFECT_CROSS_FADE_TIME)
+    {
+        _bFading = false;
+        destroyEffect(_prevEffect, _iFront ^ 1);
+    }
+
+    if (!_bFading)
+    {
+        _output.SetEffectBrightness(effectBrightness());
+        _output.Apply(out.GetLEDBuffer(), front.GetLEDBuffer(), LEDMatrixGFX::LEDCount);
+        return;
+    }
+
+    // With no outgoing effect the back buffer simply holds the last frame it drew, which we fade out of
+
+    if (_prevEffect != NULL)
+        _prevEffect->DrawFrame();
+
+    // The effect brightness moves from the outgoing effect's to the incoming one's along with the frame
+
+    uint16_t weight = elapsed * 256 / (unsigned long)EFFECT_CROSS_FADE_TIME;
+    _output.SetEffectBrightness(_fadeFromBrightness + ((int)effectBrightness() - _fadeFromBrightness) * weight / 256);
+    lerpSpan(out.GetLEDBuffer(), m_pFrames[_iFront ^ 1]->GetLEDBuffer(), front.GetLEDBuffer(), LEDMatrixGFX::LEDCount, weight);
+    _output.Apply(out.GetLEDBuffer(), out.GetLEDBuffer(), LEDMatrixGFX::LEDCount);
+}
+
+// effectBrightness
+//
+// What the running effect wants to be shown at, full for the status effect
+
+uint8_t EffectsManager::effectBrightness()
+{
+    return _currEffect != NULL ? _currEffect->OutputBrightness() : 255;
 }
 
 void EffectsManager::onWiFiStatusChanged(bool up)
@@ -0,0 +1,230 @@
+//+--------------------------------------------------------------------------
+//
+// File:        arduino.cpp
+//
+// Description:
+//
+//    Clock, random numbers, Serial and ESP for the native build
+//
+//---------------------------------------------------------------------------
+
+#include <chrono>
+#include <thread>
+
+#include "Arduino.h"
+#include "simulator.h"
+
+HardwareSerial Serial;
+EspClass ESP;
+
+static SimClock g_clock = SimClock::RealTime;
+static uint64_t g_virtualMicros = 0;
+static uint64_t g_idleNanos = 0;
+
+static bool g_bQuiet = false;
+static std::function<void()> g_restartHandler;
+
+// The generator behind random() and RANDOM_REG32, the same xorshift the effects use, started from the time
+// unless the simulator is given a seed
+
+static uint32_t g_randomState = (uint32_t)std::chrono::system_clock::now().time_since_epoch().count() | 1;
+
+static uint32_t NextRandom()
+{
+    uint32_t x = g_randomState;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    g_randomState = x;
+    return x;
+}
+
+uint64_t SimHostNanos()
+{
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// HostStartNanos - When the clock started, first asked for by whichever global constructor reads the time first
+
+static uint64_t HostStartNanos()
+{
+    static const uint64_t start = SimHostNanos();
+    return start;
+}
+
+void SimSetClock(SimClock clock)
+{
+    // Carry on from the current time, so that the clock never goes backwards
+    g_virtualMicros = micros();
+    g_clock = clock;
+}
+
+uint64_t SimIdleNanos()
+{
+    return g_idleNanos;
+}
+
+// Idle - Waits on the host, counting how long for SimIdleNanos
+
+template <typename Wait>
+static void Idle(Wait wait)
+{
+    uint64_t start = SimHostNanos();
+    wait();
+    g_idleNanos += SimHostNanos() - start;
+}
+
+void SimAdvanceMicros(uint32_t us)
+{
+    g_virtualMicros += us;
+}
+
+void SimSetVirtualMicros(uint64_t us)
+{
+    g_virtualMicros = us;
+}
+
+void SimSetSeed(uint32_t seed)
+{
+    g_randomState = seed ? seed : 0x9E3779B9u;
+    random16_set_seed((uint16_t)seed);
+}
+
+void SimSetQuiet(bool bQuiet)
+{
+    g_bQuiet = bQuiet;
+}
+
+void SimSetRestartHandler(std::function<void()> handler)
+{
+    g_restartHandler = handler;
+}
+
+unsigned long micros()
+{
+    if (g_clock == SimClock::Virtual)
+        return (unsigned long)(uint32_t)g_virtualMicros;
+    return (unsigned long)(uint32_t)((SimHostNanos() - HostStartNanos()) / 1000);
+}
+
+unsigned long millis()
+{
+    if (g_clock == SimClock::Virtual)
+        return (unsigned long)(uint32_t)(g_virtualMicros / 1000);
+    return (unsigned long)(uint32_t)((SimHostNanos() - HostStartNanos()) / 1000000);
+}
+
+void delay(unsigned long ms)
+{
+    if (g_clock == SimClock::Virtual)
+        g_virtualMicros += (uint64_t)ms * 1000;
+    else
+        Idle([ms]() { std::this_thread::sleep_for(std::chrono::milliseconds(ms)); });
+}
+
+void delayMicroseconds(unsigned int us)
+{
+    if (g_clock == SimClock::Virtual)
+        g_virtualMicros += us;
+    else
+        Idle([us]() { std::this_thread::sleep_for(std::chrono::microseconds(us)); });
+}
+
+void yield()
+{
+    if (g_clock == SimClock::Virtual)
+        g_virtualMicros += SIM_YIELD_MICROS;
+    else
+        Idle([]() { std::this_thread::yield(); });
+}
+
+long random(long howBig)
+{
+    return howBig > 0 ? (long)(NextRandom() % (uint32_t)howBig) : 0;
+}
+
+long random(long howSmall, long howBig)
+{
+    return howSmall < howBig ? howSmall + random(howBig - howSmall) : howSmall;
+}
+
+void randomSeed(unsigned long seed)
+{
+    if (seed)
+        g_randomState = (uint32_t)seed;
+}
+
+uint32_t SimHardwareRandom()
+{
+    return NextRandom();
+}
+
+// Print
+
+size_t Print::printNumber(unsigned long long n, int base)
+{
+    return print(String(n, (unsigned char)base));
+}
+
+size_t Print::print(long n, int base)
+{
+    return print((long long)n, base);
+}
+
+size_t Print::print(long long n, int base)
+{
+    if (base == DEC)
+        return print(String(n));
+    return printNumber((unsigned long long)n, base);
+}
+
+size_t Print::print(double n, int digits)
+{
+    return print(String(n, (unsigned char)digits));
+}
+
+size_t Print::printf(const char *format, ...)
+{
+    char buffer[256];
+    va_list args;
+    va_start(args, format);
+    int cch = vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    if (cch < 0)
+        return 0;
+    return write((const uint8_t *)buffer, std::min<size_t>(cch, sizeof(buffer) - 1));
+}
+
+size_t HardwareSerial::write(uint8_t c)
+{
+    return write(&c, 1);
+}
+
+size_t HardwareSerial::write(const uint8_t *buffer, size_t size)
+{
+    if (g_bQuiet)
+        return size;
+    return fwrite(buffer, 1, size, stdout);
+}
+
+void HardwareSerial::flush()
+{
+    if (!g_bQuiet)
+        fflush(stdout);
+}
+
+void EspClass::restart()
+{
+    if (g_restartHandler)
+        g_restartHandler();
+
+    fprintf(stderr, "ESP.restart() called, ending the simulation\n");
+    exit(3);
+}
+
+uint32_t EspClass::getCycleCount()
+{
+    // Cycles of the ESP8266's 80MHz clock
+    return (uint32_t)(micros() * 80UL);
+}
@@ -0,0 +1,550 @@
+//+--------------------------------------------------------------------------
+//
+// File:        benchmain.cpp
+//
+// Description:
+//
+//    Entry point of the native benchmark build.  Builds every effect in the
+//    registry through the factory, once at its defaults and once for each
+//    preset and variant it has, draws it for a while on a virtual clock and
+//    reports what each frame cost:
+//
+//      pio run -e bench && .pio/build/bench/program > bench.csv
+//
+//    The strip length is fixed when the station is built, so each length
+//    has its own environment (bench, bench_300, bench_1000) and the rows of
+//    all of them can simply be put together.
+//
+//    Options:
+//
+//      --frames N          Frames measured per variant, 600 by default
+//      --warmup N          Frames drawn first and not measured, 120 by default, so effects fill up
+//      --seed N            Seed every variant starts from, the same frames are drawn on every run
+//      --effect NAME       Only the effects whose name contains NAME
+//      --commands          Time setEffect commands instead of frames, see below
+//      --spans             Time the span renderer instead of frames, see below
+//      --verbose           Keep what the effects write to Serial
+//
+//    Which variants each effect has is up to BuildVariants, see
+//    effectvariants.h.
+//
+//    Output is CSV on stdout, one row per variant:
+//
+//      leds, effect, variant, status       What was measured, status is ok or rejected
+//      ns_mean, ns_p50, ns_p99, ns_max     Host time of DrawFrame
+//      allocs_per_frame                    Heap allocations per measured frame
+//      setup_allocs                        Heap allocations building and initialising the effect
+//      heap_peak_bytes                     Most heap in use over the variant's run, on top of what was in use
+//                                          before it was built, ie: shared palettes
+//      arena_bytes                         How much of the effect arena the effect took
+//
+//    Only the timings change from run to run, the other columns are for
+//    diffing between releases as they are.
+//
+//    With --commands each effect is instead asked for at its defaults by a
+//    JSON setEffect request, the way one arrives over MQTT: parsed once and
+//    handed to the channel it names, or to every channel.  Each is timed
+//    from the payload to the new effect built and initialised, once naming
+//    one channel and once naming all NUM_CHANNELS of them:
+//
+//      leds, effect, channels, status      What was measured, status is ok or rejected
+//      ns_mean, ns_p50, ns_p99, ns_max     Host time of the command
+//      allocs_per_command                  Heap allocations per measured command
+//
+//    With --spans the span renderer is timed on its own, drawing the spans
+//    three effects draw, at their default sizes, across the strip: the
+//    lights of PaletteEffect, the balls of BouncingBallEffect and the stars
+//    of StarryNightEffect.  Each is drawn by the float renderer setPixels
+//    used to be, by today's setPixels, which converts to Q8 once, and by
+//    setPixelsQ8 itself, SPAN_BATCH spans at a time.  The host has an FPU,
+//    which the ESP8266 does not, so there the float renderer falls further
+//    behind than it does here:
+//
+//      leds, effect, span, path            What was drawn, path is float, float_to_q8 or q8
+//      ns_mean, ns_p50, ns_p99, ns_max     Host time of a batch of spans
+//      pixels_per_s                        Span length drawn per second, from ns_mean
+//
+//---------------------------------------------------------------------------
+
+#include <getopt.h>
+
+#include <algorithm>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "Arduino.h"
+#include "globals.h"
+#include "effectsFactory.h"
+#include "effectsManager.h"
+#include "effectvariants.h"
+#include "simulator.h"
+
+// Heap accounting
+//
+// Every operator new and delete in the program comes through here.  Each block carries its size in front of
+// it, so that delete knows how much is given back.
+
+#define ALLOC_HEADER_BYTES 16                   // Keeps the block as aligned as malloc made it
+
+static uint64_t g_cAllocs = 0;
+static size_t   g_cbLive = 0;
+static size_t   g_cbPeak = 0;
+
+void *operator new(size_t cb)
+{
+    uint8_t *p = (uint8_t *)malloc(cb + ALLOC_HEADER_BYTES);
+    if (p == NULL)
+        throw std::bad_alloc();
+
+    *(size_t *)p = cb;
+    g_cAllocs++;
+    g_cbLive += cb;
+    if (g_cbLive > g_cbPeak)
+        g_cbPeak = g_cbLive;
+    return p + ALLOC_HEADER_BYTES;
+}
+
+void operator delete(void *pv) noexcept
+{
+    if (pv == NULL)
+        return;
+
+    uint8_t *p = (uint8_t *)pv - ALLOC_HEADER_BYTES;
+    g_cbLive -= *(size_t *)p;
+    free(p);
+}
+
+void operator delete(void *pv, size_t) noexcept
+{
+    operator delete(pv);
+}
+
+struct BenchOptions
+{
+    uint32_t    frames = 600;
+    uint32_t    warmup = 120;
+    uint32_t    seed = 1;
+    std::string effectFilter;
+    bool        bCommands = false;
+    bool        bSpans = false;
+};
+
+// Spans drawn between two readings of the clock, a single one takes about as long as reading it
+#define SPAN_BATCH 256
+
+// Quoted - A CSV field, names have spaces in them
+
+static std::string Quoted(const std::string &field)
+{
+    std::string quoted = "\"";
+    for (char c : field)
+        quoted += c == '"' ? std::string("\"\"") : std::string(1, c);
+    return quoted + "\"";
+}
+
+// PrintTimings - Mean, p50, p99 and max of the timings, as the CSV has them, sorting them on the way
+
+static void PrintTimings(std::vector<uint64_t> &nanos)
+{
+    uint64_t totalNanos = 0;
+    for (uint64_t ns : nanos)
+        totalNanos += ns;
+    std::sort(nanos.begin(), nanos.end());
+    auto percentile = [&](size_t pct) { return nanos[std::min(nanos.size() - 1, nanos.size() * pct / 100)]; };
+
+    printf("%llu,%llu,%llu,%llu",
+           (unsigned long long)(totalNanos / nanos.size()),
+           (unsigned long long)percentile(50),
+           (unsigned long long)percentile(99),
+           (unsigned long long)nanos.back());
+}
+
+// RunVariant
+//
+// Builds the effect, draws warmup and measured frames one frame interval apart on the virtual clock and prints
+// its row.  The effect is torn down again before returning.
+
+static void RunVariant(const EffectEntry &entry, const EffectVariant &variant, const BenchOptions &options,
+                       VariantRun &run, EffectArena &arena, std::vector<uint64_t> &frameNanos)
+{
+    // The row's own strings are made first, so that only the effect shows up in the heap columns
+    const std::string strEffect = Quoted(entry.name);
+    const std::string strVariant = Quoted(variant.label);
+
+    const size_t cbBaseline = g_cbLive;
+    g_cbPeak = g_cbLive;
+    uint64_t cAllocsStart = g_cAllocs;
+
+    bool bCreated = run.Create(entry, variant, options.seed);
+    const uint64_t cSetupAllocs = g_cAllocs - cAllocsStart;
+
+    printf("%u,%s,%s,", (unsigned)NUM_LEDS, strEffect.c_str(), strVariant.c_str());
+    if (!bCreated)
+    {
+        printf("rejected,,,,,,,,\n");
+        fprintf(stderr, "%s %s: %s\n", entry.name, variant.label.c_str(), run.Error().c_str());
+        return;
+    }
+
+    const size_t cbArena = arena.Used();
+
+    frameNanos.clear();
+    for (uint32_t i = 0; i < options.warmup + options.frames; i++)
+    {
+        if (i == options.warmup)
+            cAllocsStart = g_cAllocs;
+
+        run.NextFrame();
+
+        uint64_t start = SimHostNanos();
+        run.Effect()->DrawFrame();
+        uint64_t elapsed = SimHostNanos() - start;
+
+        if (i >= options.warmup)
+            frameNanos.push_back(elapsed);
+    }
+    const uint64_t cFrameAllocs = g_cAllocs - cAllocsStart;
+
+    run.Destroy();
+
+    printf("ok,");
+    PrintTimings(frameNanos);
+    printf(",%.2f,%llu,%zu,%zu\n",
+           (double)cFrameAllocs / frameNanos.size(),
+           (unsigned long long)cSetupAllocs,
+           g_cbPeak - cbBaseline,
+           cbArena);
+}
+
+// CommandReporter - Keeps what the channels report, the last error tells whether the command was carried out
+
+class CommandReporter : public IErrorReporter
+{
+  public:
+
+    String strLastError;
+
+    virtual void ReportError(String err)
+    {
+        strLastError = err;
+    }
+};
+
+// RouteEffectRequest
+//
+// What CWorkingStation::MQTT_Callback does with a setEffect payload: parses it once, in place, and routes it
+// to the channels it names
+
+static void RouteEffectRequest(const std::vector<EffectsManager *> &channels, char *payload, size_t length)
+{
+    StaticJsonDocument<JSON_DOC_SIZE> doc;
+    if (deserializeJson(doc, payload, length))
+        return;
+
+    JsonObjectConst request = doc.as<JsonObjectConst>();
+    RouteToChannels(channels, request["channel"] | -1, [request](EffectsManager *pChannel) { pChannel->changeEffect(request); });
+}
+
+// RunCommands
+//
+// Times the request for the effect at its defaults, first naming channel 0 and then every channel, and prints
+// a row for each
+
+static void RunCommands(const EffectEntry &entry, const BenchOptions &options, const std::vector<EffectsManager *> &channels,
+                        CommandReporter &reporter, std::vector<uint64_t> &commandNanos)
+{
+    const std::string strEffect = Quoted(entry.name);
+
+    // The names the effect cannot do without, as BuildVariants gives them to its defaults
+    std::string strNames;
+    for (size_t i = 0; i < entry.cParams; i++)
+    {
+        const EffectParam &param = entry.params[i];
+        if (param.type == ParamType::Name && !param.defName && DefaultName(entry, param))
+            strNames += std::string(",\"") + param.name + "\":\"" + DefaultName(entry, param) + "\"";
+    }
+
+    for (size_t cChannels : { (size_t)1, channels.size() })
+    {
+        char request[128], payload[sizeof(request)];
+        const size_t cbRequest = snprintf(request, sizeof(request), "{\"name\":\"%s\"%s%s}", entry.name,
+                                          strNames.c_str(), cChannels == 1 ? ",\"channel\":0" : "");
+
+        printf("%u,%s,%zu,", (unsigned)NUM_LEDS, strEffect.c_str(), cChannels);
+
+        commandNanos.clear();
+        uint64_t cAllocsStart = g_cAllocs;
+        for (uint32_t i = 0; i < options.warmup + options.frames; i++)
+        {
+            if (i == options.warmup)
+                cAllocsStart = g_cAllocs;
+
+            // Parsing in place writes into the payload, so each command gets a fresh copy, as from PubSubClient
+            memcpy(payload, request, cbRequest);
+            reporter.strLastError = "";
+
+            uint64_t start = SimHostNanos();
+            RouteEffectRequest(channels, payload, cbRequest);
+            uint64_t elapsed = SimHostNanos() - start;
+
+            if (!reporter.strLastError.isEmpty())
+                break;
+            if (i >= options.warmup)
+                commandNanos.push_back(elapsed);
+        }
+        const uint64_t cCommandAllocs = g_cAllocs - cAllocsStart;
+
+        if (commandNanos.size() < options.frames)
+        {
+            printf("rejected,,,,,\n");
+            fprintf(stderr, "%s: %s\n", entry.name, reporter.strLastError.c_str());
+            continue;
+        }
+
+        printf("ok,");
+        PrintTimings(commandNanos);
+        printf(",%.2f\n", (double)cCommandAllocs / commandNanos.size());
+    }
+}
+
+// FloatSetPixels
+//
+// LEDMatrixGFX::setPixels as it was before setPixelsQ8, all float, kept to measure the Q8 renderer against
+
+static void FloatSetPixels(CRGB *pLEDs, float fPos, float count, CRGB c, bool bMerge)
+{
+    float frac1 = fPos - floor(fPos);
+    float frac2 = fPos + count - floor(fPos + count);
+
+    uint8_t fade1 = (std::max(frac1, 1.0f - count)) * 255;
+    uint8_t fade2 = (1.0 - frac2) * 255;
+    CRGB c1 = c;
+    CRGB c2 = c;
+    c1 = c1.fadeToBlackBy(fade1);
+    c2 = c2.fadeToBlackBy(fade2);
+
+    float p = fPos;
+    if (p >= 0 && p < NUM_LEDS)
+        pLEDs[(int)p] = bMerge ? pLEDs[(int)p] + c1 : c1;
+    p = fPos + (1.0 - frac1);
+    count -= (1.0 - frac1);
+
+    while (count >= 1)
+    {
+        if (p >= 0 && p < NUM_LEDS)
+            pLEDs[(int)p] = bMerge ? pLEDs[(int)p] + c : c;
+        count--;
+        p++;
+    };
+
+    if (count > 0)
+        if (p >= 0 && p < NUM_LEDS)
+            pLEDs[(int)p] = bMerge ? pLEDs[(int)p] + c2 : c2;
+}
+
+// SpanShape - The spans an effect draws: how long they are at its defaults and whether they add to the strip
+
+struct SpanShape
+{
+    const char *effect;
+    float       count;
+    bool        bMerge;
+};
+
+static const SpanShape s_spanShapes[] =
+{
+    { "PaletteEffect",      1.0f, false },      // lightSize
+    { "BouncingBallEffect", 5.0f, true  },      // ballSize
+    { "StarryNightEffect",  1.0f, true  },      // starSize
+};
+
+enum class SpanPath
+{
+    Float,
+    FloatToQ8,
+    Q8
+};
+
+// RunSpans
+//
+// Times one way of drawing the shape's spans, at positions scattered along the strip with a fraction of a pixel
+// to them, and prints its row
+
+static void RunSpans(const SpanShape &shape, SpanPath path, const BenchOptions &options, LEDMatrixGFX &gfx,
+                     std::vector<uint64_t> &batchNanos)
+{
+    float positions[SPAN_BATCH];
+    int32_t positionsQ8[SPAN_BATCH];
+    uint32_t random = options.seed;
+    for (size_t i = 0; i < SPAN_BATCH; i++)
+    {
+        random = random * 1664525u + 1013904223u;
+        positions[i] = (float)(random >> 8) / (1 << 24) * (NUM_LEDS + shape.count) - shape.count;
+        positionsQ8[i] = LEDMatrixGFX::toQ8(positions[i]);
+    }
+    const int32_t countQ8 = LEDMatrixGFX::toQ8(shape.count);
+    const CRGB color = CRGB(255, 160, 40);
+    CRGB *pLEDs = gfx.GetLEDBuffer();
+
+    batchNanos.clear();
+    for (uint32_t i = 0; i < options.warmup + options.frames; i++)
+    {
+        gfx.clearPixels();
+
+        uint64_t start = SimHostNanos();
+        switch (path)
+        {
+            case SpanPath::Float:
+                for (size_t iSpan = 0; iSpan < SPAN_BATCH; iSpan++)
+                    FloatSetPixels(pLEDs, positions[iSpan], shape.count, color, shape.bMerge);
+                break;
+            case SpanPath::FloatToQ8:
+                for (size_t iSpan = 0; iSpan < SPAN_BATCH; iSpan++)
+                    gfx.setPixels(positions[iSpan], shape.count, color, shape.bMerge);
+                break;
+            case SpanPath::Q8:
+                for (size_t iSpan = 0; iSpan < SPAN_BATCH; iSpan++)
+                    gfx.setPixelsQ8(positionsQ8[iSpan], countQ8, color, shape.bMerge);
+                break;
+        }
+        uint64_t elapsed = SimHostNanos() - start;
+
+        if (i >= options.warmup)
+            batchNanos.push_back(elapsed);
+    }
+
+    static const char *const pathNames[] = { "float", "float_to_q8", "q8" };
+    uint64_t totalNanos = 0;
+    for (uint64_t ns : batchNanos)
+        totalNanos += ns;
+    const double pixelsPerSecond = SPAN_BATCH * shape.count * 1e9 * batchNanos.size() / std::max<uint64_t>(totalNanos, 1);
+
+    printf("%u,%s,%.2f,%s,", (unsigned)NUM_LEDS, Quoted(shape.effect).c_str(), shape.count, pathNames[(int)path]);
+    PrintTimings(batchNanos);
+    printf(",%.0f\n", pixelsPerSecond);
+}
+
+static void Usage(const char *pszProgram)
+{
+    fprintf(stderr, "usage: %s [--frames N] [--warmup N] [--seed N] [--effect NAME] [--commands] [--spans] [--verbose]\n", pszProgram);
+}
+
+int main(int argc, char *argv[])
+{
+    static const option options[] =
+    {
+        { "frames",   required_argument, NULL, 'n' },
+        { "warmup",   required_argument, NULL, 'w' },
+        { "seed",     required_argument, NULL, 'r' },
+        { "effect",   required_argument, NULL, 'e' },
+        { "commands", no_argument,       NULL, 'c' },
+        { "spans",    no_argument,       NULL, 's' },
+        { "verbose",  no_argument,       NULL, 'v' },
+        { "help",     no_argument,       NULL, 'h' },
+        { NULL,       0,                 NULL, 0 }
+    };
+
+    BenchOptions bench;
+    bool bVerbose = false;
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "", options, NULL)) != -1)
+    {
+        switch (opt)
+        {
+            case 'n':
+                bench.frames = (uint32_t)strtoul(optarg, NULL, 10);
+                break;
+            case 'w':
+                bench.warmup = (uint32_t)strtoul(optarg, NULL, 10);
+                break;
+            case 'r':
+                bench.seed = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            case 'e':
+                bench.effectFilter = optarg;
+                break;
+            case 'c':
+                bench.bCommands = true;
+                break;
+            case 's':
+                bench.bSpans = true;
+                break;
+            case 'v':
+                bVerbose = true;
+                break;
+            default:
+                Usage(argv[0]);
+                return opt == 'h' ? 0 : 2;
+        }
+    }
+
+    if (bench.frames == 0)
+    {
+        Usage(argv[0]);
+        return 2;
+    }
+
+    SimSetClock(SimClock::Virtual);
+    SimSetQuiet(!bVerbose);
+
+    if (bench.bSpans)
+    {
+        LEDMatrixGFX gfx;
+        std::vector<uint64_t> batchNanos;
+        batchNanos.reserve(bench.frames);
+
+        printf("leds,effect,span,path,ns_mean,ns_p50,ns_p99,ns_max,pixels_per_s\n");
+
+        for (const SpanShape &shape : s_spanShapes)
+            if (bench.effectFilter.empty() || std::string(shape.effect).find(bench.effectFilter) != std::string::npos)
+                for (SpanPath path : { SpanPath::Float, SpanPath::FloatToQ8, SpanPath::Q8 })
+                    RunSpans(shape, path, bench, gfx, batchNanos);
+        return 0;
+    }
+
+    if (bench.bCommands)
+    {
+        // The channels are set up first, as at boot, so that their buffers and arenas are not counted
+        CommandReporter reporter;
+        std::vector<std::unique_ptr<EffectsManager>> owners;
+        std::vector<EffectsManager *> channels;
+        for (uint8_t i = 0; i < NUM_CHANNELS; i++)
+        {
+            owners.push_back(std::make_unique<EffectsManager>(i));
+            owners.back()->init(&reporter);
+            channels.push_back(owners.back().get());
+        }
+
+        std::vector<uint64_t> commandNanos;
+        commandNanos.reserve(bench.frames);
+
+        printf("leds,effect,channels,status,ns_mean,ns_p50,ns_p99,ns_max,allocs_per_command\n");
+
+        const EffectEntry *entry;
+        for (size_t i = 0; (entry = EffectsFactory::GetEffectEntry(i)) != NULL; i++)
+            if (bench.effectFilter.empty() || std::string(entry->name).find(bench.effectFilter) != std::string::npos)
+                RunCommands(*entry, bench, channels, reporter, commandNanos);
+        return 0;
+    }
+
+    // Allocated once, as a channel does at boot, so neither shows up against any effect
+    EffectArena arena(EffectsFactory::ArenaSize());
+    VariantRun run(arena, std::make_shared<LEDMatrixGFX>());
+    std::vector<uint64_t> frameNanos;
+    frameNanos.reserve(bench.frames);
+
+    printf("leds,effect,variant,status,ns_mean,ns_p50,ns_p99,ns_max,allocs_per_frame,setup_allocs,heap_peak_bytes,arena_bytes\n");
+
+    const EffectEntry *entry;
+    for (size_t i = 0; (entry = EffectsFactory::GetEffectEntry(i)) != NULL; i++)
+    {
+        if (!bench.effectFilter.empty() && std::string(entry->name).find(bench.effectFilter) == std::string::npos)
+            continue;
+
+        for (const EffectVariant &variant : BuildVariants(*entry))
+            RunVariant(*entry, variant, bench, run, arena, frameNanos);
+    }
+    return 0;
+}
@@ -0,0 +1,119 @@
+//+--------------------------------------------------------------------------
+//
+// File:        effectvariants.cpp
+//
+// Description:
+//
+//    Variants of the registry's effects and running them the same way
+//    every time, see effectvariants.h
+//
+//---------------------------------------------------------------------------
+
+#include "effectvariants.h"
+#include "simulator.h"
+
+extern AppTime g_AppTime;
+
+const char *DefaultName(const EffectEntry &entry, const EffectParam &param)
+{
+    if (param.defName || param.hash == "buildIn"_h)
+        return param.defName;
+    return EffectsFactory::GetParamChoice(entry, param, 0);
+}
+
+std::vector<EffectVariant> BuildVariants(const EffectEntry &entry)
+{
+    std::vector<EffectVariant> variants;
+
+    auto addVariant = [&](const std::string &label, const EffectParam *pChanged, const char *pszName, float number)
+    {
+        EffectVariant variant;
+        variant.label = label;
+        for (size_t i = 0; i < entry.cParams; i++)
+        {
+            const EffectParam &param = entry.params[i];
+            if (&param == pChanged)
+            {
+                if (param.type == ParamType::Name)
+                    variant.params.SetName(param, pszName);
+                else
+                    variant.params.SetNumber(param, number);
+            }
+            else if (param.type == ParamType::Name && !param.defName && DefaultName(entry, param))
+            {
+                variant.params.SetName(param, DefaultName(entry, param));
+            }
+        }
+        variants.push_back(std::move(variant));
+    };
+
+    addVariant("", nullptr, nullptr, 0.0f);
+
+    for (size_t i = 0; i < entry.cParams; i++)
+    {
+        const EffectParam &param = entry.params[i];
+        if (param.type == ParamType::Bool)
+        {
+            float flipped = param.defValue != 0.0f ? 0.0f : 1.0f;
+            addVariant(std::string(param.name) + "=" + (flipped != 0.0f ? "true" : "false"), &param, nullptr, flipped);
+        }
+        else if (param.type == ParamType::Name)
+        {
+            const char *pszDefault = DefaultName(entry, param);
+            const char *pszChoice;
+            for (size_t iChoice = 0; (pszChoice = EffectsFactory::GetParamChoice(entry, param, iChoice)) != NULL; iChoice++)
+                if (!pszDefault || NameHash(pszChoice) != NameHash(pszDefault))
+                    addVariant(std::string(param.name) + "=" + pszChoice, &param, pszChoice, 0.0f);
+        }
+    }
+    return variants;
+}
+
+bool VariantRun::Create(const EffectEntry &entry, const IEffectParams &params, uint32_t seed)
+{
+    Destroy();
+
+    // Effects animate from the absolute time as well as from their own state, so every run starts at the
+    // same instant, with AppTime's frame starting there too
+    SimSetVirtualMicros(0);
+    g_AppTime.NewFrame();
+    SimSetSeed(seed);
+    g_EffectSeeds.Seed(seed);
+    _gfx->clearPixels();
+
+    EffectsFactory factory;
+    if (!factory.CreateEffect(entry.hash, params, _arena, &_pEffect))
+    {
+        _strError = factory.getLastError();
+        Destroy();
+        return false;
+    }
+
+    if (!_pEffect->Init(_gfx))
+    {
+        _strError = "Effect does not fit in the effect arena.";
+        Destroy();
+        return false;
+    }
+
+    const uint16_t fps = _pEffect->PreferredFPS() ? std::min<uint16_t>(_pEffect->PreferredFPS(), MAX_TARGET_FPS) : DEFAULT_TARGET_FPS;
+    _frameMicros = MICROS_PER_SECOND / fps;
+    _strError = "";
+    return true;
+}
+
+void VariantRun::NextFrame()
+{
+    SimAdvanceMicros(_frameMicros);
+    g_AppTime.NewFrame();
+}
+
+void VariantRun::Destroy()
+{
+    if (_pEffect)
+    {
+        _pEffect->~LEDStripEffect();
+        _pEffect = NULL;
+    }
+    _arena.Reset();
+}
@@ -0,0 +1,342 @@
+//+--------------------------------------------------------------------------
+//
+// File:        encodingmain.cpp
+//
+// Description:
+//
+//    Entry point of the native encoding check.  Every variant of every
+//    effect in the registry (see effectvariants.h) is written out as a
+//    setEffect request twice, once as the JSON /set/effect takes and once
+//    in the binary form of binaryCommand.h, with every parameter spelled
+//    out.  Each request is decoded the way the station decodes it, and the
+//    check fails unless both give the same effect, the same value for every
+//    parameter and the same frames:
+//
+//      pio run -e encoding && .pio/build/encoding/program
+//
+//    Options:
+//
+//      --frames N          Frames drawn from each encoding, 32 by default
+//      --seed N            Seed both are drawn from, 1 by default
+//      --effect NAME       Only the effects whose name contains NAME
+//      --verbose           Keep what the effects write to Serial
+//
+//    The exit status is 1 if any variant decodes differently.
+//
+//---------------------------------------------------------------------------
+
+#include <getopt.h>
+
+#include <string>
+#include <vector>
+
+#include "Arduino.h"
+#include "globals.h"
+#include "binaryCommand.h"
+#include "effectsFactory.h"
+#include "effectvariants.h"
+#include "simulator.h"
+
+// Channel both requests name, so that the channel is decoded as well
+#define ENCODING_CHANNEL 1
+
+// ParamName
+//
+// The string of a Name parameter whose NameHash the variant holds, as JSON needs it: one of the names the
+// parameter accepts, or its default.  NULL if the variant leaves it out.
+
+static const char *ParamName(const EffectEntry &entry, const EffectParam &param, const IEffectParams &params)
+{
+    uint32_t hash;
+    if (!params.GetName(param, &hash))
+        return param.defName;
+
+    const char *pszChoice;
+    for (size_t i = 0; (pszChoice = EffectsFactory::GetParamChoice(entry, param, i)) != NULL; i++)
+        if (NameHash(pszChoice) == hash)
+            return pszChoice;
+    return param.defName && NameHash(param.defName) == hash ? param.defName : NULL;
+}
+
+// ParamNumber - What the variant sets a number parameter to, its default if it leaves it alone
+static float ParamNumber(const EffectParam &param, const IEffectParams &params)
+{
+    float value;
+    return params.GetNumber(param, &value) ? value : param.defValue;
+}
+
+static void AppendU32(std::vector<uint8_t> &message, uint32_t value)
+{
+    for (int i = 0; i < 4; i++)
+        message.push_back((uint8_t)(value >> (8 * i)));
+}
+
+// Encode
+//
+// The variant as a JSON and as a binary request, each with every parameter of the effect in it
+
+static void Encode(const EffectEntry &entry, const EffectVariant &variant, std::string *pJson, std::vector<uint8_t> *pBinary)
+{
+    std::string &json = *pJson;
+    std::vector<uint8_t> &binary = *pBinary;
+    char buffer[64];
+
+    json = std::string("{\"name\":\"") + entry.name + "\"";
+    snprintf(buffer, sizeof(buffer), ",\"channel\":%d", ENCODING_CHANNEL);
+    json += buffer;
+
+    binary = { BINARY_COMMAND_VERSION, (uint8_t)ENCODING_CHANNEL, 0, 0 };
+    AppendU32(binary, entry.hash);
+
+    uint8_t cParams = 0;
+    for (size_t i = 0; i < entry.cParams; i++)
+    {
+        const EffectParam &param = entry.params[i];
+        BinaryParamType type;
+        uint32_t bits;
+
+        if (param.type == ParamType::Name)
+        {
+            const char *pszName = ParamName(entry, param, variant.params);
+            if (pszName == NULL)
+                continue;
+            snprintf(buffer, sizeof(buffer), ",\"%s\":\"%s\"", param.name, pszName);
+            type = BinaryParamType::Name;
+            bits = NameHash(pszName);
+        }
+        else
+        {
+            const float value = ParamNumber(param, variant.params);
+            if (param.type == ParamType::Bool)
+            {
+                snprintf(buffer, sizeof(buffer), ",\"%s\":%s", param.name, value != 0.0f ? "true" : "false");
+                type = BinaryParamType::Bool;
+                bits = value != 0.0f;
+            }
+            else if (param.type == ParamType::Int)
+            {
+                snprintf(buffer, sizeof(buffer), ",\"%s\":%d", param.name, (int)value);
+                type = BinaryParamType::Int;
+                bits = (uint32_t)(int32_t)value;
+            }
+            else
+            {
+                // 9 significant digits bring every float back exactly
+                snprintf(buffer, sizeof(buffer), ",\"%s\":%.9g", param.name, value);
+                type = BinaryParamType::Float;
+                memcpy(&bits, &value, sizeof(bits));
+            }
+        }
+        json += buffer;
+
+        binary.push_back((uint8_t)BinaryParamTag(param.hash));
+        binary.push_back((uint8_t)(BinaryParamTag(param.hash) >> 8));
+        binary.push_back((uint8_t)type);
+        if (type == BinaryParamType::Bool)
+        {
+            binary.push_back(1);
+            binary.push_back((uint8_t)bits);
+        }
+        else
+        {
+            binary.push_back(4);
+            AppendU32(binary, bits);
+        }
+        cParams++;
+    }
+
+    json += "}";
+    binary[2] = cParams;
+}
+
+// CompareParams
+//
+// Empty if the effect's thunk would be handed the same value of every parameter from both requests
+
+static std::string CompareParams(const EffectEntry &entry, const IEffectParams &json, const IEffectParams &binary)
+{
+    EffectArgs jsonArgs(json, entry.params, entry.cParams);
+    EffectArgs binaryArgs(binary, entry.params, entry.cParams);
+
+    for (size_t i = 0; i < entry.cParams; i++)
+    {
+        const EffectParam &param = entry.params[i];
+        char buffer[128];
+
+        if (param.type == ParamType::Name)
+        {
+            const uint32_t hashJson = jsonArgs.Name(param.hash);
+            const uint32_t hashBinary = binaryArgs.Name(param.hash);
+            if (hashJson != hashBinary)
+            {
+                snprintf(buffer, sizeof(buffer), "%s is %08x from JSON, %08x from binary", param.name, hashJson, hashBinary);
+                return buffer;
+            }
+        }
+        else
+        {
+            const float valueJson = jsonArgs.Float(param.hash);
+            const float valueBinary = binaryArgs.Float(param.hash);
+            if (memcmp(&valueJson, &valueBinary, sizeof(float)) != 0)
+            {
+                snprintf(buffer, sizeof(buffer), "%s is %.9g from JSON, %.9g from binary", param.name, valueJson, valueBinary);
+                return buffer;
+            }
+        }
+    }
+    return std::string();
+}
+
+// Draw - The first frames the effect built from the parameters draws, false if the factory would not build it
+static bool Draw(VariantRun &run, const EffectEntry &entry, const IEffectParams &params, uint32_t cFrames, uint32_t seed, std::vector<CRGB> *pFrames)
+{
+    pFrames->clear();
+    if (!run.Create(entry, params, seed))
+        return false;
+
+    for (uint32_t i = 0; i < cFrames; i++)
+    {
+        run.NextFrame();
+        run.Effect()->DrawFrame();
+        pFrames->insert(pFrames->end(), run.GetLEDBuffer(), run.GetLEDBuffer() + NUM_LEDS);
+    }
+    run.Destroy();
+    return true;
+}
+
+// CheckVariant
+//
+// Empty if both encodings of the variant decode to the same effect, otherwise how they differ.  A variant
+// the factory turns down must be turned down from both.
+
+static std::string CheckVariant(VariantRun &run, const EffectEntry &entry, const EffectVariant &variant, uint32_t cFrames, uint32_t seed)
+{
+    std::string json;
+    std::vector<uint8_t> binary;
+    Encode(entry, variant, &json, &binary);
+
+    // As the station decodes them, see CWorkingStation::MQTT_Callback
+
+    StaticJsonDocument<JSON_DOC_SIZE> doc;
+    DeserializationError error = deserializeJson(doc, &json[0], json.size());
+    if (error)
+        return std::string("deserializeJson() failed: ") + error.c_str();
+
+    BinaryEffectParams command;
+    String strError;
+    if (!command.Parse(binary.data(), binary.size(), strError))
+        return std::string("binary command rejected: ") + strError.c_str();
+
+    JsonObjectConst request = doc.as<JsonObjectConst>();
+    const char *pszName = request["name"].as<const char *>();
+    if (pszName == NULL || NameHash(pszName) != command.EffectId() || command.EffectId() != entry.hash)
+        return "the requests name different effects";
+    if ((request["channel"] | -1) != command.Channel())
+        return "the requests name different channels";
+
+    JsonEffectParams params(request);
+    std::string strDiff = CompareParams(entry, params, command);
+    if (!strDiff.empty())
+        return strDiff;
+
+    std::vector<CRGB> framesJson, framesBinary;
+    const bool bJson = Draw(run, entry, params, cFrames, seed, &framesJson);
+    const String strJsonError = run.Error();
+    const bool bBinary = Draw(run, entry, command, cFrames, seed, &framesBinary);
+
+    if (bJson != bBinary)
+        return std::string("built from ") + (bJson ? "JSON" : "binary") + " only: " + (bJson ? run.Error() : strJsonError).c_str();
+
+    for (size_t i = 0; i < framesJson.size(); i++)
+    {
+        if (framesJson[i] != framesBinary[i])
+        {
+            char buffer[128];
+            snprintf(buffer, sizeof(buffer), "frame %zu differs at LED %zu: %u,%u,%u from JSON, %u,%u,%u from binary",
+                     i / NUM_LEDS + 1, i % NUM_LEDS, framesJson[i].r, framesJson[i].g, framesJson[i].b,
+                     framesBinary[i].r, framesBinary[i].g, framesBinary[i].b);
+            return buffer;
+        }
+    }
+    return std::string();
+}
+
+static void Usage(const char *pszProgram)
+{
+    fprintf(stderr, "usage: %s [--frames N] [--seed N] [--effect NAME] [--verbose]\n", pszProgram);
+}
+
+int main(int argc, char *argv[])
+{
+    static const option options[] =
+    {
+        { "frames",  required_argument, NULL, 'n' },
+        { "seed",    required_argument, NULL, 'r' },
+        { "effect",  required_argument, NULL, 'e' },
+        { "verbose", no_argument,       NULL, 'v' },
+        { "help",    no_argument,       NULL, 'h' },
+        { NULL,      0,                 NULL, 0 }
+    };
+
+    std::string effectFilter;
+    uint32_t cFrames = 32;
+    uint32_t seed = 1;
+    bool bVerbose = false;
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "", options, NULL)) != -1)
+    {
+        switch (opt)
+        {
+            case 'n':
+                cFrames = (uint32_t)strtoul(optarg, NULL, 10);
+                break;
+            case 'r':
+                seed = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            case 'e':
+                effectFilter = optarg;
+                break;
+            case 'v':
+                bVerbose = true;
+                break;
+            default:
+                Usage(argv[0]);
+                return opt == 'h' ? 0 : 2;
+        }
+    }
+
+    SimSetClock(SimClock::Virtual);
+    SimSetQuiet(!bVerbose);
+
+    EffectArena arena(EffectsFactory::ArenaSize());
+    VariantRun run(arena, std::make_shared<LEDMatrixGFX>());
+
+    uint32_t cPassed = 0, cFailed = 0;
+
+    const EffectEntry *entry;
+    for (size_t i = 0; (entry = EffectsFactory::GetEffectEntry(i)) != NULL; i++)
+    {
+        if (!effectFilter.empty() && std::string(entry->name).find(effectFilter) == std::string::npos)
+            continue;
+
+        for (const EffectVariant &variant : BuildVariants(*entry))
+        {
+            const char *pszLabel = variant.label.empty() ? "defaults" : variant.label.c_str();
+            std::string strDiff = CheckVariant(run, *entry, variant, cFrames, seed);
+            if (strDiff.empty())
+            {
+                printf("ok    %s %s\n", entry->name, pszLabel);
+                cPassed++;
+            }
+            else
+            {
+                printf("FAIL  %s %s: %s\n", entry->name, pszLabel, strDiff.c_str());
+                cFailed++;
+            }
+        }
+    }
+
+    printf("%u variants decode the same from both encodings, %u differ\n", cPassed, cFailed);
+    return cFailed ? 1 : 0;
+}
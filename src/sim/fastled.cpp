@@ -0,0 +1,269 @@
+//+--------------------------------------------------------------------------
+//
+// File:        fastled.cpp
+//
+// Description:
+//
+//    FastLED's color math, palettes and controllers for the native build
+//
+//---------------------------------------------------------------------------
+
+#include <vector>
+
+#include "FastLED.h"
+#include "simulator.h"
+
+CFastLED FastLED;
+
+static SimFrameSink g_frameSink;
+static uint16_t g_rand16seed = 1337;
+
+void SimSetFrameSink(SimFrameSink sink)
+{
+    g_frameSink = sink;
+}
+
+// Random numbers, FastLED's 16-bit linear congruential generator
+
+uint16_t random16()
+{
+    g_rand16seed = (uint16_t)(g_rand16seed * 2053 + 13849);
+    return g_rand16seed;
+}
+
+uint16_t random16(uint16_t lim)
+{
+    return (uint16_t)(((uint32_t)random16() * lim) >> 16);
+}
+
+uint8_t random8()
+{
+    uint16_t r = random16();
+    return (uint8_t)((r & 0xFF) + (r >> 8));
+}
+
+uint8_t random8(uint8_t lim)
+{
+    return (uint8_t)((random8() * lim) >> 8);
+}
+
+void random16_set_seed(uint16_t seed)
+{
+    g_rand16seed = seed;
+}
+
+void random16_add_entropy(uint16_t entropy)
+{
+    g_rand16seed += entropy;
+}
+
+// hsv2rgb_rainbow
+//
+// FastLED's "rainbow" hue mapping: eight sections of 32 hues each, with yellow given as much of the wheel as
+// the other primaries and secondaries.
+
+void hsv2rgb_rainbow(const CHSV &hsv, CRGB &rgb)
+{
+    const uint8_t hue = hsv.hue;
+    const uint8_t offset8 = (uint8_t)((hue & 0x1F) << 3);
+    const uint8_t third = scale8(offset8, 256 / 3);
+    const uint8_t twothirds = scale8(offset8, (256 * 2) / 3);
+
+    uint8_t r, g, b;
+    switch (hue >> 5)
+    {
+        case 0:  r = 255 - third;     g = third;           b = 0;               break;    // Red to orange
+        case 1:  r = 171;             g = 85 + third;      b = 0;               break;    // Orange to yellow
+        case 2:  r = 171 - twothirds; g = 170 + third;     b = 0;               break;    // Yellow to green
+        case 3:  r = 0;               g = 255 - third;     b = third;           break;    // Green to aqua
+        case 4:  r = 0;               g = 171 - twothirds; b = 85 + twothirds;  break;    // Aqua to blue
+        case 5:  r = third;           g = 0;               b = 255 - third;     break;    // Blue to purple
+        case 6:  r = 85 + third;      g = 0;               b = 171 - third;     break;    // Purple to pink
+        default: r = 170 + third;     g = 0;               b = 85 - third;      break;    // Pink to red
+    }
+
+    if (hsv.sat != 255)
+    {
+        if (hsv.sat == 0)
+        {
+            r = g = b = 255;
+        }
+        else
+        {
+            uint8_t desat = 255 - hsv.sat;
+            desat = scale8(desat, desat);
+            const uint8_t satscale = 255 - desat;
+            r = scale8(r, satscale) + desat;
+            g = scale8(g, satscale) + desat;
+            b = scale8(b, satscale) + desat;
+        }
+    }
+
+    if (hsv.val != 255)
+    {
+        const uint8_t val = scale8_video(hsv.val, hsv.val);
+        r = scale8_video(r, val);
+        g = scale8_video(g, val);
+        b = scale8_video(b, val);
+    }
+
+    rgb.r = r;
+    rgb.g = g;
+    rgb.b = b;
+}
+
+CRGB &nblend(CRGB &existing, const CRGB &overlay, fract8 amountOfOverlay)
+{
+    if (amountOfOverlay == 255)
+        existing = overlay;
+    else if (amountOfOverlay != 0)
+        existing = blend(existing, overlay, amountOfOverlay);
+    return existing;
+}
+
+void fill_solid(CRGB *leds, int numToFill, const CRGB &color)
+{
+    for (int i = 0; i < numToFill; i++)
+        leds[i] = color;
+}
+
+void fill_rainbow(CRGB *leds, int numToFill, uint8_t initialhue, uint8_t deltahue)
+{
+    CHSV hsv(initialhue, 240, 255);
+    for (int i = 0; i < numToFill; i++)
+    {
+        leds[i] = hsv;
+        hsv.hue += deltahue;
+    }
+}
+
+void nscale8(CRGB *leds, uint16_t numLeds, uint8_t scale)
+{
+    for (uint16_t i = 0; i < numLeds; i++)
+        leds[i].nscale8(scale);
+}
+
+void fadeToBlackBy(CRGB *leds, uint16_t numLeds, uint8_t fadeBy)
+{
+    nscale8(leds, numLeds, 255 - fadeBy);
+}
+
+// blur1d - Each pixel keeps 1 - blurAmount of its light and gives half of the rest to each neighbor
+
+void blur1d(CRGB *leds, uint16_t numLeds, fract8 blurAmount)
+{
+    const uint8_t keep = 255 - blurAmount;
+    const uint8_t seep = blurAmount >> 1;
+    CRGB carryover = CRGB::Black;
+    for (uint16_t i = 0; i < numLeds; i++)
+    {
+        CRGB cur = leds[i];
+        CRGB part = cur;
+        part.nscale8(seep);
+        cur.nscale8(keep);
+        cur += carryover;
+        if (i)
+            leds[i - 1] += part;
+        leds[i] = cur;
+        carryover = part;
+    }
+}
+
+// Palettes
+
+void FillGradient(CRGB *entries, int count, TProgmemRGBGradientPalette_bytes gradient)
+{
+    // Each quad is an anchor: position 0-255, then r, g, b.  Entries between two anchors are blended.
+    const uint8_t *pLower = gradient;
+    const uint8_t *pUpper = gradient;
+    for (int i = 0; i < count; i++)
+    {
+        const int position = count == 1 ? 0 : (i * 255) / (count - 1);
+        while (pUpper[0] < position && pUpper[0] != 255)
+        {
+            pLower = pUpper;
+            pUpper += 4;
+        }
+
+        const CRGB lower(pLower[1], pLower[2], pLower[3]);
+        const CRGB upper(pUpper[1], pUpper[2], pUpper[3]);
+        const int span = pUpper[0] - pLower[0];
+        entries[i] = span > 0 ? blend(lower, upper, (fract8)(((position - pLower[0]) * 255) / span)) : upper;
+    }
+}
+
+CRGB ColorFromPalette(const CRGBPalette16 &pal, uint8_t index, uint8_t brightness, TBlendType blendType)
+{
+    const uint8_t hi4 = index >> 4;
+    const uint8_t lo4 = index & 0x0F;
+
+    CRGB color = pal[hi4];
+    if (blendType != NOBLEND && lo4)
+        color = blend(color, pal[(hi4 + 1) & 0x0F], (fract8)(lo4 << 4));
+
+    if (brightness != 255)
+        color.nscale8_video(brightness);
+    return color;
+}
+
+CRGB ColorFromPalette(const CRGBPalette256 &pal, uint8_t index, uint8_t brightness, TBlendType)
+{
+    CRGB color = pal[index];
+    if (brightness != 255)
+        color.nscale8_video(brightness);
+    return color;
+}
+
+extern const TProgmemRGBPalette16 RainbowColors_p FL_PROGMEM =
+{
+    0xFF0000, 0xD52A00, 0xAB5500, 0xAB7F00,
+    0xABAB00, 0x56D500, 0x00FF00, 0x00D52A,
+    0x00AB55, 0x0056AA, 0x0000FF, 0x2A00D5,
+    0x5500AB, 0x7F0081, 0xAB0055, 0xD5002B
+};
+
+extern const TProgmemRGBPalette16 RainbowStripeColors_p FL_PROGMEM =
+{
+    0xFF0000, 0x000000, 0xAB5500, 0x000000,
+    0xABAB00, 0x000000, 0x00FF00, 0x000000,
+    0x00AB55, 0x000000, 0x0000FF, 0x000000,
+    0x5500AB, 0x000000, 0xAB0055, 0x000000
+};
+
+extern const TProgmemRGBPalette16 HeatColors_p FL_PROGMEM =
+{
+    0x000000, 0x330000, 0x660000, 0x990000,
+    0xCC0000, 0xFF0000, 0xFF3300, 0xFF6600,
+    0xFF9900, 0xFFCC00, 0xFFFF00, 0xFFFF33,
+    0xFFFF66, 0xFFFF99, 0xFFFFCC, 0xFFFFFF
+};
+
+// Controllers
+
+CLEDController &CFastLED::AddController(CRGB *leds, int nLeds)
+{
+    if (_nControllers == FASTLED_MAX_CONTROLLERS)
+        return _controllers[FASTLED_MAX_CONTROLLERS - 1];
+
+    CLEDController &controller = _controllers[_nControllers];
+    controller.Attach(_nControllers, leds, nLeds);
+    _nControllers++;
+    return controller;
+}
+
+void CLEDController::showLeds(uint8_t brightness)
+{
+    if (!g_frameSink || !_leds)
+        return;
+
+    if (brightness == 255)
+    {
+        g_frameSink(_index, _leds, _nLeds);
+        return;
+    }
+
+    std::vector<CRGB> frame(_nLeds);
+    for (int i = 0; i < _nLeds; i++)
+        frame[i] = CRGB(_leds[i]).nscale8(brightness);
+    g_frameSink(_index, frame.data(), _nLeds);
+}
@@ -0,0 +1,100 @@
+//+--------------------------------------------------------------------------
+//
+// File:        filesystem.cpp
+//
+// Description:
+//
+//    LittleFS for the native build, kept in a directory on the host
+//
+//---------------------------------------------------------------------------
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "FS.h"
+#include "LITTLEFS.h"
+#include "simulator.h"
+
+FS LittleFS;
+
+static std::string g_fsRoot = "data";
+
+void SimSetFileSystemRoot(const char *pszDirectory)
+{
+    g_fsRoot = pszDirectory ? pszDirectory : "";
+}
+
+size_t File::size() const
+{
+    if (!_file)
+        return 0;
+
+    struct stat st;
+    if (fstat(fileno(_file.get()), &st) != 0)
+        return 0;
+    return (size_t)st.st_size;
+}
+
+size_t File::position() const
+{
+    if (!_file)
+        return 0;
+
+    long pos = ftell(_file.get());
+    return pos < 0 ? 0 : (size_t)pos;
+}
+
+bool File::seek(uint32_t pos)
+{
+    return _file && fseek(_file.get(), (long)pos, SEEK_SET) == 0;
+}
+
+String File::readString()
+{
+    std::string contents;
+    char buffer[256];
+    size_t cb;
+    while ((cb = read((uint8_t *)buffer, sizeof(buffer))) > 0)
+        contents.append(buffer, cb);
+    return String(contents);
+}
+
+std::string FS::Resolve(const char *path) const
+{
+    std::string resolved = g_fsRoot;
+    if (!path || path[0] != '/')
+        resolved += '/';
+    return resolved + (path ? path : "");
+}
+
+bool FS::begin()
+{
+    struct stat st;
+    return stat(g_fsRoot.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+File FS::open(const char *path, const char *mode)
+{
+    // The device's modes are fopen's, plus binary so the host does not translate line ends
+    std::string hostMode = mode ? mode : "r";
+    if (hostMode.find('b') == std::string::npos)
+        hostMode += 'b';
+
+    FILE *file = fopen(Resolve(path).c_str(), hostMode.c_str());
+    return file ? File(file) : File();
+}
+
+bool FS::exists(const char *path)
+{
+    return access(Resolve(path).c_str(), F_OK) == 0;
+}
+
+bool FS::remove(const char *path)
+{
+    return ::remove(Resolve(path).c_str()) == 0;
+}
+
+bool FS::mkdir(const char *path)
+{
+    return ::mkdir(Resolve(path).c_str(), 0755) == 0;
+}
@@ -0,0 +1,355 @@
+//+--------------------------------------------------------------------------
+//
+// File:        goldenmain.cpp
+//
+// Description:
+//
+//    Entry point of the native golden frame check.  Draws every variant of
+//    every effect in the registry (see effectvariants.h) on the virtual
+//    clock from a fixed seed and compares the frames with the ones stored
+//    in test/golden, so that a rewrite meant to make an effect faster can
+//    show it still draws the same thing:
+//
+//      pio run -e golden && .pio/build/golden/program
+//
+//    After a change that is meant to alter what effects draw, record them
+//    again with --record and commit the new frames along with the change.
+//
+//    Options:
+//
+//      --dir DIR           Where the golden frames are, test/golden by default
+//      --record            Write the golden frames instead of checking against them
+//      --frames N          Frames drawn per variant when recording, 120 by default
+//      --every N           Of those, every Nth is kept, 8 by default
+//      --seed N            Seed the frames are drawn from when recording, 1 by default
+//      --tolerance N       How far a color component may be from the golden one, 2 by default
+//      --effect NAME       Only the effects whose name contains NAME
+//      --verbose           Keep what the effects write to Serial
+//
+//    Each variant's frames are a PPM, one row per kept frame, so they can
+//    be looked at: DIR/<effect>/<variant>.ppm, the defaults being
+//    "defaults".  How they were drawn is in a comment in the PPM header and
+//    a check draws them the same way.  The exit status is 1 if any variant
+//    differs or has no golden frames.
+//
+//---------------------------------------------------------------------------
+
+#include <ctype.h>
+#include <errno.h>
+#include <getopt.h>
+#include <sys/stat.h>
+
+#include <string>
+#include <vector>
+
+#include "Arduino.h"
+#include "globals.h"
+#include "effectsFactory.h"
+#include "effectvariants.h"
+#include "simulator.h"
+
+struct GoldenSettings
+{
+    uint32_t frames = 120;
+    uint32_t every = 8;
+    uint32_t seed = 1;
+};
+
+// GoldenFrames
+//
+// One variant's kept frames, NUM_LEDS pixels a row, and how they were drawn
+
+struct GoldenFrames
+{
+    GoldenSettings    settings;
+    uint32_t          width = 0;
+    uint32_t          rows = 0;
+    std::vector<CRGB> pixels;
+};
+
+static std::string FileName(const std::string &label)
+{
+    if (label.empty())
+        return "defaults";
+
+    std::string name = label;
+    for (char &c : name)
+        if (!isalnum((unsigned char)c) && c != '-')
+            c = '_';
+    return name;
+}
+
+// MakeDirectories - mkdir -p
+static bool MakeDirectories(const std::string &path)
+{
+    for (size_t slash = path.find('/', 1); ; slash = path.find('/', slash + 1))
+    {
+        std::string prefix = path.substr(0, slash);
+        if (mkdir(prefix.c_str(), 0755) != 0 && errno != EEXIST)
+            return false;
+        if (slash == std::string::npos)
+            return true;
+    }
+}
+
+static bool WriteGolden(const std::string &path, const GoldenFrames &golden)
+{
+    FILE *file = fopen(path.c_str(), "wb");
+    if (!file)
+        return false;
+
+    fprintf(file, "P6\n# golden frames=%u every=%u seed=%u\n%u %u\n255\n",
+            golden.settings.frames, golden.settings.every, golden.settings.seed, golden.width, golden.rows);
+    for (const CRGB &pixel : golden.pixels)
+        fwrite(pixel.raw, 1, 3, file);
+    return fclose(file) == 0;
+}
+
+// ReadGolden
+//
+// Reads what WriteGolden wrote, false if the file is not there or not one of ours
+
+static bool ReadGolden(const std::string &path, GoldenFrames *pGolden)
+{
+    FILE *file = fopen(path.c_str(), "rb");
+    if (!file)
+        return false;
+
+    GoldenFrames &golden = *pGolden;
+    bool bRead = fscanf(file, "P6 # golden frames=%u every=%u seed=%u %u %u 255",
+                        &golden.settings.frames, &golden.settings.every, &golden.settings.seed, &golden.width, &golden.rows) == 5
+              && fgetc(file) == '\n'
+              && golden.settings.every > 0;
+
+    if (bRead)
+    {
+        golden.pixels.resize((size_t)golden.width * golden.rows);
+        for (CRGB &pixel : golden.pixels)
+            bRead = bRead && fread(pixel.raw, 1, 3, file) == 3;
+    }
+    fclose(file);
+    return bRead;
+}
+
+// Draw
+//
+// Draws the variant as the settings say, keeping every Nth frame.  False if the factory would not build it.
+
+static bool Draw(VariantRun &run, const EffectEntry &entry, const EffectVariant &variant, GoldenFrames *pFrames)
+{
+    GoldenFrames &frames = *pFrames;
+    if (!run.Create(entry, variant, frames.settings.seed))
+        return false;
+
+    frames.width = NUM_LEDS;
+    frames.rows = 0;
+    frames.pixels.clear();
+    for (uint32_t i = 1; i <= frames.settings.frames; i++)
+    {
+        run.NextFrame();
+        run.Effect()->DrawFrame();
+
+        if (i % frames.settings.every == 0)
+        {
+            frames.pixels.insert(frames.pixels.end(), run.GetLEDBuffer(), run.GetLEDBuffer() + NUM_LEDS);
+            frames.rows++;
+        }
+    }
+    run.Destroy();
+    return true;
+}
+
+// Compare
+//
+// Empty if every color component is within the tolerance, otherwise what differs and where it first does
+
+static std::string Compare(const GoldenFrames &golden, const GoldenFrames &drawn, int tolerance)
+{
+    char buffer[160];
+    if (golden.width != drawn.width)
+    {
+        snprintf(buffer, sizeof(buffer), "recorded for %u LEDs, the strip has %u", golden.width, drawn.width);
+        return buffer;
+    }
+
+    size_t cOff = 0, iFirst = 0;
+    int maxDelta = 0;
+    for (size_t i = 0; i < golden.pixels.size() && i < drawn.pixels.size(); i++)
+    {
+        int delta = 0;
+        for (int c = 0; c < 3; c++)
+            delta = std::max(delta, abs((int)golden.pixels[i].raw[c] - (int)drawn.pixels[i].raw[c]));
+
+        if (delta > tolerance)
+        {
+            if (cOff++ == 0)
+                iFirst = i;
+            maxDelta = std::max(maxDelta, delta);
+        }
+    }
+
+    if (cOff == 0 && golden.pixels.size() == drawn.pixels.size())
+        return std::string();
+
+    if (cOff == 0)
+    {
+        snprintf(buffer, sizeof(buffer), "drew %u frames, golden has %u", drawn.rows, golden.rows);
+        return buffer;
+    }
+
+    const CRGB &want = golden.pixels[iFirst];
+    const CRGB &got = drawn.pixels[iFirst];
+    snprintf(buffer, sizeof(buffer), "%zu pixels off by up to %d, first in frame %zu at LED %zu: %u,%u,%u should be %u,%u,%u",
+             cOff, maxDelta, (iFirst / golden.width + 1) * golden.settings.every, iFirst % golden.width,
+             got.r, got.g, got.b, want.r, want.g, want.b);
+    return buffer;
+}
+
+static void Usage(const char *pszProgram)
+{
+    fprintf(stderr,
+            "usage: %s [--dir DIR] [--record] [--frames N] [--every N] [--seed N]\n"
+            "          [--tolerance N] [--effect NAME] [--verbose]\n",
+            pszProgram);
+}
+
+int main(int argc, char *argv[])
+{
+    static const option options[] =
+    {
+        { "dir",       required_argument, NULL, 'd' },
+        { "record",    no_argument,       NULL, 'R' },
+        { "frames",    required_argument, NULL, 'n' },
+        { "every",     required_argument, NULL, 'k' },
+        { "seed",      required_argument, NULL, 'r' },
+        { "tolerance", required_argument, NULL, 't' },
+        { "effect",    required_argument, NULL, 'e' },
+        { "verbose",   no_argument,       NULL, 'v' },
+        { "help",      no_argument,       NULL, 'h' },
+        { NULL,        0,                 NULL, 0 }
+    };
+
+    std::string directory = "test/golden";
+    std::string effectFilter;
+    GoldenSettings recordSettings;
+    bool bRecord = false;
+    bool bVerbose = false;
+    int tolerance = 2;
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "", options, NULL)) != -1)
+    {
+        switch (opt)
+        {
+            case 'd':
+                directory = optarg;
+                break;
+            case 'R':
+                bRecord = true;
+                break;
+            case 'n':
+                recordSettings.frames = (uint32_t)strtoul(optarg, NULL, 10);
+                break;
+            case 'k':
+                recordSettings.every = (uint32_t)strtoul(optarg, NULL, 10);
+                break;
+            case 'r':
+                recordSettings.seed = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            case 't':
+                tolerance = atoi(optarg);
+                break;
+            case 'e':
+                effectFilter = optarg;
+                break;
+            case 'v':
+                bVerbose = true;
+                break;
+            default:
+                Usage(argv[0]);
+                return opt == 'h' ? 0 : 2;
+        }
+    }
+
+    if (recordSettings.every == 0 || recordSettings.frames < recordSettings.every)
+    {
+        Usage(argv[0]);
+        return 2;
+    }
+
+    SimSetClock(SimClock::Virtual);
+    SimSetQuiet(!bVerbose);
+
+    EffectArena arena(EffectsFactory::ArenaSize());
+    VariantRun run(arena, std::make_shared<LEDMatrixGFX>());
+
+    uint32_t cPassed = 0, cFailed = 0, cRejected = 0;
+
+    const EffectEntry *entry;
+    for (size_t i = 0; (entry = EffectsFactory::GetEffectEntry(i)) != NULL; i++)
+    {
+        if (!effectFilter.empty() && std::string(entry->name).find(effectFilter) == std::string::npos)
+            continue;
+
+        const std::string effectDirectory = directory + "/" + entry->name;
+        for (const EffectVariant &variant : BuildVariants(*entry))
+        {
+            const std::string path = effectDirectory + "/" + FileName(variant.label) + ".ppm";
+            const char *pszLabel = variant.label.empty() ? "defaults" : variant.label.c_str();
+
+            GoldenFrames golden;
+            GoldenFrames drawn;
+            bool bHaveGolden = false;
+
+            if (bRecord)
+                drawn.settings = recordSettings;
+            else if ((bHaveGolden = ReadGolden(path, &golden)))
+                drawn.settings = golden.settings;
+
+            // A variant the factory turns down has no frames, which is only a failure if it used to have some
+            if (!Draw(run, *entry, variant, &drawn))
+            {
+                if (bHaveGolden)
+                {
+                    printf("FAIL  %s %s: not built any more, %s\n", entry->name, pszLabel, run.Error().c_str());
+                    cFailed++;
+                }
+                else
+                {
+                    printf("skip  %s %s: %s\n", entry->name, pszLabel, run.Error().c_str());
+                    cRejected++;
+                }
+                continue;
+            }
+
+            if (bRecord)
+            {
+                if (!MakeDirectories(effectDirectory) || !WriteGolden(path, drawn))
+                {
+                    fprintf(stderr, "Cannot write %s\n", path.c_str());
+                    return 2;
+                }
+                cPassed++;
+                continue;
+            }
+
+            std::string strDiff = bHaveGolden ? Compare(golden, drawn, tolerance) : "no golden frames, record them with --record";
+            if (strDiff.empty())
+            {
+                printf("ok    %s %s\n", entry->name, pszLabel);
+                cPassed++;
+            }
+            else
+            {
+                printf("FAIL  %s %s: %s\n", entry->name, pszLabel, strDiff.c_str());
+                cFailed++;
+            }
+        }
+    }
+
+    if (bRecord)
+        printf("%u variants recorded in %s, %u skipped\n", cPassed, directory.c_str(), cRejected);
+    else
+        printf("%u variants match, %u differ, %u skipped\n", cPassed, cFailed, cRejected);
+    return cFailed ? 1 : 0;
+}
@@ -0,0 +1,355 @@
+//+--------------------------------------------------------------------------
+//
+// File:        network.cpp
+//
+// Description:
+//
+//    WiFi, TCP and the MQTT stand-in for the native build
+//
+//---------------------------------------------------------------------------
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "ESP8266WiFi.h"
+#include "PubSubClient.h"
+#include "simulator.h"
+
+ESP8266WiFiClass WiFi;
+
+static std::string g_brokerHost;
+static uint16_t g_brokerPort = 0;
+
+void SimSetBroker(const char *pszHost, uint16_t port)
+{
+    g_brokerHost = pszHost ? pszHost : "";
+    g_brokerPort = port;
+}
+
+// IPAddress
+
+bool IPAddress::fromString(const char *psz)
+{
+    unsigned parts[4];
+    char extra;
+    if (!psz || sscanf(psz, "%u.%u.%u.%u%c", &parts[0], &parts[1], &parts[2], &parts[3], &extra) != 4)
+        return false;
+
+    for (int i = 0; i < 4; i++)
+    {
+        if (parts[i] > 255)
+            return false;
+        _bytes[i] = (uint8_t)parts[i];
+    }
+    return true;
+}
+
+String IPAddress::toString() const
+{
+    char buffer[16];
+    snprintf(buffer, sizeof(buffer), "%u.%u.%u.%u", _bytes[0], _bytes[1], _bytes[2], _bytes[3]);
+    return String(buffer);
+}
+
+// WiFiClient
+
+int WiFiClient::connect(IPAddress ip, uint16_t port)
+{
+    return connect(ip.toString().c_str(), port);
+}
+
+int WiFiClient::connect(const char *host, uint16_t port)
+{
+    stop();
+
+    addrinfo hints = {};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+
+    char service[8];
+    snprintf(service, sizeof(service), "%u", port);
+
+    addrinfo *pResult = NULL;
+    if (getaddrinfo(host, service, &hints, &pResult) != 0 || pResult == NULL)
+        return 0;
+
+    // Connect without blocking, then wait at most the timeout for it to finish
+    int sock = socket(pResult->ai_family, pResult->ai_socktype, pResult->ai_protocol);
+    if (sock >= 0)
+    {
+        fcntl(sock, F_SETFL, fcntl(sock, F_GETFL, 0) | O_NONBLOCK);
+
+        int result = ::connect(sock, pResult->ai_addr, pResult->ai_addrlen);
+        if (result != 0 && errno == EINPROGRESS)
+        {
+            pollfd pfd = { sock, POLLOUT, 0 };
+            int error = 0;
+            socklen_t cbError = sizeof(error);
+            if (poll(&pfd, 1, (int)_timeoutMs) == 1 && getsockopt(sock, SOL_SOCKET, SO_ERROR, &error, &cbError) == 0 && error == 0)
+                result = 0;
+        }
+
+        if (result == 0)
+        {
+            int noDelay = 1;
+            setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+            _socket = sock;
+        }
+        else
+        {
+            close(sock);
+        }
+    }
+
+    freeaddrinfo(pResult);
+    return _socket >= 0 ? 1 : 0;
+}
+
+uint8_t WiFiClient::connected()
+{
+    if (_socket < 0)
+        return 0;
+
+    // A socket the other end has closed reads as ready with nothing in it
+    char peek;
+    ssize_t cb = recv(_socket, &peek, 1, MSG_PEEK | MSG_DONTWAIT);
+    if (cb == 0 || (cb < 0 && errno != EAGAIN && errno != EWOULDBLOCK))
+    {
+        stop();
+        return 0;
+    }
+    return 1;
+}
+
+int WiFiClient::available()
+{
+    if (_socket < 0)
+        return 0;
+
+    char buffer[512];
+    ssize_t cb = recv(_socket, buffer, sizeof(buffer), MSG_PEEK | MSG_DONTWAIT);
+    return cb > 0 ? (int)cb : 0;
+}
+
+int WiFiClient::read()
+{
+    uint8_t c;
+    return read(&c, 1) == 1 ? c : -1;
+}
+
+int WiFiClient::read(uint8_t *buffer, size_t size)
+{
+    if (_socket < 0)
+        return -1;
+
+    ssize_t cb = recv(_socket, buffer, size, MSG_DONTWAIT);
+    return cb > 0 ? (int)cb : -1;
+}
+
+size_t WiFiClient::write(const uint8_t *buffer, size_t size)
+{
+    if (_socket < 0)
+        return 0;
+
+    ssize_t cb = send(_socket, buffer, size, MSG_NOSIGNAL);
+    return cb > 0 ? (size_t)cb : 0;
+}
+
+void WiFiClient::stop()
+{
+    if (_socket >= 0)
+    {
+        close(_socket);
+        _socket = -1;
+    }
+}
+
+// PubSubClient
+
+struct QueuedMessage
+{
+    uint32_t    atMs;
+    std::string topic;
+    std::string payload;
+};
+
+static std::vector<QueuedMessage> g_messages;
+static size_t g_nextMessage = 0;
+
+void SimQueueMessage(uint32_t atMs, const char *pszTopic, const char *pszPayload)
+{
+    g_messages.push_back({ atMs, pszTopic ? pszTopic : "", pszPayload ? pszPayload : "" });
+}
+
+bool PubSubClient::connect(const char *)
+{
+    _bInProcess = g_brokerHost.empty();
+
+    bool bConnected = _bInProcess || _client.connect(g_brokerHost.c_str(), g_brokerPort);
+
+    _subscriptions.clear();
+    _pending.clear();
+    _connectedMs = millis();
+    _state = bConnected ? MQTT_CONNECTED : MQTT_CONNECT_FAILED;
+    return bConnected;
+}
+
+void PubSubClient::disconnect()
+{
+    _client.stop();
+    _state = MQTT_DISCONNECTED;
+}
+
+bool PubSubClient::connected()
+{
+    if (_state != MQTT_CONNECTED)
+        return false;
+
+    if (!_bInProcess && !_client.connected())
+    {
+        _state = MQTT_CONNECTION_LOST;
+        return false;
+    }
+    return true;
+}
+
+bool PubSubClient::subscribe(const char *topic, uint8_t)
+{
+    if (!connected())
+        return false;
+
+    _subscriptions.push_back(topic);
+    return true;
+}
+
+bool PubSubClient::publish(const char *topic, const char *payload, bool)
+{
+    if (!connected())
+        return false;
+
+    // One message a line, so newlines in the payload go as \n
+    std::string line = std::string(topic) + ' ';
+    for (const char *p = payload; p && *p; p++)
+        line += *p == '\n' ? std::string("\\n") : std::string(1, *p);
+    line += '\n';
+
+    if (_bInProcess)
+    {
+        Serial.print("mqtt> ");
+        Serial.print(line.c_str());
+        return true;
+    }
+    return _client.write((const uint8_t *)line.data(), line.size()) == line.size();
+}
+
+bool PubSubClient::beginPublish(const char *topic, unsigned int length, bool)
+{
+    if (!connected())
+        return false;
+
+    _publishTopic = topic;
+    _publishPayload.clear();
+    _publishPayload.reserve(length);
+    return true;
+}
+
+size_t PubSubClient::write(const uint8_t *buffer, size_t size)
+{
+    _publishPayload.append((const char *)buffer, size);
+    return size;
+}
+
+int PubSubClient::endPublish()
+{
+    return publish(_publishTopic.c_str(), _publishPayload.c_str()) ? 1 : 0;
+}
+
+// Matches - Topic filters as MQTT has them: '+' is one level, '#' at the end is the rest
+
+bool PubSubClient::Matches(const std::string &topic) const
+{
+    for (const std::string &filter : _subscriptions)
+    {
+        size_t f = 0, t = 0;
+        while (f < filter.size())
+        {
+            if (filter[f] == '#')
+                return true;
+
+            if (filter[f] == '+')
+            {
+                while (t < topic.size() && topic[t] != '/')
+                    t++;
+                f++;
+                continue;
+            }
+
+            if (t >= topic.size() || filter[f] != topic[t])
+                break;
+            f++;
+            t++;
+        }
+
+        if (f == filter.size() && t == topic.size())
+            return true;
+    }
+    return false;
+}
+
+void PubSubClient::Dispatch(const std::string &topic, const std::string &payload)
+{
+    if (topic.empty() || !Matches(topic) || !callback)
+        return;
+
+    // The callback gets buffers it may write to, as the real client hands out its packet buffer
+    std::string topicCopy = topic;
+    std::string payloadCopy = payload;
+    callback(&topicCopy[0], (uint8_t *)&payloadCopy[0], (unsigned int)payloadCopy.size());
+}
+
+void PubSubClient::DispatchLine(std::string &line)
+{
+    if (!line.empty() && line.back() == '\r')
+        line.pop_back();
+
+    size_t space = line.find(' ');
+    Dispatch(line.substr(0, space), space == std::string::npos ? std::string() : line.substr(space + 1));
+}
+
+bool PubSubClient::loop()
+{
+    if (!connected())
+        return false;
+
+    while (g_nextMessage < g_messages.size() && millis() - _connectedMs >= g_messages[g_nextMessage].atMs)
+    {
+        const QueuedMessage &message = g_messages[g_nextMessage++];
+        Dispatch(message.topic, message.payload);
+    }
+
+    if (_bInProcess)
+        return true;
+
+    uint8_t buffer[MQTT_MAX_PACKET_SIZE];
+    int cb;
+    while ((cb = _client.read(buffer, sizeof(buffer))) > 0)
+    {
+        _pending.append((const char *)buffer, cb);
+
+        size_t newline;
+        while ((newline = _pending.find('\n')) != std::string::npos)
+        {
+            std::string line = _pending.substr(0, newline);
+            _pending.erase(0, newline + 1);
+            DispatchLine(line);
+        }
+    }
+    return true;
+}
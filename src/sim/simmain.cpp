@@ -0,0 +1,385 @@
+//+--------------------------------------------------------------------------
+//
+// File:        simmain.cpp
+//
+// Description:
+//
+//    Entry point of the native build.  Runs the station's own setup() and
+//    loop() from main.cpp headless, writes the frames each channel sends to
+//    its strip to files, and reports how long the passes that drew a frame
+//    took on the host, which is also what a profiler run against it sees.
+//
+//      pio run -e native && .pio/build/native/program --virtual --frames 600 --out frames
+//
+//    Options:
+//
+//      --frames N          Stop once a channel has sent N frames
+//      --seconds S         Stop after S seconds of station time
+//      --virtual           Virtual clock, as fast as the host can go, see SimClock
+//      --seed N            Seed for every random number source, for runs that replay exactly
+//      --fs DIR            Directory LittleFS lives in, data by default
+//      --broker HOST:PORT  MQTT stand-in to connect to over TCP, see PubSubClient.h
+//      --send MESSAGE      Message for the station once it is connected, ie: "/set/power 11"
+//      --script FILE       Messages for the station, one a line, "@5000 /set/power 10" sends it 5s in
+//      --out PREFIX        Write each channel's frames to PREFIX.ch<N>.<format>
+//      --format F          ppm (default, one row per frame), raw (RGB bytes) or csv
+//      --quiet             Drop the station's Serial output
+//
+//    Topics starting with '/' are the station's own, STATION_ID is put in
+//    front of them.
+//
+//---------------------------------------------------------------------------
+
+#include <getopt.h>
+#include <signal.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Arduino.h"
+#include "FastLED.h"
+#include "globals.h"
+#include "simulator.h"
+
+void setup();
+void loop();
+
+enum class FrameFormat
+{
+    Ppm,
+    Raw,
+    Csv
+};
+
+// FrameWriter
+//
+// One channel's frames, in whichever format was asked for.  A PPM's height is not known until the run ends,
+// so its header is written with room to spare and filled in by Close.
+
+class FrameWriter
+{
+  private:
+
+    FILE       *_file;
+    FrameFormat _format;
+    int         _width;
+    uint32_t    _frames;
+
+    void WritePpmHeader()
+    {
+        fprintf(_file, "P6\n%d %10u\n255\n", _width, _frames);
+    }
+
+  public:
+
+    FrameWriter(FILE *file, FrameFormat format)
+      : _file(file), _format(format), _width(0), _frames(0)
+    {
+    }
+
+    ~FrameWriter()
+    {
+        Close();
+    }
+
+    void Write(const CRGB *leds, int count, unsigned long us)
+    {
+        if (!_file)
+            return;
+
+        if (_frames == 0)
+        {
+            _width = count;
+            if (_format == FrameFormat::Ppm)
+                WritePpmHeader();
+            else if (_format == FrameFormat::Csv)
+            {
+                fprintf(_file, "frame,micros");
+                for (int i = 0; i < count; i++)
+                    fprintf(_file, ",r%d,g%d,b%d", i, i, i);
+                fputc('\n', _file);
+            }
+        }
+
+        // Every row of a PPM is as wide as the first frame
+        if (_format != FrameFormat::Csv && count != _width)
+            count = std::min(count, _width);
+
+        if (_format == FrameFormat::Csv)
+        {
+            fprintf(_file, "%u,%lu", _frames, us);
+            for (int i = 0; i < count; i++)
+                fprintf(_file, ",%u,%u,%u", leds[i].r, leds[i].g, leds[i].b);
+            fputc('\n', _file);
+        }
+        else
+        {
+            for (int i = 0; i < count; i++)
+                fwrite(leds[i].raw, 1, 3, _file);
+            for (int i = count; i < _width; i++)
+                fwrite(CRGB().raw, 1, 3, _file);
+        }
+        _frames++;
+    }
+
+    void Close()
+    {
+        if (!_file)
+            return;
+
+        if (_format == FrameFormat::Ppm && _frames > 0)
+        {
+            fseek(_file, 0, SEEK_SET);
+            WritePpmHeader();
+        }
+        fclose(_file);
+        _file = NULL;
+    }
+};
+
+struct ChannelStats
+{
+    uint32_t frames = 0;
+};
+
+static volatile sig_atomic_t g_bStop = 0;
+static std::vector<std::unique_ptr<FrameWriter>> g_writers;
+static std::vector<ChannelStats> g_channels;
+
+static void CloseWriters()
+{
+    g_writers.clear();
+}
+
+static void OnSignal(int)
+{
+    g_bStop = 1;
+}
+
+// QueueMessage
+//
+// Queues "[@ms] topic payload" for the station, false if there is no topic
+
+static bool QueueMessage(std::string line)
+{
+    uint32_t atMs = 0;
+    if (!line.empty() && line[0] == '@')
+    {
+        size_t end = line.find(' ');
+        atMs = (uint32_t)strtoul(line.c_str() + 1, NULL, 10);
+        line = end == std::string::npos ? std::string() : line.substr(end + 1);
+    }
+
+    size_t space = line.find(' ');
+    std::string topic = line.substr(0, space);
+    std::string payload = space == std::string::npos ? std::string() : line.substr(space + 1);
+    if (topic.empty())
+        return false;
+
+    if (topic[0] == '/')
+        topic = STATION_ID + topic;
+    SimQueueMessage(atMs, topic.c_str(), payload.c_str());
+    return true;
+}
+
+static bool QueueScript(const char *pszPath)
+{
+    FILE *file = fopen(pszPath, "r");
+    if (!file)
+        return false;
+
+    char buffer[1024];
+    while (fgets(buffer, sizeof(buffer), file))
+    {
+        std::string line = buffer;
+        while (!line.empty() && (line.back() == '\n' || line.back() == '\r'))
+            line.pop_back();
+        if (!line.empty() && line[0] != '#')
+            QueueMessage(line);
+    }
+    fclose(file);
+    return true;
+}
+
+static void Usage(const char *pszProgram)
+{
+    fprintf(stderr,
+            "usage: %s [--frames N] [--seconds S] [--virtual] [--seed N] [--fs DIR]\n"
+            "          [--broker HOST:PORT] [--send MESSAGE] [--script FILE]\n"
+            "          [--out PREFIX] [--format ppm|raw|csv] [--quiet]\n",
+            pszProgram);
+}
+
+int main(int argc, char *argv[])
+{
+    static const option options[] =
+    {
+        { "frames",  required_argument, NULL, 'n' },
+        { "seconds", required_argument, NULL, 's' },
+        { "virtual", no_argument,       NULL, 'v' },
+        { "seed",    required_argument, NULL, 'r' },
+        { "fs",      required_argument, NULL, 'f' },
+        { "broker",  required_argument, NULL, 'b' },
+        { "send",    required_argument, NULL, 'm' },
+        { "script",  required_argument, NULL, 'x' },
+        { "out",     required_argument, NULL, 'o' },
+        { "format",  required_argument, NULL, 't' },
+        { "quiet",   no_argument,       NULL, 'q' },
+        { "help",    no_argument,       NULL, 'h' },
+        { NULL,      0,                 NULL, 0 }
+    };
+
+    uint32_t maxFrames = 0;
+    double maxSeconds = 0;
+    bool bVirtual = false;
+    std::string outPrefix;
+    FrameFormat format = FrameFormat::Ppm;
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "", options, NULL)) != -1)
+    {
+        switch (opt)
+        {
+            case 'n':
+                maxFrames = (uint32_t)strtoul(optarg, NULL, 10);
+                break;
+            case 's':
+                maxSeconds = atof(optarg);
+                break;
+            case 'v':
+                bVirtual = true;
+                break;
+            case 'r':
+                SimSetSeed((uint32_t)strtoul(optarg, NULL, 0));
+                break;
+            case 'f':
+                SimSetFileSystemRoot(optarg);
+                break;
+            case 'b':
+            {
+                std::string broker = optarg;
+                size_t colon = broker.rfind(':');
+                uint16_t port = colon == std::string::npos ? 1883 : (uint16_t)atoi(broker.c_str() + colon + 1);
+                SimSetBroker(broker.substr(0, colon).c_str(), port);
+                break;
+            }
+            case 'm':
+                if (!QueueMessage(optarg))
+                {
+                    Usage(argv[0]);
+                    return 2;
+                }
+                break;
+            case 'x':
+                if (!QueueScript(optarg))
+                {
+                    fprintf(stderr, "Cannot read %s\n", optarg);
+                    return 2;
+                }
+                break;
+            case 'o':
+                outPrefix = optarg;
+                break;
+            case 't':
+                if (!strcmp(optarg, "ppm"))
+                    format = FrameFormat::Ppm;
+                else if (!strcmp(optarg, "raw"))
+                    format = FrameFormat::Raw;
+                else if (!strcmp(optarg, "csv"))
+                    format = FrameFormat::Csv;
+                else
+                {
+                    Usage(argv[0]);
+                    return 2;
+                }
+                break;
+            case 'q':
+                SimSetQuiet(true);
+                break;
+            default:
+                Usage(argv[0]);
+                return opt == 'h' ? 0 : 2;
+        }
+    }
+
+    if (bVirtual)
+        SimSetClock(SimClock::Virtual);
+
+    signal(SIGINT, OnSignal);
+    signal(SIGTERM, OnSignal);
+    SimSetRestartHandler(CloseWriters);
+    atexit(CloseWriters);
+
+    SimSetFrameSink([&](int controller, const CRGB *leds, int count)
+    {
+        if ((size_t)controller >= g_channels.size())
+            g_channels.resize(controller + 1);
+        g_channels[controller].frames++;
+
+        if (outPrefix.empty())
+            return;
+
+        if ((size_t)controller >= g_writers.size())
+            g_writers.resize(controller + 1);
+
+        if (!g_writers[controller])
+        {
+            static const char *extensions[] = { "ppm", "rgb", "csv" };
+            std::string path = outPrefix + ".ch" + std::to_string(controller) + "." + extensions[(int)format];
+            FILE *file = fopen(path.c_str(), "wb");
+            if (!file)
+                fprintf(stderr, "Cannot write %s\n", path.c_str());
+            g_writers[controller].reset(new FrameWriter(file, format));
+        }
+        g_writers[controller]->Write(leds, count, micros());
+    });
+
+    setup();
+
+    // Time the passes that sent at least one frame, the rest only poll the network.  What a pass spends waiting
+    // for the next frame is left out, it is only real in real time.
+    const unsigned long startMicros = micros();
+    uint64_t renderNanos = 0, maxRenderNanos = 0;
+    uint32_t renderPasses = 0, passes = 0;
+    uint32_t framesSeen = 0;
+
+    while (!g_bStop)
+    {
+        uint64_t passStart = SimHostNanos();
+        uint64_t idleStart = SimIdleNanos();
+        loop();
+        uint64_t passNanos = (SimHostNanos() - passStart) - (SimIdleNanos() - idleStart);
+        passes++;
+
+        uint32_t frames = 0, busiest = 0;
+        for (const ChannelStats &channel : g_channels)
+        {
+            frames += channel.frames;
+            busiest = std::max(busiest, channel.frames);
+        }
+
+        if (frames != framesSeen)
+        {
+            framesSeen = frames;
+            renderPasses++;
+            renderNanos += passNanos;
+            maxRenderNanos = std::max(maxRenderNanos, passNanos);
+        }
+
+        if (maxFrames && busiest >= maxFrames)
+            break;
+        if (maxSeconds > 0 && (micros() - startMicros) >= maxSeconds * 1e6)
+            break;
+    }
+
+    fprintf(stderr, "%u passes over %.3f s of station time\n", passes, (micros() - startMicros) / 1e6);
+    for (size_t i = 0; i < g_channels.size(); i++)
+        fprintf(stderr, "channel %zu: %u frames\n", i, g_channels[i].frames);
+    if (renderPasses)
+        fprintf(stderr, "passes that sent a frame: %u, mean %.1f us, max %.1f us\n",
+                renderPasses, renderNanos / 1000.0 / renderPasses, maxRenderNanos / 1000.0);
+
+    CloseWriters();
+    return 0;
+}